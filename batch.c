@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "batch.h"
+
+
+/* Returns the position of a suit in the rules' suits. Given a constant it
+ * is folded by the compiler, so that the suit orders below cost nothing.
+ */
+static inline int position(char suit) {
+    return strchr(MODEL_SUITS, suit) - MODEL_SUITS;
+}
+
+
+/* Returns all ones in the lanes holding at least one rank.
+ */
+static inline BatchLanes nonempty(BatchLanes ranks) {
+    return (BatchLanes)(ranks != 0);
+}
+
+
+/* Returns the lowest rank of each lane's mask.
+ */
+static inline BatchLanes lowest(BatchLanes ranks) {
+    return ranks & -ranks;
+}
+
+
+/* Returns the highest rank of each lane's mask, by filling in every rank
+ * below the highest and then clearing them.
+ */
+static inline BatchLanes highest(BatchLanes ranks) {
+    ranks |= ranks >> 1;
+    ranks |= ranks >> 2;
+    ranks |= ranks >> 4;
+    ranks |= ranks >> 8;
+    return ranks & ~(ranks >> 1);
+}
+
+
+/* Chooses the highest or lowest card of the first suit of an order of
+ * slots held in each lane, as find_highest and find_lowest do, leaving the
+ * lanes set in found untouched. The card is added to its suit in card.
+ */
+static inline void pick_in_slots(const BatchLanes* hand, const int* slots,
+        bool high, BatchLanes found, BatchLanes* card) {
+    for (int i = 0; i < NUM_SUITS; i++) {
+        int suit = slots[i];
+        BatchLanes take = nonempty(hand[suit]) & ~found;
+
+        card[suit] |= (high ? highest(hand[suit]) : lowest(hand[suit])) &
+                take;
+        found |= take;
+    }
+}
+
+
+/* Chooses as pick_in_slots does from an order of suit characters, which
+ * the compiler folds into slots when it is constant.
+ */
+static inline void pick_in_order(const BatchLanes* hand, const char* order,
+        bool high, BatchLanes found, BatchLanes* card) {
+    int slots[NUM_SUITS];
+
+    for (int i = 0; i < NUM_SUITS; i++) {
+        slots[i] = position(order[i]);
+    }
+    pick_in_slots(hand, slots, high, found, card);
+}
+
+
+/* Chooses the highest or lowest card of the lead suit in each lane, as
+ * find_highest_suit and find_lowest_suit do. Returns all ones in the lanes
+ * holding the lead suit.
+ */
+static inline BatchLanes pick_lead_suit(const BatchLanes* hand,
+        const BatchLanes* leadSuit, bool high, BatchLanes* card) {
+    BatchLanes found = {0};
+
+    for (int suit = 0; suit < NUM_SUITS; suit++) {
+        BatchLanes ranks = hand[suit] & leadSuit[suit];
+
+        card[suit] = high ? highest(ranks) : lowest(ranks);
+        found |= nonempty(ranks);
+    }
+
+    return found;
+}
+
+
+/* Chooses bob's following card: the highest of the lead suit or else the
+ * lowest in its win order (S, C, H, D) once a diamond has been played and
+ * some player is near the threshold, and otherwise the lowest of the lead
+ * suit or else the highest in its duck order (S, C, D, H). Both are chosen
+ * in every lane and each lane keeps the one its rule asks for.
+ */
+static inline void bob_follow(const struct Batch* batch,
+        const struct BatchBob* bob, const BatchLanes* hand,
+        const BatchLanes* leadSuit, BatchLanes roundDiamonds,
+        BatchLanes* card) {
+    BatchLanes near = {0};
+    BatchLanes win[NUM_SUITS];
+    BatchLanes duck[NUM_SUITS];
+    BatchLanes found;
+
+    for (int p = 0; p < batch->numPlayers; p++) {
+        near |= (BatchLanes)(batch->diamonds[p] >= bob->nearThreshold);
+    }
+    near &= nonempty(roundDiamonds);
+
+    found = pick_lead_suit(hand, leadSuit, true, win);
+    pick_in_slots(hand, bob->winOrder, false, found, win);
+    found = pick_lead_suit(hand, leadSuit, false, duck);
+    pick_in_slots(hand, bob->duckOrder, true, found, duck);
+
+    for (int suit = 0; suit < NUM_SUITS; suit++) {
+        card[suit] = (win[suit] & near) | (duck[suit] & ~near);
+    }
+}
+
+
+/* Chooses the card of a strategy in every lane from the hand given, for
+ * the lead or to follow the lead suit, with the rules bob given for bob.
+ * The card is one rank in one suit of card.
+ */
+static inline void decide(const struct Batch* batch,
+        enum BatchStrategy strategy, const struct BatchBob* bob, bool lead,
+        const BatchLanes* hand, const BatchLanes* leadSuit,
+        BatchLanes roundDiamonds, BatchLanes* card) {
+    BatchLanes none = {0};
+
+    for (int suit = 0; suit < NUM_SUITS; suit++) {
+        card[suit] = none;
+    }
+
+    switch (strategy) {
+        case BATCH_ALICE:
+            if (lead) {
+                pick_in_order(hand, "SCDH", true, none, card);
+            } else {
+                pick_in_order(hand, "DHSC", true,
+                        pick_lead_suit(hand, leadSuit, false, card), card);
+            }
+            break;
+        case BATCH_BOB:
+            if (lead) {
+                pick_in_slots(hand, bob->leadOrder, false, none, card);
+            } else {
+                bob_follow(batch, bob, hand, leadSuit, roundDiamonds, card);
+            }
+            break;
+    }
+}
+
+
+/* Plays the card of the current player in every lane. The current
+ * player's hand is gathered from the seats with masks, each strategy and
+ * set of bob rules in the batch chooses a card from it in every lane, and
+ * each lane keeps the card of its current player's strategy, which is
+ * removed from the hand. The card is left in card.
+ */
+static inline void play_step(struct Batch* batch, BatchLanes current,
+        bool lead, const BatchLanes* leadSuit, BatchLanes roundDiamonds,
+        BatchLanes* card) {
+    BatchLanes turns[MODEL_MAX_PLAYERS];
+    BatchLanes hand[NUM_SUITS] = {{0}};
+    BatchLanes bobs[MODEL_MAX_PLAYERS] = {{0}};
+    BatchLanes choice[NUM_SUITS];
+
+    for (int seat = 0; seat < batch->numPlayers; seat++) {
+        turns[seat] = (BatchLanes)(current == (uint16_t)seat);
+        for (int suit = 0; suit < NUM_SUITS; suit++) {
+            hand[suit] |= batch->hands[suit][seat] & turns[seat];
+        }
+        if (batch->seats[seat] == BATCH_BOB) {
+            bobs[batch->seatBobs[seat]] |= turns[seat];
+        }
+    }
+
+    decide(batch, BATCH_ALICE, NULL, lead, hand, leadSuit, roundDiamonds,
+            card);
+    for (int i = 0; i < batch->numBobs; i++) {
+        decide(batch, BATCH_BOB, &batch->bobs[i], lead, hand, leadSuit,
+                roundDiamonds, choice);
+        for (int suit = 0; suit < NUM_SUITS; suit++) {
+            card[suit] = (choice[suit] & bobs[i]) | (card[suit] & ~bobs[i]);
+        }
+    }
+
+    for (int seat = 0; seat < batch->numPlayers; seat++) {
+        for (int suit = 0; suit < NUM_SUITS; suit++) {
+            batch->hands[suit][seat] &= ~(card[suit] & turns[seat]);
+        }
+    }
+}
+
+
+/* Returns the batch strategy with the given name, or -1 if there is none.
+ */
+int batch_strategy(const char* name) {
+    if (!strcmp(name, "alice")) {
+        return BATCH_ALICE;
+    }
+
+    if (!strcmp(name, "bob")) {
+        return BATCH_BOB;
+    }
+
+    return -1;
+}
+
+
+/* Sets the rules of a bob seat from its parameters and the threshold.
+ */
+static void bob_rules(struct BatchBob* bob, const struct BobParams* params,
+        int threshold) {
+    int near = threshold - params->margin;
+
+    bob->nearThreshold = near < 0 ? 0 : near > UINT16_MAX ? UINT16_MAX : near;
+    for (int i = 0; i < NUM_SUITS; i++) {
+        bob->leadOrder[i] = position(params->leadOrder[i]);
+        bob->duckOrder[i] = position(params->duckOrder[i]);
+        bob->winOrder[i] = position(params->winOrder[i]);
+    }
+}
+
+
+/* Starts an empty batch of games with the given players and threshold.
+ * bobParams gives the parameters of each seat playing bob, or is NULL for
+ * the defaults in every seat. Seats with the same parameters share their
+ * rules, so that each step decides once for all of them. Games are added
+ * with batch_deal.
+ */
+void batch_init(struct Batch* batch, int numPlayers, int threshold,
+        const enum BatchStrategy* seats, const struct BobParams* bobParams) {
+    struct BobParams distinct[MODEL_MAX_PLAYERS];
+    struct BobParams defaults;
+
+    bob_default_params(&defaults);
+    memset(batch, 0, sizeof(*batch));
+    batch->numPlayers = numPlayers;
+    memcpy(batch->seats, seats, sizeof(enum BatchStrategy) * numPlayers);
+    for (int p = 0; p < numPlayers; p++) {
+        const struct BobParams* params = bobParams ? &bobParams[p] :
+                &defaults;
+        int i = 0;
+
+        if (seats[p] != BATCH_BOB) {
+            continue;
+        }
+
+        while (i < batch->numBobs && !bob_same_params(&distinct[i], params)) {
+            i++;
+        }
+        if (i == batch->numBobs) {
+            distinct[batch->numBobs++] = *params;
+            bob_rules(&batch->bobs[i], params, threshold);
+        }
+        batch->seatBobs[p] = i;
+    }
+}
+
+
+/* Adds the game of a model state, which must not have started, as the
+ * given lane of the batch.
+ */
+void batch_deal(struct Batch* batch, int lane,
+        const struct ModelState* state) {
+    for (int p = 0; p < batch->numPlayers; p++) {
+        for (int suit = 0; suit < NUM_SUITS; suit++) {
+            batch->hands[suit][p][lane] =
+                    model_suit_ranks(state->hands[p], suit);
+        }
+    }
+
+    batch->leadPlayer[lane] = state->leadPlayer;
+    batch->roundsLeft[lane] = state->roundsLeft;
+    if (state->roundsLeft > batch->maxRounds) {
+        batch->maxRounds = state->roundsLeft;
+    }
+}
+
+
+/* Plays every game of the batch to the end, one step of every game at a
+ * time. Lanes whose game is over hold no cards and take no part.
+ */
+void batch_play(struct Batch* batch) {
+    uint16_t numPlayers = batch->numPlayers;
+
+    for (int round = 0; round < batch->maxRounds; round++) {
+        BatchLanes active = (BatchLanes)(batch->roundsLeft > 0);
+        BatchLanes lead = batch->leadPlayer;
+        BatchLanes winner = lead;
+        BatchLanes winningRank = {0};
+        BatchLanes roundDiamonds = {0};
+        BatchLanes leadSuit[NUM_SUITS] = {{0}};
+
+        for (int step = 0; step < numPlayers; step++) {
+            BatchLanes current = lead + (uint16_t)step;
+            BatchLanes card[NUM_SUITS];
+
+            current -= (BatchLanes)(current >= numPlayers) & numPlayers;
+            play_step(batch, current, step == 0, leadSuit, roundDiamonds,
+                    card);
+
+            if (step == 0) {
+                for (int suit = 0; suit < NUM_SUITS; suit++) {
+                    leadSuit[suit] = nonempty(card[suit]);
+                    winningRank |= card[suit];
+                }
+            } else {
+                BatchLanes follow = {0};
+                BatchLanes beats;
+
+                for (int suit = 0; suit < NUM_SUITS; suit++) {
+                    follow |= card[suit] & leadSuit[suit];
+                }
+                beats = (BatchLanes)(follow > winningRank);
+                winner = (current & beats) | (winner & ~beats);
+                winningRank = (follow & beats) | (winningRank & ~beats);
+            }
+
+            roundDiamonds += nonempty(card[MODEL_DIAMONDS]) & 1;
+        }
+
+        for (int p = 0; p < numPlayers; p++) {
+            BatchLanes won = (BatchLanes)(winner == (uint16_t)p) & active;
+
+            batch->points[p] += won & 1;
+            batch->diamonds[p] += won & roundDiamonds;
+        }
+        batch->leadPlayer = winner;
+        batch->roundsLeft -= active & 1;
+    }
+}
+
+
+/* Copies the rounds and diamonds won in the given lane into a model state,
+ * ending its game, so that model_score gives the final scores.
+ */
+void batch_result(const struct Batch* batch, int lane,
+        struct ModelState* state) {
+    for (int p = 0; p < batch->numPlayers; p++) {
+        state->points[p] = batch->points[p][lane];
+        state->diamonds[p] = batch->diamonds[p][lane];
+        state->hands[p] = 0;
+        state->handCounts[p] = 0;
+    }
+
+    state->leadPlayer = batch->leadPlayer[lane];
+    state->currentPlayer = state->leadPlayer;
+    state->roundsLeft = 0;
+}
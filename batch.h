@@ -0,0 +1,110 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+#include "utilities.h"
+#include "bobparams.h"
+
+
+/* The number of games a batch plays at once, one per 16 bit lane of a
+ * 128 bit vector, which every x86-64 and ARMv8 processor supports.
+ */
+#define BATCH_LANES 8
+
+
+/* One value per game of a batch. Operations on it apply to every lane at
+ * once, and comparisons give all ones in the lanes where they hold.
+ */
+typedef uint16_t BatchLanes
+        __attribute__((vector_size(BATCH_LANES * sizeof(uint16_t))));
+
+
+/* The strategies the batch engine can play.
+ */
+enum BatchStrategy {
+    BATCH_ALICE = 0,
+    BATCH_BOB = 1,
+};
+
+
+/* The rules of a bob seat, from its parameters.
+ */
+struct BatchBob {
+    // The diamonds some player must have won for bob to try to win a
+    // round with a diamond played, capped to fit in a lane
+    uint16_t nearThreshold;
+    // The slots of bob's suit orders, as in struct BobParams
+    int leadOrder[NUM_SUITS];
+    int duckOrder[NUM_SUITS];
+    int winOrder[NUM_SUITS];
+};
+
+
+/* Up to BATCH_LANES games with the same players, played in lockstep by
+ * heuristic strategies. Every field holding BatchLanes is stored as one
+ * vector per seat or suit, so that each step of the rules is a handful of
+ * vector operations over all the games, without branching on any game.
+ */
+struct Batch {
+    // The number of players in every game
+    int numPlayers;
+    // The strategy of each seat
+    enum BatchStrategy seats[MODEL_MAX_PLAYERS];
+    // The different rules played by bob seats
+    struct BatchBob bobs[MODEL_MAX_PLAYERS];
+    // The number of different bob rules
+    int numBobs;
+    // The index in bobs of the rules of each bob seat
+    int seatBobs[MODEL_MAX_PLAYERS];
+    // The ranks each player holds in each suit, as masks
+    BatchLanes hands[NUM_SUITS][MODEL_MAX_PLAYERS];
+    // The number of rounds each player has won
+    BatchLanes points[MODEL_MAX_PLAYERS];
+    // The number of diamonds each player has won
+    BatchLanes diamonds[MODEL_MAX_PLAYERS];
+    // The player leading the next round
+    BatchLanes leadPlayer;
+    // The number of rounds left to play
+    BatchLanes roundsLeft;
+    // The most rounds left in any game
+    int maxRounds;
+};
+
+
+/* Returns the batch strategy with the given name, or -1 if there is none.
+ */
+int batch_strategy(const char* name);
+
+
+/* Starts an empty batch of games with the given players and threshold.
+ * bobParams gives the parameters of each seat playing bob, or is NULL for
+ * the defaults in every seat. Games are added with batch_deal.
+ */
+void batch_init(struct Batch* batch, int numPlayers, int threshold,
+        const enum BatchStrategy* seats, const struct BobParams* bobParams);
+
+
+/* Adds the game of a model state, which must not have started, as the
+ * given lane of the batch.
+ */
+void batch_deal(struct Batch* batch, int lane, const struct ModelState* state);
+
+
+/* Plays every game of the batch to the end.
+ */
+void batch_play(struct Batch* batch);
+
+
+/* Copies the rounds and diamonds won in the given lane into a model state,
+ * ending its game, so that model_score gives the final scores.
+ */
+void batch_result(const struct Batch* batch, int lane,
+        struct ModelState* state);
+
+
+#endif
@@ -7,23 +7,30 @@
 #include <unistd.h>
 
 #include "players.h"
+#include "strategy.h"
 #include "utilities.h"
+#include "bobparams.h"
 
 
-/* Checks whether the current player has won at least threshold minus two 
- * diamond cards, as well as whether at least one other player has also 
- * reached this amount. If so, if the round currently has at least one 
- * diamond played, the function returns true, otherwise returns false.
+// The parameters bob plays with, set by strategy_entry
+static struct BobParams params;
+
+// The text of the parameters given in the environment, if any
+static char paramsText[BOB_PARAMS_LENGTH];
+
+
+/* Checks whether at least one player (including this one) has won at least
+ * threshold minus the margin (two by default) diamond cards. If so, and
+ * the round currently has at least one diamond played, the function
+ * returns true, otherwise returns false.
  */
-bool check_diamond_quantity(struct Game* game) {  
-    if (!game->numDiamondCards[game->playerId] >= game->threshold - 2) {
+static bool check_diamond_quantity(const struct Game* game) {
+    if (game->roundDiamonds <= 0) {
         return false;
     }
 
-
     for (int i = 0; i < game->numPlayers; i++) {
-        if (game->numDiamondCards[i] >= game->threshold - 2 
-                && game->roundDiamonds > 0) {
+        if (game->numDiamondCards[i] >= game->threshold - params.margin) {
             return true;
         }
     }
@@ -34,84 +41,69 @@ bool check_diamond_quantity(struct Game* game) {
 
 /* Determines a non-lead move of the current bob player. It
  * first checks whether an acceptable number of diamonds have
- * have been player. If not, then the player plays a move in the
- * order of suits specified. The chosen card is then outputted to stdout for
- * the hub to view.
+ * have been played. If so, it tries to win the round, and otherwise
+ * plays in the order of suits specified.
  */
-void determine_regular_move(struct Game* game) {
-    struct Card* cards = malloc(sizeof(struct Card));
+static struct Card determine_regular_move(void* state,
+        const struct Game* game) {
+    struct Card card;
     char suit = game->leadCard.suit;
-    char suitOrder[4] = {'S', 'C', 'D', 'H'};
 
+    (void)state;
     if (check_diamond_quantity(game)) {
-        if (find_highest_suit(game, cards, suit)) {
-            printf("PLAY%c%c\n", cards[0].suit, encode_rank(cards[0].rank));
-            fflush(stdout);
-        } else {
-            char newOrder[4] = {'S', 'C', 'H', 'D'};
-            find_lowest(game, cards, newOrder);
-            printf("PLAY%c%c\n", cards[0].suit, encode_rank(cards[0].rank));
-            fflush(stdout);
-        }  
+        if (!find_highest_suit(game, &card, suit)) {
+            find_lowest(game, &card, params.winOrder);
+        }
+        return card;
     }
-    
-    if (find_lowest_suit(game, cards, suit)) {
-        printf("PLAY%c%c\n", cards[0].suit, encode_rank(cards[0].rank));
-        fflush(stdout);
-    } else {
-        find_highest(game, cards, suitOrder);
-        printf("PLAY%c%c\n", cards[0].suit, encode_rank(cards[0].rank));
-        fflush(stdout);
+
+    if (!find_lowest_suit(game, &card, suit)) {
+        find_highest(game, &card, params.duckOrder);
     }
 
-    game->currentCard = malloc(sizeof(char) * 3);
-    char* playedCard = malloc(sizeof(char) * 3);
-    playedCard[0] = cards[0].suit;
-    playedCard[1] = encode_rank(cards[0].rank);
-    playedCard[2] = '\0'; 
-    strcpy(game->currentCard, playedCard);
-    free(playedCard);
-    remove_card(cards[0], game);
-    free(cards);
+    return card;
 }
 
 
-/* Determines the moves of the player if they are leading the round.
- * The chosen card is then outputted to stdout for the hub to view.
+/* Determines the moves of the player if they are leading the round,
+ * by playing the lowest card of the first suit held.
  */
-void determine_lead_move(struct Game* game) {
-    struct Card* cards = malloc(sizeof(struct Card));
-    char suitOrder[4] = {'D', 'H', 'S', 'C'};
-    
-    find_lowest(game, cards, suitOrder);
-
-    printf("PLAY%c%c\n", cards[0].suit, encode_rank(cards[0].rank));
-    fflush(stdout);
-
-    char* playedCard = malloc(sizeof(char) * 3);
-    playedCard[0] = cards[0].suit;
-    playedCard[1] = encode_rank(cards[0].rank);
-    playedCard[2] = '\0'; 
-    strcpy(game->currentCard, playedCard);
-    free(playedCard);
-    remove_card(cards[0], game);
-    free(cards);
+static struct Card determine_lead_move(void* state, const struct Game* game) {
+    struct Card card;
+
+    (void)state;
+    find_lowest(game, &card, params.leadOrder);
+    return card;
 }
 
 
-/* Checks whether the lead player for the round is this current player.
- * If so, makes move based on this, and otherwise makes a non-lead move.
+/* The bob strategy, which keeps no state between moves.
  */
-void make_new_move(struct Game* game) {
-    if (game->leadPlayer == game->playerId) {
-        determine_lead_move(game);
-    } else {
-        determine_regular_move(game);
-    }
+static struct Strategy bob = {
+    .abiVersion = STRATEGY_ABI_VERSION,
+    .name = "bob",
+    .version = 1,
+    .lead = determine_lead_move,
+    .pureLead = true,
+    .follow = determine_regular_move,
+    .pureFollow = true,
+};
+
+
+/* Returns the bob strategy, playing with the parameters in BOB_PARAMS if
+ * it is set, or NULL if they are not valid.
+ */
+const struct Strategy* strategy_entry(void) {
+    const char* text = getenv(BOB_PARAMS_ENV);
 
-    game->hasPlayed = true;
-    strcat(game->cardsPlayed, game->currentCard);
-    game->numCardsPlayed++;
+    bob_default_params(&params);
+    if (text) {
+        if (!bob_parse_params(text, &params)) {
+            return NULL;
+        }
+        bob_format_params(&params, paramsText);
+        bob.params = paramsText;
+    }
 
+    return &bob;
 }
-
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "bobparams.h"
+
+
+/* Sets params to the rules bob has always played.
+ */
+void bob_default_params(struct BobParams* params) {
+    params->margin = 2;
+    memcpy(params->leadOrder, "DHSC", NUM_SUITS);
+    memcpy(params->duckOrder, "SCDH", NUM_SUITS);
+    memcpy(params->winOrder, "SCHD", NUM_SUITS);
+}
+
+
+/* Parses one order of suits ending at a comma or the end of the text into
+ * order. Returns the text after it, or NULL if it does not name every suit
+ * exactly once.
+ */
+static const char* parse_order(const char* text, char* order) {
+    bool seen[NUM_SUITS] = {false};
+
+    for (int i = 0; i < NUM_SUITS; i++) {
+        int suit = suit_index(text[i]);
+
+        if (suit < 0 || seen[suit]) {
+            return NULL;
+        }
+        seen[suit] = true;
+        order[i] = text[i];
+    }
+
+    return text + NUM_SUITS;
+}
+
+
+/* Parses parameters written as margin,lead,duck,win such as 2,DHSC,SCDH,SCHD
+ * into params, the margin at most BOB_MAX_MARGIN either way and each
+ * order naming every suit once. Returns false, leaving params unchanged,
+ * if the text is not valid.
+ */
+bool bob_parse_params(const char* text, struct BobParams* params) {
+    struct BobParams parsed;
+    char* end;
+    const char* next;
+
+    parsed.margin = strtol(text, &end, 10);
+    if (end == text || *end != ',' || parsed.margin > BOB_MAX_MARGIN ||
+            parsed.margin < -BOB_MAX_MARGIN) {
+        return false;
+    }
+
+    next = parse_order(end + 1, parsed.leadOrder);
+    if (!next || *next != ',') {
+        return false;
+    }
+    next = parse_order(next + 1, parsed.duckOrder);
+    if (!next || *next != ',') {
+        return false;
+    }
+    next = parse_order(next + 1, parsed.winOrder);
+    if (!next || *next) {
+        return false;
+    }
+
+    *params = parsed;
+    return true;
+}
+
+
+/* Writes parameters as bob_parse_params reads them into text, which has
+ * space for BOB_PARAMS_LENGTH characters.
+ */
+void bob_format_params(const struct BobParams* params, char* text) {
+    sprintf(text, "%d,%.*s,%.*s,%.*s", params->margin,
+            NUM_SUITS, params->leadOrder, NUM_SUITS, params->duckOrder,
+            NUM_SUITS, params->winOrder);
+}
+
+
+/* Returns true if two sets of parameters are the same.
+ */
+bool bob_same_params(const struct BobParams* a, const struct BobParams* b) {
+    return a->margin == b->margin &&
+            !memcmp(a->leadOrder, b->leadOrder, NUM_SUITS) &&
+            !memcmp(a->duckOrder, b->duckOrder, NUM_SUITS) &&
+            !memcmp(a->winOrder, b->winOrder, NUM_SUITS);
+}
@@ -0,0 +1,69 @@
+#ifndef BOBPARAMS_H
+#define BOBPARAMS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "utilities.h"
+
+
+/* The environment variable giving bob's parameters, as written by
+ * bob_format_params. Without it bob plays with the defaults.
+ */
+#define BOB_PARAMS_ENV "BOB_PARAMS"
+
+
+/* The largest margin either way, so that its text is at most 3 long.
+ */
+#define BOB_MAX_MARGIN 99
+
+
+/* The longest text of a set of parameters, with its terminator.
+ */
+#define BOB_PARAMS_LENGTH (4 + 3 * (NUM_SUITS + 1))
+
+
+/* The constants of the bob strategy. The defaults are the rules bob has
+ * always played, given by bob_default_params.
+ */
+struct BobParams {
+    // bob tries to win a round with a diamond played in it once some
+    // player has won the threshold less this many diamonds (2)
+    int margin;
+    // The suits bob leads the lowest card of the first held in (DHSC)
+    char leadOrder[NUM_SUITS];
+    // The suits bob discards the highest card of the first held in, when
+    // not trying to win the round (SCDH)
+    char duckOrder[NUM_SUITS];
+    // The suits bob discards the lowest card of the first held in, when
+    // trying to win the round without the lead suit (SCHD)
+    char winOrder[NUM_SUITS];
+};
+
+
+/* Sets params to the rules bob has always played.
+ */
+void bob_default_params(struct BobParams* params);
+
+
+/* Parses parameters written as margin,lead,duck,win such as 2,DHSC,SCDH,SCHD
+ * into params, the margin at most BOB_MAX_MARGIN either way and each
+ * order naming every suit once. Returns false, leaving params unchanged,
+ * if the text is not valid.
+ */
+bool bob_parse_params(const char* text, struct BobParams* params);
+
+
+/* Writes parameters as bob_parse_params reads them into text, which has
+ * space for BOB_PARAMS_LENGTH characters.
+ */
+void bob_format_params(const struct BobParams* params, char* text);
+
+
+/* Returns true if two sets of parameters are the same.
+ */
+bool bob_same_params(const struct BobParams* a, const struct BobParams* b);
+
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utilities.h"
+#include "canon.h"
+
+
+/* Computes the canonical form of a game which has been dealt but not
+ * started.
+ */
+void canon_deal(struct Canon* canon, const struct ModelState* state) {
+    canon->numPlayers = state->numPlayers;
+    for (int p = 0; p < state->numPlayers; p++) {
+        canon->hands[p] = state->hands[p];
+    }
+
+    canon->hash = mix_hash(0, canon->numPlayers);
+    for (int p = 0; p < canon->numPlayers; p++) {
+        canon->hash = mix_hash(canon->hash, canon->hands[p]);
+    }
+}
+
+
+/* Returns true if two canonical forms are the same.
+ */
+bool canon_equal(const struct Canon* first, const struct Canon* second) {
+    return first->hash == second->hash &&
+            first->numPlayers == second->numPlayers &&
+            !memcmp(first->hands, second->hands,
+            sizeof(uint64_t) * first->numPlayers);
+}
+
+
+/* Groups games into their equivalence classes. classes[i] is set to the
+ * index of the first game with the same canonical form as game i, which is
+ * i itself for the first game of each class. Returns the number of classes.
+ * The first games of the classes are kept in an open addressing table of
+ * at least twice as many slots as games.
+ */
+int canon_classes(const struct Canon* canons, int numGames, int* classes) {
+    int numSlots = 2;
+    int numClasses = 0;
+    int* slots;
+
+    while (numSlots < 2 * numGames) {
+        numSlots *= 2;
+    }
+    slots = malloc(sizeof(int) * numSlots);
+    memset(slots, -1, sizeof(int) * numSlots);
+
+    for (int i = 0; i < numGames; i++) {
+        int slot = canons[i].hash & (numSlots - 1);
+
+        while (slots[slot] >= 0 &&
+                !canon_equal(&canons[slots[slot]], &canons[i])) {
+            slot = (slot + 1) & (numSlots - 1);
+        }
+
+        if (slots[slot] < 0) {
+            slots[slot] = i;
+            numClasses++;
+        }
+        classes[i] = slots[slot];
+    }
+
+    free(slots);
+    return numClasses;
+}
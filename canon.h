@@ -0,0 +1,45 @@
+#ifndef CANON_H
+#define CANON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+
+
+/* The canonical form of a dealt game. Two decks whose games are the same
+ * for every player up to the order of each hand and the cards left undealt
+ * have the same form. Suits are never relabelled, since every strategy
+ * ranks the suits in its own fixed orders.
+ */
+struct Canon {
+    // The number of players in the game
+    int numPlayers;
+    // The cards dealt to each player
+    uint64_t hands[MODEL_MAX_PLAYERS];
+    // A hash of the hands
+    uint64_t hash;
+};
+
+
+/* Computes the canonical form of a game which has been dealt but not
+ * started.
+ */
+void canon_deal(struct Canon* canon, const struct ModelState* state);
+
+
+/* Returns true if two canonical forms are the same.
+ */
+bool canon_equal(const struct Canon* first, const struct Canon* second);
+
+
+/* Groups games into their equivalence classes. classes[i] is set to the
+ * index of the first game with the same canonical form as game i, which is
+ * i itself for the first game of each class. Returns the number of classes.
+ */
+int canon_classes(const struct Canon* canons, int numGames, int* classes);
+
+
+#endif
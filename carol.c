@@ -0,0 +1,606 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "players.h"
+#include "strategy.h"
+#include "model.h"
+#include "carol.h"
+#include "utilities.h"
+
+
+/* The number of tree nodes each search thread may allocate per move.
+ */
+#define CAROL_MAX_NODES (1 << 16)
+
+
+/* The exploration constant of the tree policy.
+ */
+#define CAROL_EXPLORATION 0.7
+
+
+/* How many iterations are run between checks of the clock.
+ */
+#define CAROL_CLOCK_INTERVAL 16
+
+
+/* A node of an information set search tree. Children are linked
+ * through their first child and next sibling indices, with 0 meaning
+ * none since the root is never a child.
+ */
+struct Node {
+    // The index of the first child of this node
+    int firstChild;
+    // The index of the next child of this node's parent
+    int nextSibling;
+    // The card played to reach this node
+    int card;
+    // The player who played the card
+    int player;
+    // The number of iterations through this node
+    unsigned visits;
+    // The number of iterations in which this node could have been chosen
+    unsigned availability;
+    // The total reward of the player over the iterations
+    double reward;
+};
+
+
+/* The private state of one search thread.
+ */
+struct Search {
+    // The game being searched, shared by all threads
+    const struct Carol* carol;
+    // The tree of this thread
+    struct Node* nodes;
+    // The number of nodes in use
+    int numNodes;
+    // The state of the random number generator
+    uint64_t random;
+    // The number of playouts completed in this move
+    long playouts;
+    // The thread running the search
+    pthread_t thread;
+};
+
+
+/* What carol knows about a game, and her search threads.
+ */
+struct Carol {
+    // This player's id
+    int playerId;
+    // The initial hand size, used to scale rewards
+    int initialHandSize;
+    // The game as seen by this player, with only this player's hand known
+    struct ModelState known;
+    // The model engine for the game's number of players
+    const struct ModelEngine* engine;
+    // The cards played so far, copied from the player's knowledge
+    uint64_t seen;
+    // The suits each player is known not to hold, one bit per suit slot
+    unsigned voids[MODEL_MAX_PLAYERS];
+    // The time budget per move
+    struct timespec budget;
+    // The time at which the current search must stop
+    struct timespec deadline;
+    // The number of search threads
+    int numThreads;
+    // The search state of each thread
+    struct Search* searches;
+    // The total number of playouts over the game
+    long totalPlayouts;
+    // The total time spent searching over the game, in seconds
+    double totalSeconds;
+};
+
+
+// The configuration given by carol_configure, or -1 to use the environment
+static int configuredBudget = -1;
+static int configuredThreads = -1;
+
+
+/* Sets the time budget of each move in milliseconds, and the number of
+ * search threads (0 for one per online core). Must be called before the
+ * game starts. Without it the CAROL_BUDGET_MS and CAROL_THREADS environment
+ * variables are used, so that the plugin can be configured too.
+ */
+void carol_configure(int budgetMs, int threads) {
+    configuredBudget = budgetMs;
+    configuredThreads = threads;
+}
+
+
+/* Returns a configuration value, taken from carol_configure, or the
+ * environment, or the default otherwise.
+ */
+static int configuration(int configured, const char* name, int fallback) {
+    const char* value = getenv(name);
+
+    if (configured >= 0) {
+        return configured;
+    }
+
+    if (value && atoi(value) >= 0) {
+        return atoi(value);
+    }
+
+    return fallback;
+}
+
+
+/* Returns true if the time a is later than or equal to time b.
+ */
+static bool time_reached(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec > b->tv_sec ||
+            (a->tv_sec == b->tv_sec && a->tv_nsec >= b->tv_nsec);
+}
+
+
+/* Returns the seconds between two times.
+ */
+static double elapsed(const struct timespec* start,
+        const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) +
+            (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/* Deals the cards carol cannot see to the other players, giving each the
+ * number of cards they hold and avoiding suits they are known to lack.
+ * If the voids cannot all be honoured they are ignored for the remaining
+ * cards, so that every player still gets a full hand.
+ */
+static void determinise(struct Search* search, struct ModelState* state) {
+    const struct Carol* carol = search->carol;
+    int me = carol->playerId;
+    uint64_t unknown = MODEL_ALL_CARDS & ~carol->seen & ~state->hands[me];
+    int cards[64];
+    int numCards = 0;
+    int needed[MODEL_MAX_PLAYERS];
+    int start;
+
+    while (unknown) {
+        cards[numCards++] = model_lowest_card(unknown);
+        unknown &= unknown - 1;
+    }
+
+    for (int i = numCards - 1; i > 0; i--) {
+        int j = (int)(model_random(&search->random) % (uint64_t)(i + 1));
+        int card = cards[i];
+
+        cards[i] = cards[j];
+        cards[j] = card;
+    }
+
+    for (int i = 0; i < state->numPlayers; i++) {
+        needed[i] = i == me ? 0 : state->handCounts[i];
+        if (i != me) {
+            state->hands[i] = 0;
+        }
+    }
+
+    start = (int)(model_random(&search->random) % (uint64_t)state->numPlayers);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < numCards; i++) {
+            int suit = cards[i] / MODEL_SUIT_BITS;
+
+            if (cards[i] < 0) {
+                continue;
+            }
+
+            for (int j = 0; j < state->numPlayers; j++) {
+                int player = (start + i + j) % state->numPlayers;
+
+                if (!needed[player] ||
+                        (!pass && (carol->voids[player] >> suit & 1))) {
+                    continue;
+                }
+
+                state->hands[player] |= (uint64_t)1 << cards[i];
+                needed[player]--;
+                cards[i] = -1;
+                break;
+            }
+        }
+    }
+}
+
+
+/* Returns the reward of a player at the end of a game: their score less
+ * the average score of the other players, scaled to about one.
+ */
+static double reward(const struct Carol* carol,
+        const struct ModelState* state, int player) {
+    return carol->engine->margin(state, player) /
+            (2.0 * carol->initialHandSize);
+}
+
+
+/* Adds a child for the given card to a node and returns its index.
+ */
+static int add_child(struct Search* search, int parent, int card,
+        int player) {
+    int index = search->numNodes++;
+    struct Node* child = &search->nodes[index];
+
+    child->firstChild = 0;
+    child->nextSibling = search->nodes[parent].firstChild;
+    child->card = card;
+    child->player = player;
+    child->visits = 0;
+    child->availability = 0;
+    child->reward = 0;
+    search->nodes[parent].firstChild = index;
+    return index;
+}
+
+
+/* Chooses the child to descend into among those playable in the current
+ * determinisation, using the upper confidence bound adjusted for how
+ * often each child was available. Returns 0 if there is none.
+ */
+static int select_child(struct Search* search, int parent, uint64_t legal) {
+    int best = 0;
+    double bestValue = -INFINITY;
+
+    for (int i = search->nodes[parent].firstChild; i;
+            i = search->nodes[i].nextSibling) {
+        struct Node* child = &search->nodes[i];
+        double value;
+
+        if (!(legal >> child->card & 1)) {
+            continue;
+        }
+
+        child->availability++;
+        value = child->reward / child->visits + CAROL_EXPLORATION *
+                sqrt(log(child->availability) / child->visits);
+        if (value > bestValue) {
+            best = i;
+            bestValue = value;
+        }
+    }
+
+    return best;
+}
+
+
+/* Runs one iteration of the search: determinises the hidden hands, walks
+ * down the tree, expands one new node, plays the game out and updates
+ * every node on the path with the reward of the player who chose it.
+ */
+static void iterate(struct Search* search) {
+    struct ModelState state = search->carol->known;
+    int path[64];
+    int depth = 0;
+    int node = 0;
+
+    determinise(search, &state);
+
+    while (!model_is_over(&state)) {
+        uint64_t legal = model_legal_moves(&state);
+        uint64_t untried = legal;
+        int player = state.currentPlayer;
+
+        for (int i = search->nodes[node].firstChild; i;
+                i = search->nodes[i].nextSibling) {
+            untried &= ~((uint64_t)1 << search->nodes[i].card);
+        }
+
+        if (untried && search->numNodes < CAROL_MAX_NODES) {
+            int card = model_random_card(&search->random, untried);
+
+            node = add_child(search, node, card, player);
+            search->nodes[node].availability++;
+            path[depth++] = node;
+            model_play(&state, card);
+            break;
+        }
+
+        node = select_child(search, node, legal & ~untried);
+        if (!node) {
+            break;
+        }
+
+        path[depth++] = node;
+        model_play(&state, search->nodes[node].card);
+    }
+
+    search->carol->engine->playOut(&state, &search->random);
+    search->playouts++;
+
+    for (int i = 0; i < depth; i++) {
+        struct Node* visited = &search->nodes[path[i]];
+
+        visited->visits++;
+        visited->reward += reward(search->carol, &state, visited->player);
+    }
+}
+
+
+/* The body of a search thread, iterating until the deadline.
+ */
+static void* run_search(void* arg) {
+    struct Search* search = arg;
+    struct timespec now;
+
+    do {
+        for (int i = 0; i < CAROL_CLOCK_INTERVAL; i++) {
+            iterate(search);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (!time_reached(&now, &search->carol->deadline));
+
+    return NULL;
+}
+
+
+/* Searches the current position on every thread until the budget runs out,
+ * and returns the card whose node was visited most over all threads.
+ */
+static int search_move(struct Carol* carol, uint64_t legal) {
+    unsigned visits[64] = {0};
+    struct timespec start;
+    struct timespec end;
+    int best = model_lowest_card(legal);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    carol->deadline.tv_sec = start.tv_sec + carol->budget.tv_sec;
+    carol->deadline.tv_nsec = start.tv_nsec + carol->budget.tv_nsec;
+    if (carol->deadline.tv_nsec >= 1000000000L) {
+        carol->deadline.tv_sec++;
+        carol->deadline.tv_nsec -= 1000000000L;
+    }
+
+    for (int i = 0; i < carol->numThreads; i++) {
+        struct Search* search = &carol->searches[i];
+
+        search->numNodes = 1;
+        search->nodes[0].firstChild = 0;
+        search->playouts = 0;
+        if (i && pthread_create(&search->thread, NULL, run_search, search)) {
+            // run with fewer threads rather than fail the move
+            search->thread = pthread_self();
+        }
+    }
+
+    run_search(&carol->searches[0]);
+
+    for (int i = 0; i < carol->numThreads; i++) {
+        struct Search* search = &carol->searches[i];
+
+        if (i && !pthread_equal(search->thread, pthread_self())) {
+            pthread_join(search->thread, NULL);
+        }
+
+        for (int j = search->nodes[0].firstChild; j;
+                j = search->nodes[j].nextSibling) {
+            visits[search->nodes[j].card] += search->nodes[j].visits;
+        }
+        carol->totalPlayouts += search->playouts;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    carol->totalSeconds += elapsed(&start, &end);
+
+    for (int card = 0; card < 64; card++) {
+        if ((legal >> card & 1) && visits[card] > visits[best]) {
+            best = card;
+        }
+    }
+
+    return best;
+}
+
+
+/* Chooses a card for this player by searching from the known state of
+ * the game with this player's current hand.
+ */
+static struct Card choose_card(void* state, const struct Game* game) {
+    struct Carol* carol = state;
+    struct ModelState* known = &carol->known;
+    int me = carol->playerId;
+    uint64_t legal;
+    struct Card card;
+    int choice;
+
+    known->hands[me] = 0;
+    for (int i = 0; i < game->handSize; i++) {
+        known->hands[me] |= (uint64_t)1 << model_card(game->hand[i].suit,
+                game->hand[i].rank);
+    }
+    known->handCounts[me] = game->handSize;
+    known->currentPlayer = me;
+
+    carol->seen = 0;
+    for (int i = 0; i < NUM_SUITS; i++) {
+        carol->seen |= (uint64_t)game->knowledge.seen[i] <<
+                (i * MODEL_SUIT_BITS);
+    }
+    for (int i = 0; i < game->numPlayers; i++) {
+        carol->voids[i] = game->knowledge.voids[i];
+    }
+
+    legal = model_legal_moves(known);
+    if (model_count(legal) == 1) {
+        choice = model_lowest_card(legal);
+    } else {
+        choice = search_move(carol, legal);
+    }
+
+    card.suit = model_card_suit(choice);
+    card.rank = model_card_rank(choice);
+    return card;
+}
+
+
+/* Records a card played by any player, so that the rounds won by each
+ * player are known when searching.
+ */
+static void observe_card(void* state, const struct Game* game, int player,
+        struct Card card) {
+    struct Carol* carol = state;
+
+    (void)game;
+    carol->known.currentPlayer = player;
+    model_play(&carol->known, model_card(card.suit, card.rank));
+}
+
+
+/* Prepares carol's knowledge for a new game with the same arguments.
+ */
+static void reset_game(void* state, const struct Game* game) {
+    struct Carol* carol = state;
+
+    model_init(&carol->known, game->numPlayers, game->threshold,
+            game->handSize);
+    for (int i = 0; i < game->numPlayers; i++) {
+        carol->known.handCounts[i] = game->handSize;
+    }
+    carol->initialHandSize = game->handSize;
+    carol->engine = model_engine(game->numPlayers);
+}
+
+
+/* Creates carol's state and search threads for a game. Returns NULL if
+ * the game has more players than the model supports, in which case the
+ * fallback strategy is used.
+ */
+static void* init_carol(const struct Game* game) {
+    struct Carol* carol;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int budgetMs = configuration(configuredBudget, "CAROL_BUDGET_MS",
+            CAROL_DEFAULT_BUDGET_MS);
+
+    if (game->numPlayers > MODEL_MAX_PLAYERS) {
+        return NULL;
+    }
+
+    carol = calloc(1, sizeof(struct Carol));
+    carol->playerId = game->playerId;
+    carol->numThreads = configuration(configuredThreads, "CAROL_THREADS", 0);
+    if (carol->numThreads == 0) {
+        carol->numThreads = cores > 0 ? (int)cores : 1;
+    }
+    carol->budget.tv_sec = budgetMs / 1000;
+    carol->budget.tv_nsec = (budgetMs % 1000) * 1000000L;
+
+    carol->searches = calloc(carol->numThreads, sizeof(struct Search));
+    for (int i = 0; i < carol->numThreads; i++) {
+        carol->searches[i].carol = carol;
+        carol->searches[i].nodes = malloc(sizeof(struct Node) *
+                CAROL_MAX_NODES);
+        carol->searches[i].random = 0x9e3779b97f4a7c15ULL *
+                (uint64_t)(i + 1) ^ (uint64_t)getpid();
+    }
+
+    reset_game(carol, game);
+    return carol;
+}
+
+
+/* Reports the search throughput of the game to stderr and releases
+ * carol's state.
+ */
+static void release_carol(void* state) {
+    struct Carol* carol = state;
+
+    if (!carol) {
+        return;
+    }
+
+    fprintf(stderr, "carol: %ld playouts in %.3fs (%.0f playouts/s, "
+            "%d threads)\n", carol->totalPlayouts, carol->totalSeconds,
+            carol->totalSeconds > 0 ?
+            carol->totalPlayouts / carol->totalSeconds : 0.0,
+            carol->numThreads);
+
+    for (int i = 0; i < carol->numThreads; i++) {
+        free(carol->searches[i].nodes);
+    }
+    free(carol->searches);
+    free(carol);
+}
+
+
+/* Chooses a lead card, falling back to the highest card of the first
+ * suit held when the game is too large to search.
+ */
+static struct Card determine_lead_move(void* state, const struct Game* game) {
+    struct Card card;
+    const char suitOrder[NUM_SUITS] = {'S', 'C', 'D', 'H'};
+
+    if (state) {
+        return choose_card(state, game);
+    }
+
+    find_highest(game, &card, suitOrder);
+    return card;
+}
+
+
+/* Chooses a following card, falling back to the lowest card of the lead
+ * suit (or highest card otherwise) when the game is too large to search.
+ */
+static struct Card determine_regular_move(void* state,
+        const struct Game* game) {
+    struct Card card;
+    const char suitOrder[NUM_SUITS] = {'D', 'H', 'S', 'C'};
+
+    if (state) {
+        return choose_card(state, game);
+    }
+
+    if (!find_lowest_suit(game, &card, game->leadCard.suit)) {
+        find_highest(game, &card, suitOrder);
+    }
+    return card;
+}
+
+
+/* Observes a card unless the game is too large to search.
+ */
+static void observe_move_card(void* state, const struct Game* game,
+        int player, struct Card card) {
+    if (state) {
+        observe_card(state, game, player, card);
+    }
+}
+
+
+/* Resets for a new game unless the game is too large to search.
+ */
+static void reset_carol(void* state, const struct Game* game) {
+    if (state) {
+        reset_game(state, game);
+    }
+}
+
+
+/* The carol strategy, an information set Monte Carlo tree search over the
+ * hands the other players might hold.
+ */
+static const struct Strategy carol = {
+    .abiVersion = STRATEGY_ABI_VERSION,
+    .name = "carol",
+    .version = 1,
+    .init = init_carol,
+    .lead = determine_lead_move,
+    .follow = determine_regular_move,
+    .observe = observe_move_card,
+    .reset = reset_carol,
+    .release = release_carol,
+};
+
+
+/* Returns the carol strategy.
+ */
+const struct Strategy* strategy_entry(void) {
+    return &carol;
+}
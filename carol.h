@@ -0,0 +1,18 @@
+#ifndef CAROL_H
+#define CAROL_H
+
+
+/* The time each move is searched for when no budget is given.
+ */
+#define CAROL_DEFAULT_BUDGET_MS 100
+
+
+/* Sets the time budget of each move in milliseconds, and the number of
+ * search threads (0 for one per online core). Must be called before the
+ * game starts. Without it the CAROL_BUDGET_MS and CAROL_THREADS environment
+ * variables are used, so that the plugin can be configured too.
+ */
+void carol_configure(int budgetMs, int threads);
+
+
+#endif
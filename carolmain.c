@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "players.h"
+#include "strategy.h"
+#include "carol.h"
+
+
+/* The 2310carol player program. It takes the usual player arguments,
+ * optionally followed by the time budget of each move in milliseconds
+ * and the number of search threads.
+ */
+int main(int argc, char** argv) {
+    int budgetMs = -1;
+    int threads = -1;
+
+    if (argc == 6 || argc == 7) {
+        if (check_valid_number(argv[5], ARGUMENT_LENGTH, &budgetMs) ||
+                (argc == 7 && check_valid_number(argv[6], ARGUMENT_LENGTH,
+                &threads))) {
+            handle_game_over(ARGUMENT_LENGTH);
+        }
+        argc = 5;
+    }
+
+    carol_configure(budgetMs, threads);
+    return run_player(strategy_entry(), argc, argv);
+}
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "columns.h"
+
+
+// The size of the fixed part of the file header
+#define HEADER_SIZE 24
+
+// The size of a block header
+#define BLOCK_HEADER_SIZE 16
+
+
+/* Returns a size rounded up to a multiple of 8.
+ */
+static size_t padded(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+
+/* Returns the size of a block of the given number of rows.
+ */
+static size_t block_size(size_t rows) {
+    return BLOCK_HEADER_SIZE + 3 * padded(rows * 4) + 2 * padded(rows * 2) +
+            2 * padded(rows);
+}
+
+
+/* Writes a column padded to a multiple of 8 bytes.
+ */
+static void write_column(FILE* output, const void* column, size_t size) {
+    static const char zeros[8] = {0};
+
+    fwrite(column, 1, size, output);
+    fwrite(zeros, 1, padded(size) - size, output);
+}
+
+
+/* Creates a columnar results file for games with the given number of
+ * seats, whose programs are named in names. Returns NULL if the file
+ * cannot be created.
+ */
+struct ColumnWriter* columns_create(const char* path, int numSeats,
+        char** names, int numNames) {
+    static const char zeros[8] = {0};
+    struct ColumnWriter* writer;
+    uint32_t counts[2] = {numSeats, numNames};
+    uint64_t headerSize = HEADER_SIZE;
+    FILE* output;
+
+    if (numSeats > COLUMNS_MAX_SEATS || numNames > COLUMNS_MAX_NAMES ||
+            !(output = fopen(path, "w"))) {
+        return NULL;
+    }
+
+    for (int i = 0; i < numNames; i++) {
+        headerSize += strlen(names[i]) + 1;
+    }
+    headerSize = padded(headerSize);
+
+    fwrite(COLUMNS_MAGIC, 1, 8, output);
+    fwrite(counts, sizeof(uint32_t), 2, output);
+    fwrite(&headerSize, sizeof(uint64_t), 1, output);
+    for (int i = 0; i < numNames; i++) {
+        fwrite(names[i], 1, strlen(names[i]) + 1, output);
+    }
+    fwrite(zeros, 1, headerSize - ftell(output), output);
+
+    writer = malloc(sizeof(struct ColumnWriter));
+    writer->output = output;
+    writer->numSeats = numSeats;
+    writer->rows = 0;
+    return writer;
+}
+
+
+/* Writes the rows kept in memory as a block.
+ */
+static void write_block(struct ColumnWriter* writer) {
+    size_t rows = writer->rows;
+    uint32_t counts[2] = {rows, 0};
+    uint64_t size = block_size(rows);
+
+    fwrite(counts, sizeof(uint32_t), 2, writer->output);
+    fwrite(&size, sizeof(uint64_t), 1, writer->output);
+    write_column(writer->output, writer->deck, rows * sizeof(uint32_t));
+    write_column(writer->output, writer->score, rows * sizeof(int32_t));
+    write_column(writer->output, writer->threshold, rows * sizeof(int32_t));
+    write_column(writer->output, writer->rounds, rows * sizeof(uint16_t));
+    write_column(writer->output, writer->diamonds, rows * sizeof(uint16_t));
+    write_column(writer->output, writer->seat, rows);
+    write_column(writer->output, writer->program, rows);
+    writer->rows = 0;
+}
+
+
+/* Adds the row of one seat of a game. Seats must be added in order. A
+ * block is only written between games, so that no game spans two blocks.
+ */
+void columns_add(struct ColumnWriter* writer, uint32_t deck, int seat,
+        int program, int score, int threshold, int rounds, int diamonds) {
+    int row;
+
+    if (seat == 0 && writer->rows + writer->numSeats > COLUMNS_BLOCK_ROWS) {
+        write_block(writer);
+    }
+
+    row = writer->rows++;
+    writer->deck[row] = deck;
+    writer->score[row] = score;
+    writer->threshold[row] = threshold;
+    writer->rounds[row] = rounds;
+    writer->diamonds[row] = diamonds;
+    writer->seat[row] = seat;
+    writer->program[row] = program;
+}
+
+
+/* Writes the last block and closes the file. Returns false if any write
+ * failed.
+ */
+bool columns_close(struct ColumnWriter* writer) {
+    bool written;
+
+    if (writer->rows) {
+        write_block(writer);
+    }
+
+    written = !ferror(writer->output);
+    written = !fclose(writer->output) && written;
+    free(writer);
+    return written;
+}
+
+
+/* Maps a columnar results file for reading. Returns false if it cannot be
+ * read or is not a valid columnar results file.
+ */
+bool columns_open(struct ColumnReader* reader, const char* path) {
+    struct stat info;
+    uint32_t counts[2];
+    uint64_t headerSize;
+    const char* name;
+    void* mapping;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (fstat(fd, &info) || info.st_size < HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+
+    mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    reader->mapping = mapping;
+    reader->size = info.st_size;
+    memcpy(counts, reader->mapping + 8, sizeof(counts));
+    memcpy(&headerSize, reader->mapping + 16, sizeof(headerSize));
+
+    if (memcmp(reader->mapping, COLUMNS_MAGIC, 8) || counts[0] < 1 ||
+            counts[0] > COLUMNS_MAX_SEATS || counts[1] > COLUMNS_MAX_NAMES ||
+            headerSize < HEADER_SIZE || headerSize > reader->size ||
+            headerSize % 8) {
+        columns_release(reader);
+        return false;
+    }
+
+    reader->numSeats = counts[0];
+    reader->numNames = counts[1];
+    reader->next = headerSize;
+
+    name = (const char*)reader->mapping + HEADER_SIZE;
+    for (int i = 0; i < reader->numNames; i++) {
+        const char* end = memchr(name, '\0',
+                (const char*)reader->mapping + headerSize - name);
+
+        if (!end) {
+            columns_release(reader);
+            return false;
+        }
+        reader->names[i] = name;
+        name = end + 1;
+    }
+
+    return true;
+}
+
+
+/* Points block at the columns of the next block. Returns false at the end
+ * of the file, or if the block is not valid.
+ */
+bool columns_next(struct ColumnReader* reader, struct ColumnBlock* block) {
+    const unsigned char* column = reader->mapping + reader->next;
+    uint32_t counts[2];
+    uint64_t size;
+    size_t rows;
+
+    if (reader->size - reader->next < BLOCK_HEADER_SIZE) {
+        return false;
+    }
+
+    memcpy(counts, column, sizeof(counts));
+    memcpy(&size, column + 8, sizeof(size));
+    rows = counts[0];
+    if (rows > COLUMNS_BLOCK_ROWS || size != block_size(rows) ||
+            size > reader->size - reader->next) {
+        return false;
+    }
+
+    column += BLOCK_HEADER_SIZE;
+    block->rows = rows;
+    block->deck = (const uint32_t*)column;
+    column += padded(rows * sizeof(uint32_t));
+    block->score = (const int32_t*)column;
+    column += padded(rows * sizeof(int32_t));
+    block->threshold = (const int32_t*)column;
+    column += padded(rows * sizeof(int32_t));
+    block->rounds = (const uint16_t*)column;
+    column += padded(rows * sizeof(uint16_t));
+    block->diamonds = (const uint16_t*)column;
+    column += padded(rows * sizeof(uint16_t));
+    block->seat = column;
+    column += padded(rows);
+    block->program = column;
+
+    reader->next += size;
+    return true;
+}
+
+
+/* Returns true if every block was read and valid.
+ */
+bool columns_done(const struct ColumnReader* reader) {
+    return reader->next == reader->size;
+}
+
+
+/* Unmaps a columnar results file.
+ */
+void columns_release(struct ColumnReader* reader) {
+    munmap((void*)reader->mapping, reader->size);
+}
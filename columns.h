@@ -0,0 +1,145 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/* The first bytes of a columnar results file, with its version.
+ */
+#define COLUMNS_MAGIC "2310col1"
+
+
+/* The most rows in one block. A block's columns are each at most 4 bytes
+ * wide, so a block is at most about 1MB.
+ */
+#define COLUMNS_BLOCK_ROWS 65536
+
+
+/* The most seats in a game and the most distinct programs named in one
+ * file, so that seats and programs fit in one byte.
+ */
+#define COLUMNS_MAX_SEATS 256
+#define COLUMNS_MAX_NAMES 256
+
+
+/* Columnar results hold one row per seat of each game, with the seats of
+ * a game in consecutive rows. The file starts with a header:
+ *   8 bytes  COLUMNS_MAGIC
+ *   uint32   the number of seats in every game
+ *   uint32   the number of program names
+ *   uint64   the size of the header, a multiple of 8
+ *   the program names, each terminated by a zero byte, padded with zeros
+ * followed by blocks of up to COLUMNS_BLOCK_ROWS rows, each starting with
+ *   uint32   the number of rows
+ *   uint32   zero
+ *   uint64   the size of the block including these 16 bytes
+ * and then each column in turn, padded to a multiple of 8 bytes:
+ *   uint32   deck: the position of the game's deck in the corpus
+ *   int32    score: the seat's final score
+ *   int32    threshold: the game's threshold
+ *   uint16   rounds: the rounds the seat won
+ *   uint16   diamonds: the diamonds the seat won
+ *   uint8    seat: the seat
+ *   uint8    program: the index of the seat's program name
+ * Numbers are in the byte order of the machine writing the file, so that
+ * a reader can map the file and scan a column in place.
+ */
+struct ColumnBlock {
+    // The number of rows in the block
+    int rows;
+    // The columns, each holding one value per row
+    const uint32_t* deck;
+    const int32_t* score;
+    const int32_t* threshold;
+    const uint16_t* rounds;
+    const uint16_t* diamonds;
+    const uint8_t* seat;
+    const uint8_t* program;
+};
+
+
+/* A columnar results file being written. Rows are kept in memory until a
+ * block is full.
+ */
+struct ColumnWriter {
+    // The file written to
+    FILE* output;
+    // The number of seats in every game
+    int numSeats;
+    // The rows of the current block, one array per column
+    uint32_t deck[COLUMNS_BLOCK_ROWS];
+    int32_t score[COLUMNS_BLOCK_ROWS];
+    int32_t threshold[COLUMNS_BLOCK_ROWS];
+    uint16_t rounds[COLUMNS_BLOCK_ROWS];
+    uint16_t diamonds[COLUMNS_BLOCK_ROWS];
+    uint8_t seat[COLUMNS_BLOCK_ROWS];
+    uint8_t program[COLUMNS_BLOCK_ROWS];
+    // The number of rows in the current block
+    int rows;
+};
+
+
+/* A columnar results file mapped for reading.
+ */
+struct ColumnReader {
+    // The mapping of the whole file
+    const unsigned char* mapping;
+    // The size of the file
+    size_t size;
+    // The offset of the next block
+    size_t next;
+    // The number of seats in every game
+    int numSeats;
+    // The program names, pointing into the mapping
+    const char* names[COLUMNS_MAX_NAMES];
+    // The number of program names
+    int numNames;
+};
+
+
+/* Creates a columnar results file for games with the given number of
+ * seats, whose programs are named in names. Returns NULL if the file
+ * cannot be created.
+ */
+struct ColumnWriter* columns_create(const char* path, int numSeats,
+        char** names, int numNames);
+
+
+/* Adds the row of one seat of a game. Seats must be added in order.
+ */
+void columns_add(struct ColumnWriter* writer, uint32_t deck, int seat,
+        int program, int score, int threshold, int rounds, int diamonds);
+
+
+/* Writes the last block and closes the file. Returns false if any write
+ * failed.
+ */
+bool columns_close(struct ColumnWriter* writer);
+
+
+/* Maps a columnar results file for reading. Returns false if it cannot be
+ * read or is not a valid columnar results file.
+ */
+bool columns_open(struct ColumnReader* reader, const char* path);
+
+
+/* Points block at the columns of the next block. Returns false at the end
+ * of the file, or if the block is not valid.
+ */
+bool columns_next(struct ColumnReader* reader, struct ColumnBlock* block);
+
+
+/* Returns true if every block was read and valid.
+ */
+bool columns_done(const struct ColumnReader* reader);
+
+
+/* Unmaps a columnar results file.
+ */
+void columns_release(struct ColumnReader* reader);
+
+
+#endif
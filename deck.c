@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "utilities.h"
+#include "deck.h"
+
+
+/* Adds a path to the list of decks.
+ */
+static void add_deck(char*** decks, int* numDecks, char* path) {
+    *decks = realloc(*decks, sizeof(char*) * (*numDecks + 1));
+    (*decks)[(*numDecks)++] = path;
+}
+
+
+/* Orders deck paths by name.
+ */
+static int compare_paths(const void* first, const void* second) {
+    return strcmp(*(char* const*)first, *(char* const*)second);
+}
+
+
+/* Adds the deck files of a corpus, which is either a deck file or a
+ * directory of deck files, to the list of decks, which grows as needed.
+ * The files of a directory are added in order of name rather than in the
+ * order the directory lists them, so that a deck's position in the list
+ * is the same on every filesystem and run. Returns false if the corpus
+ * cannot be read or the list is left empty.
+ */
+bool deck_add_corpus(const char* corpus, char*** decks, int* numDecks) {
+    struct stat info;
+    DIR* directory;
+    struct dirent* entry;
+    int first = *numDecks;
+
+    if (stat(corpus, &info)) {
+        return false;
+    }
+
+    if (!S_ISDIR(info.st_mode)) {
+        add_deck(decks, numDecks, strdup(corpus));
+        return true;
+    }
+
+    directory = opendir(corpus);
+    if (!directory) {
+        return false;
+    }
+
+    while ((entry = readdir(directory))) {
+        char* path;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        path = malloc(strlen(corpus) + strlen(entry->d_name) + 2);
+        sprintf(path, "%s/%s", corpus, entry->d_name);
+        if (stat(path, &info) || !S_ISREG(info.st_mode)) {
+            free(path);
+            continue;
+        }
+
+        add_deck(decks, numDecks, path);
+    }
+
+    closedir(directory);
+    qsort(*decks + first, *numDecks - first, sizeof(char*), compare_paths);
+    return *numDecks > 0;
+}
+
+
+/* Loads a deck and deals each seat its hand, starting a game with the
+ * given threshold. Decks are read as the hub reads them, except that a
+ * card may only appear once, since the model keeps hands as sets. If
+ * cards is not NULL it is set to the cards of the deck in the order they
+ * are dealt, which the caller frees. Returns the status of the deck.
+ */
+enum DeckStatus deck_load(const char* path, int numSeats, int threshold,
+        struct ModelState* state, int** cards) {
+    FILE* deckFile = fopen(path, "r");
+    enum DeckStatus status = DECK_LOADED;
+    uint64_t dealt = 0;
+    int* dealing;
+    char* line;
+    char* end;
+    long count;
+
+    if (!deckFile) {
+        return DECK_INVALID;
+    }
+
+    line = get_line(deckFile);
+    count = line ? strtol(line, &end, 10) : 0;
+    if (!line || *end || count < 1) {
+        free(line);
+        fclose(deckFile);
+        return DECK_INVALID;
+    }
+    free(line);
+
+    dealing = malloc(sizeof(int) * count);
+    for (long i = 0; i < count && !status; i++) {
+        line = get_line(deckFile);
+
+        if (!line || strlen(line) != 2 || !valid_card(line[0], line[1]) ||
+                dealt >> model_card(line[0], decode_rank(line[1])) & 1) {
+            status = DECK_INVALID;
+        } else {
+            dealing[i] = model_card(line[0], decode_rank(line[1]));
+            dealt |= (uint64_t)1 << dealing[i];
+        }
+        free(line);
+    }
+    fclose(deckFile);
+
+    if (!status && count < numSeats) {
+        status = DECK_TOO_SMALL;
+    }
+
+    if (!status) {
+        int handSize = count / numSeats;
+
+        model_init(state, numSeats, threshold, handSize);
+        for (int i = 0; i < numSeats * handSize; i++) {
+            model_deal(state, i / handSize, dealing[i]);
+        }
+    }
+
+    if (!status && cards) {
+        *cards = dealing;
+    } else {
+        free(dealing);
+    }
+    return status;
+}
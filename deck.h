@@ -0,0 +1,40 @@
+#ifndef DECK_H
+#define DECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "model.h"
+
+
+/* The outcomes of loading a deck for the model, with the same values as
+ * the hub's exit statuses.
+ */
+enum DeckStatus {
+    DECK_LOADED = 0,
+    DECK_INVALID = 3,
+    DECK_TOO_SMALL = 4,
+};
+
+
+/* Adds the deck files of a corpus, which is either a deck file or a
+ * directory of deck files, to the list of decks, which grows as needed.
+ * The files of a directory are added in order of name, so that a deck's
+ * position in the list is the same on every filesystem and run. Returns
+ * false if the corpus cannot be read or the list is left empty.
+ */
+bool deck_add_corpus(const char* corpus, char*** decks, int* numDecks);
+
+
+/* Loads a deck and deals each seat its hand, starting a game with the
+ * given threshold. Decks are read as the hub reads them, except that a
+ * card may only appear once, since the model keeps hands as sets. If
+ * cards is not NULL it is set to the cards of the deck in the order they
+ * are dealt, which the caller frees. Returns the status of the deck.
+ */
+enum DeckStatus deck_load(const char* path, int numSeats, int threshold,
+        struct ModelState* state, int** cards);
+
+
+#endif
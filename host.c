@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "players.h"
+#include "strategy.h"
+
+
+/* The generic player program, 2310player, which loads its strategy from a
+ * plugin. The plugin is either given as the first argument, before the
+ * usual player arguments or a --listen, --multiplex or --zygote address,
+ * or named by the STRATEGY environment variable.
+ */
+int main(int argc, char** argv) {
+    const char* path = getenv("STRATEGY");
+    const char* error;
+    const struct Strategy* strategy;
+
+    if (argc == 6 || (argc == 4 && (!strcmp(argv[2], "--listen") ||
+            !strcmp(argv[2], "--multiplex") ||
+            !strcmp(argv[2], "--zygote")))) {
+        path = argv[1];
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+
+    if (!path) {
+        handle_game_over(ARGUMENT_LENGTH);
+    }
+
+    strategy = load_strategy(path, &error);
+    if (!strategy) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        handle_game_over(INVALID_STRATEGY);
+    }
+
+    return run_player(strategy, argc, argv);
+}
@@ -1,16 +1,28 @@
+// sched_setaffinity and the CPU_SET macros are GNU extensions
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <signal.h>
+#include <sched.h>
 #include <math.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <poll.h>
 #include <sys/wait.h>
+#include <sys/file.h>
+#include <sys/signalfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #include "utilities.h"
+#include "transport.h"
+#include "trace.h"
+#include "ledger.h"
 
 #define WRITE_END 1
 #define READ_END 0
@@ -18,6 +30,45 @@
 // A global variable to check whether SIGHUP has been called
 int signalOut = 0;
 
+// How long players have to exit by themselves after GAMEOVER before their
+// process group is killed, in milliseconds
+#define GAMEOVER_GRACE_MS 100
+
+// The most bytes queued for a player which is not reading them before it
+// is taken to have stalled
+#define OUTPUT_CAP (1 << 20)
+
+// The most bytes a player may send without ending its line before it is
+// taken to have stalled
+#define INPUT_CAP (1 << 16)
+
+// The most bytes read from a player at once
+#define READ_CHUNK 4096
+
+// The number of card slots in a hand: one per rank of each suit
+#define CARD_SLOTS (NUM_SUITS * (MAX_RANK + 1))
+
+// The size of a cache line, which each seat's hand is aligned to
+#define CACHE_LINE 64
+
+// The environment variable which turns on measuring cache misses
+#define CACHE_STATS "HUB_CACHE_STATS"
+
+// The environment variable which plays the game the given number of times
+// in one hub, or forever given 0, to check that memory stays flat
+#define SOAK_GAMES "HUB_SOAK"
+
+// The environment variable which places the hub and its players on cores
+#define PLACEMENT "HUB_PLACEMENT"
+
+// The file counting the hubs placed by the spread policies, shared by
+// every hub on the host
+#define SPREAD_COUNTER "/tmp/2310hub.spread"
+
+// The file listing the hyperthread siblings of a core
+#define SIBLINGS \
+        "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list"
+
 
 /* Defines all possible exit statuses of the hub program
  * and assigns them their relevant exit value.
@@ -33,6 +84,7 @@ enum ExitMessage {
     INVALID_MESSAGE = 7,
     INVALID_CARD = 8,
     INTERRUPTED = 9,
+    PLAYER_STALLED = 10,
 };
 
 
@@ -72,47 +124,81 @@ struct Deck {
 };
 
 
-/* Stores information regarding each player program.
+/* Bytes queued for a player or read from one, of which those before start
+ * have already been written or handled.
+ */
+struct Queue {
+    // The bytes, or NULL before any are queued
+    char* data;
+    // The first byte not yet written or handled
+    size_t start;
+    // The number of bytes in data
+    size_t length;
+    // The size of data
+    size_t size;
+};
+
+
+/* Stores information regarding each player program. Only used to talk to
+ * the player and to reap it, so none of it is touched by the scoring.
  */
 struct Player {
     // The player's id number
     int playerId;
-    // The process id of the child
+    // The process id of the child, or -1 for a player reached over a socket
+    // or forked by a zygote
     pid_t pid;
-    // The file to send information to the child
-    FILE* toChild;
-    // The file to receive information from the child
-    FILE* fromChild;
+    // The process id of a player forked by a zygote, which is not the hub's
+    // child and so is killed by its pid, or -1
+    pid_t forkedPid;
+    // A descriptor which becomes readable once the zygote's player exits,
+    // or -1 if there is none
+    int forkedExit;
+    // The descriptor to send information to the child, which never blocks,
+    // or -1 before the child is connected
+    int toChild;
+    // The descriptor to receive information from the child, or -1
+    int fromChild;
+    // The messages the child has not yet taken
+    struct Queue output;
+    // What the child has sent which has not yet been handled
+    struct Queue input;
+    // Whether the child left more than OUTPUT_CAP bytes queued, or sent
+    // more than INPUT_CAP without a newline
+    bool stalled;
     // The status of the child
     int status;
-    // The score of the player
-    int score;
-    // The number of diamonds the player currently holds
-    int diamondCardScore;
-    // String representation of cards in hand
-    char* hand;
+    // Whether the child has exited and been reaped
+    bool exited;
+};
+
+
+/* The state of every seat which is updated as cards are played, kept as
+ * one array per field so that leader tracking and scoring walk contiguous
+ * memory rather than a struct Player per seat.
+ */
+struct Seats {
+    // The score of each player
+    int* score;
+    // The number of diamonds each player has won
+    int* diamonds;
+    // The number of copies of each card in each player's hand, indexed by
+    // card_slot, wide enough for a hand of one card repeated. Each hand
+    // starts on a cache line
+    unsigned (*hands)[CARD_SLOTS];
 };
 
 
 /* The main way of tracking the current state of the game. Stores all
  * information concerning the game as well as handling the pipes between
- * programs.
+ * programs. The fields used every round come first, so that they share
+ * a cache line, and the set up and process state follows.
  */
 struct Game {
-    // The threshold for the game
-    int threshold;
-    // The total number of players in the game
-    int totalPlayers;
-    // All player programs
-    struct Player* players;
-    // The size of the deck
-    int deckSize;
     // The size of a hand
     int handSize;
-    // The deck containing deckSize cards
-    struct Deck deck;
-    // The current child program
-    int currentChild;
+    // The total number of players in the game
+    int totalPlayers;
     // The player leading a round
     int leadPlayer;
     // The lead suit of the lead player
@@ -127,6 +213,30 @@ struct Game {
     int currentRound;
     // All cards played in a round
     char* currentRoundCards;
+    // The scores and hands of each seat
+    struct Seats seats;
+    // The threshold for the game
+    int threshold;
+    // All player programs
+    struct Player* players;
+    // The size of the deck
+    int deckSize;
+    // The deck containing deckSize cards
+    struct Deck deck;
+    // The current child program
+    int currentChild;
+    // The process group of the game's players, or 0 before the first starts
+    pid_t processGroup;
+    // The signalfd reporting SIGCHLD, or -1 if it could not be created
+    int childSignals;
+    // The signal mask to restore in children before they run a player
+    sigset_t childMask;
+    // The counter of cache misses in the bookkeeping, or -1 if not measured
+    int cacheCounter;
+    // Whether the hub and its players are placed on the cores in placement
+    bool placed;
+    // The cores the hub and its players run on when placed
+    cpu_set_t placement;
 };
 
 
@@ -140,6 +250,17 @@ void child_handler(int s) {
 }
 
 
+/* Releases the player programs of the game arguments.
+ */
+void free_game_args(struct GameArgs* gameArgs) {
+    for (int i = 0; i < gameArgs->playerCount; i++) {
+        ledger_free(LEDGER_PLAYERS, gameArgs->players[i]);
+    }
+    ledger_free(LEDGER_PLAYERS, gameArgs->players);
+    gameArgs->players = NULL;
+}
+
+
 /* Determines the type of player programs to be executed. If the player type is
  * invalid then the relevant exit code is returned. If successful, all player
  * types are stored to be initialised later. Returns exit status 0 on success.
@@ -147,19 +268,25 @@ void child_handler(int s) {
 enum ExitMessage get_player_types(int argc, char* argv[], 
         struct GameArgs* gameArgs) {
     int size = argc - 3;
-    gameArgs->players = malloc(sizeof(char*) * size);
+    gameArgs->players = ledger_malloc(LEDGER_PLAYERS, sizeof(char*) * size);
     char alice[13] = "./2310alice";
     char bob[11] = "./2310bob";
+    char carol[13] = "./2310carol";
+    char player[14] = "./2310player";
 
     for (int i = 0; i < size; i++) {
-        if (strstr(argv[i], alice) != NULL) {
-            gameArgs->players[i] = malloc(sizeof(char) * 80);
-            strcpy(gameArgs->players[i], argv[i]);
-        } else if (strstr(argv[i], bob) != NULL) {
-            gameArgs->players[i] = malloc(sizeof(char) * 80);
-            strcpy(gameArgs->players[i], argv[i]);
+        // a player listening on a socket, a zygote or a player program,
+        // where the generic player may name its plugin as program:plugin
+        if (is_address(argv[i]) || is_zygote(argv[i]) ||
+                strstr(argv[i], player) != NULL ||
+                strstr(argv[i], alice) != NULL ||
+                strstr(argv[i], bob) != NULL ||
+                strstr(argv[i], carol) != NULL) {
+            gameArgs->players[i] = strdup(argv[i]);
+            ledger_track(LEDGER_PLAYERS, gameArgs->players[i]);
         } else {
-            free(gameArgs->players);
+            gameArgs->playerCount = i;
+            free_game_args(gameArgs);
             return PLAYER_ERROR;
         }
     }
@@ -179,7 +306,6 @@ enum ExitMessage check_valid_args(struct GameArgs* gameArgs, int argc,
         return ARGUMENT_LENGTH;
     }
 
-    gameArgs->deckFile = malloc(sizeof(char) * (int)strlen(argv[1]));
     gameArgs->deckFile = argv[1];
     gameArgs->threshold = atoi(argv[2]);
     gameArgs->playerCount = argc - 3;
@@ -197,6 +323,20 @@ enum ExitMessage check_valid_args(struct GameArgs* gameArgs, int argc,
 }
 
 
+/* Releases the cards of a deck, leaving it empty.
+ */
+void free_deck(struct Deck* deck) {
+    for (int i = 0; i < deck->count; i++) {
+        ledger_free(LEDGER_DECK, deck->decodedCards[i]);
+    }
+    ledger_free(LEDGER_DECK, deck->decodedCards);
+    ledger_free(LEDGER_DECK, deck->cards);
+    deck->count = 0;
+    deck->cards = NULL;
+    deck->decodedCards = NULL;
+}
+
+
 /* Handles the deck file by parsing each line, and checking each card is
  * valid as well as that the number of cards are a valid number. Also,
  * the number of cards stated on the first line of the file is parsed
@@ -206,6 +346,10 @@ enum ExitMessage handle_deck_file(FILE* input, struct Deck* deck) {
     const short bufferSize = (short)log10(INT_MAX) + 3;
     char buffer[bufferSize];
 
+    deck->count = 0;
+    deck->cards = NULL;
+    deck->decodedCards = NULL;
+
     if (!fgets(buffer, bufferSize - 1, input)) {
         return DECK_ERROR;
     }
@@ -217,39 +361,27 @@ enum ExitMessage handle_deck_file(FILE* input, struct Deck* deck) {
         return DECK_ERROR;
     }
 
-    struct Card* cardContents = malloc(sizeof(struct Card) * deckSize);
-    char** cardStrings = malloc(sizeof(char*) * deckSize);
-    deck->decodedCards = malloc(sizeof(char*) * deckSize);
-    deck->count = deckSize;
+    deck->cards = ledger_malloc(LEDGER_DECK, sizeof(struct Card) * deckSize);
+    deck->decodedCards = ledger_malloc(LEDGER_DECK, 
+            sizeof(char*) * deckSize);
 
     for (unsigned i = 0; i < deckSize; ++i) {
-        if (!fgets(buffer, bufferSize - 1, input)) {
-            free(cardContents);
-            return DECK_ERROR;
-        }
-
-        if (((buffer[2] != '\n') && (buffer[2] != '\0')) ||
+        if (!fgets(buffer, bufferSize - 1, input) ||
+                ((buffer[2] != '\n') && (buffer[2] != '\0')) ||
                 !valid_card(buffer[0], buffer[1])) {
-            free(cardContents);
+            free_deck(deck);
             return DECK_ERROR;
         }
 
-        deck->decodedCards[i] = malloc(sizeof(char) * 4);
-        char* card = malloc(sizeof(char) * 4);
-        strcpy(card, buffer);
-        card[2] = '\0';
-        cardContents[i].suit = buffer[0];
-        cardContents[i].rank = decode_rank(buffer[1]);
+        deck->cards[i].suit = buffer[0];
+        deck->cards[i].rank = decode_rank(buffer[1]);
 
-        cardStrings[i] = malloc(sizeof(char) * 4);
-        cardStrings[i] = card;
-
-        strcpy(deck->decodedCards[i], cardStrings[i]);
+        deck->decodedCards[i] = ledger_malloc(LEDGER_DECK, sizeof(char) * 4);
+        memcpy(deck->decodedCards[i], buffer, 2);
+        deck->decodedCards[i][2] = '\0';
+        deck->count = i + 1;
     }
 
-    free(cardStrings);
-    deck->cards = cardContents;
-    fclose(input);
     return NORMAL_EXIT;
 }
 
@@ -266,33 +398,374 @@ enum ExitMessage load_deck_file(struct Deck* deck, const char* filename) {
     }
 
     enum ExitMessage errorMessage = handle_deck_file(deckFile, deck);
+    fclose(deckFile);
     return errorMessage;
 }
 
 
+/* Adds a core and those of its hyperthread siblings which may be used to
+ * a set of cores. Without a list of siblings, cores are paired by number:
+ * 0 with 1, 2 with 3 and so on.
+ */
+void add_core_pair(cpu_set_t* cpus, int core, const cpu_set_t* allowed) {
+    char path[80];
+    int first, last;
+    char separator = ',';
+    FILE* siblings;
+
+    CPU_SET(core, cpus);
+    sprintf(path, SIBLINGS, core);
+    siblings = fopen(path, "r");
+
+    if (!siblings) {
+        if ((core ^ 1) < CPU_SETSIZE && CPU_ISSET(core ^ 1, allowed)) {
+            CPU_SET(core ^ 1, cpus);
+        }
+        return;
+    }
+
+    // the list is of cores and ranges of cores, such as 0,8 or 0-1
+    while (separator == ',' && fscanf(siblings, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(siblings, "%c", &separator) == 1 && separator == '-' &&
+                fscanf(siblings, "%d%c", &last, &separator) < 1) {
+            break;
+        }
+        for (int i = first; i <= last && i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, allowed)) {
+                CPU_SET(i, cpus);
+            }
+        }
+    }
+    fclose(siblings);
+}
+
+
+/* Takes the next number from the counter in SPREAD_COUNTER, locking the
+ * file so that hubs placed at the same time take different numbers.
+ * Returns -1 if the counter cannot be used.
+ */
+long next_spread(void) {
+    int fd = open(SPREAD_COUNTER, O_RDWR | O_CREAT, 0666);
+    char text[32] = "";
+    long next = -1;
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    // the count only grows, so each write covers the one before
+    if (!flock(fd, LOCK_EX) && pread(fd, text, sizeof(text) - 1, 0) >= 0) {
+        int length;
+
+        next = atol(text);
+        length = snprintf(text, sizeof(text), "%ld\n", next + 1);
+        if (pwrite(fd, text, length, 0) != length) {
+            next = -1;
+        }
+    }
+
+    close(fd);
+    return next;
+}
+
+
+/* Returns the core a spread placement puts this hub on: one of the cores
+ * the hub may use, or only the first core of each pair if pairs are
+ * placed, taken in turn by the hubs of the host through the counter in
+ * SPREAD_COUNTER. Returns -1 if there is none or the counter cannot be
+ * used.
+ */
+int spread_core(const cpu_set_t* allowed, bool pairs) {
+    int cores[CPU_SETSIZE];
+    int count = 0;
+    long next;
+
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        cpu_set_t pair;
+        bool first = true;
+
+        if (!CPU_ISSET(i, allowed)) {
+            continue;
+        }
+
+        if (pairs) {
+            CPU_ZERO(&pair);
+            add_core_pair(&pair, i, allowed);
+            for (int j = 0; j < i && first; j++) {
+                first = !CPU_ISSET(j, &pair);
+            }
+        }
+
+        if (first) {
+            cores[count++] = i;
+        }
+    }
+
+    next = count ? next_spread() : -1;
+    return next < 0 ? -1 : cores[next % count];
+}
+
+
+/* Chooses the cores of the hub and its players from HUB_PLACEMENT:
+ * core:N runs them all on core N and pair:N on core N and its hyperthread
+ * siblings, while spread and spread-pair give each hub the next such core
+ * or pair in turn, across the hubs of the host. Reports an unknown or
+ * unusable placement to stderr, and plays the game unplaced.
+ */
+void choose_placement(struct Game* game) {
+    const char* policy = getenv(PLACEMENT);
+    cpu_set_t allowed;
+    int core = -1;
+    bool pair = false;
+
+    game->placed = false;
+    if (!policy) {
+        return;
+    }
+
+    CPU_ZERO(&game->placement);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        CPU_ZERO(&allowed);
+    }
+
+    if (!strncmp(policy, "core:", 5)) {
+        core = atoi(policy + 5);
+    } else if (!strncmp(policy, "pair:", 5)) {
+        core = atoi(policy + 5);
+        pair = true;
+    } else if (!strcmp(policy, "spread")) {
+        core = spread_core(&allowed, false);
+    } else if (!strcmp(policy, "spread-pair")) {
+        core = spread_core(&allowed, true);
+        pair = true;
+    }
+
+    if (core < 0 || core >= CPU_SETSIZE || !CPU_ISSET(core, &allowed)) {
+        fprintf(stderr, "Placement unavailable\n");
+        return;
+    }
+
+    if (pair) {
+        add_core_pair(&game->placement, core, &allowed);
+    } else {
+        CPU_SET(core, &game->placement);
+    }
+    game->placed = true;
+}
+
+
+/* Places a process of the game, 0 for the hub itself, on the game's cores
+ * if it is placed. The players the hub forks inherit its placement.
+ */
+void place_process(const struct Game* game, pid_t pid) {
+    if (game->placed) {
+        sched_setaffinity(pid, sizeof(game->placement), &game->placement);
+    }
+}
+
+
+/* Prepares a player to be connected, with nothing queued.
+ */
+void reset_player(struct Player* player) {
+    memset(player, 0, sizeof(*player));
+    player->toChild = -1;
+    player->fromChild = -1;
+    player->forkedPid = -1;
+    player->forkedExit = -1;
+}
+
+
+/* Stores the descriptors a player is talked to over. Writes to the player
+ * never block, so that a player which is not reading cannot stall the hub.
+ */
+void connect_player(struct Player* player, int toChild, int fromChild) {
+    player->toChild = toChild;
+    player->fromChild = fromChild;
+    fcntl(toChild, F_SETFL, fcntl(toChild, F_GETFL) | O_NONBLOCK);
+}
+
+
+/* Appends bytes to a queue, first moving the bytes not yet written or
+ * handled to its front if it is full, and then growing it if need be.
+ */
+void queue_append(struct Queue* queue, const char* data, size_t length) {
+    if (queue->start && queue->length + length > queue->size) {
+        memmove(queue->data, queue->data + queue->start,
+                queue->length - queue->start);
+        queue->length -= queue->start;
+        queue->start = 0;
+    }
+
+    if (queue->length + length > queue->size) {
+        size_t size = queue->size ? queue->size : READ_CHUNK;
+
+        while (size < queue->length + length) {
+            size *= 2;
+        }
+        queue->data = ledger_realloc(LEDGER_MESSAGES, queue->data, size);
+        queue->size = size;
+    }
+
+    memcpy(queue->data + queue->length, data, length);
+    queue->length += length;
+}
+
+
+/* Writes as much of a player's queued output as it takes without blocking.
+ * The output of a player which has closed its end is dropped, as a
+ * blocking write would have dropped it, and its end found when it is read.
+ */
+void drain_output(struct Player* player) {
+    struct Queue* output = &player->output;
+
+    while (output->start < output->length) {
+        ssize_t written = write(player->toChild, output->data + output->start,
+                output->length - output->start);
+
+        if (written > 0) {
+            output->start += written;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        } else if (errno != EINTR) {
+            output->start = output->length;
+        }
+    }
+
+    output->start = 0;
+    output->length = 0;
+}
+
+
+/* Queues a message for a player and writes as much of its output as it
+ * takes. Returns a player stalled status, and marks the player stalled,
+ * if it has more than OUTPUT_CAP bytes still to take.
+ */
+enum ExitMessage send_message(struct Player* player, const char* message) {
+    queue_append(&player->output, message, strlen(message));
+    drain_output(player);
+
+    if (player->output.length - player->output.start > OUTPUT_CAP) {
+        player->stalled = true;
+        return PLAYER_STALLED;
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Waits for the next line from a player, meanwhile writing the output of
+ * every player as they take it, so that no player waits for the hub while
+ * the hub waits for another. Returns the line without its newline, which
+ * is valid until the player's next line is read, or NULL at the end of the
+ * player's output, when eof is set, if the wait fails, or if the player
+ * has sent more than INPUT_CAP bytes without a newline, when it is marked
+ * stalled.
+ */
+char* read_reply(struct Game* game, struct Player* player, bool* eof) {
+    struct Queue* input = &player->input;
+    struct pollfd fds[game->totalPlayers + 1];
+    int owners[game->totalPlayers + 1];
+    char chunk[READ_CHUNK];
+
+    *eof = false;
+    while (1) {
+        char* end = input->data ? memchr(input->data + input->start, '\n',
+                input->length - input->start) : NULL;
+        int count = 1;
+        ssize_t length;
+
+        if (end) {
+            char* line = input->data + input->start;
+
+            *end = '\0';
+            input->start = end + 1 - input->data;
+            if (input->start == input->length) {
+                input->start = 0;
+                input->length = 0;
+            }
+            return line;
+        }
+
+        if (input->length - input->start > INPUT_CAP) {
+            player->stalled = true;
+            return NULL;
+        }
+
+        fds[0] = (struct pollfd){.fd = player->fromChild, .events = POLLIN};
+        for (int i = 0; i < game->totalPlayers; i++) {
+            struct Player* other = &game->players[i];
+
+            if (other->output.start < other->output.length) {
+                fds[count] = (struct pollfd){.fd = other->toChild,
+                        .events = POLLOUT};
+                owners[count++] = i;
+            }
+        }
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR && !signalOut) {
+                continue;
+            }
+            return NULL;
+        }
+
+        for (int i = 1; i < count; i++) {
+            if (fds[i].revents) {
+                drain_output(&game->players[owners[i]]);
+            }
+        }
+
+        if (!fds[0].revents) {
+            continue;
+        }
+
+        length = read(player->fromChild, chunk, sizeof(chunk));
+        if (length > 0) {
+            queue_append(input, chunk, length);
+        } else if (length == 0) {
+            *eof = true;
+            return NULL;
+        } else if (errno != EINTR || signalOut) {
+            return NULL;
+        }
+    }
+}
+
+
 /* Initialise the pipe for both parent and child, and then stores the relevant
- * file pointer for each program to allow inter-process communication.
+ * file pointer for each program to allow inter-process communication. Every
+ * player of the game joins the process group of the first, so that the
+ * whole game can be killed at once.
  */
-enum ExitMessage initialise_pipe(struct Player* player, char* args[]) {
+enum ExitMessage initialise_pipe(struct Game* game, struct Player* player,
+        char* args[]) {
     int pipeIn[2], pipeOut[2];
 
-    player->toChild = NULL;
-    player->fromChild = NULL;
-
+    reset_player(player);
     pipe(pipeOut);
     pipe(pipeIn);
 
     player->pid = fork();
 
-    if (player->pid) {
+    if (player->pid < 0) {
+        return PLAYER_ERROR;
+    } else if (player->pid) {
+        // set in both processes, so that neither can run ahead of it
+        setpgid(player->pid, game->processGroup);
+        if (!game->processGroup) {
+            game->processGroup = player->pid;
+        }
+
         close(pipeOut[READ_END]);
         close(pipeIn[WRITE_END]);
-
-        player->toChild = fdopen(pipeOut[WRITE_END], "w");
-        player->fromChild = fdopen(pipeIn[READ_END], "r");
+        connect_player(player, pipeOut[WRITE_END], pipeIn[READ_END]);
 
         return NORMAL_EXIT;
     } else {
+        setpgid(0, game->processGroup);
+        sigprocmask(SIG_SETMASK, &game->childMask, NULL);
+
         close(pipeOut[WRITE_END]);
         close(pipeIn[READ_END]);
         // suppresses the stderr from player
@@ -303,13 +776,134 @@ enum ExitMessage initialise_pipe(struct Player* player, char* args[]) {
 
         execvp(args[0], args);
 
+        // the child must not carry on as a second hub
+        _exit(PLAYER_ERROR);
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Connects to a player listening on a socket and sends it the arguments
+ * a player program would otherwise be started with, as the message
+ * NEWGAMEplayers,myid,threshold,handsize. Returns a player error status if
+ * the player cannot be reached.
+ */
+enum ExitMessage initialise_socket(struct Player* player, const char* address,
+        char* args[]) {
+    char message[80];
+    int connection = connect_address(address);
+    int copy = connection >= 0 ? dup(connection) : -1;
+
+    reset_player(player);
+    player->pid = -1;
+
+    if (copy < 0) {
+        if (connection >= 0) {
+            close(connection);
+        }
         return PLAYER_ERROR;
     }
 
+    connect_player(player, connection, copy);
+    snprintf(message, sizeof(message), "NEWGAME%s,%s,%s,%s\n", args[1],
+            args[2], args[3], args[4]);
+    return send_message(player, message);
+}
+
+
+/* Asks the zygote at the given address to fork a player for this seat.
+ * The player's ends of the pipes, and /dev/null for its stderr, are passed
+ * to the zygote with the player's arguments, so that the player is set up
+ * as if the hub had started it. Returns a player error status if the
+ * zygote cannot be reached or does not start the player.
+ */
+enum ExitMessage initialise_zygote(struct Game* game, struct Player* player,
+        const char* address, char* args[]) {
+    int pipeIn[2], pipeOut[2];
+    int fds[3];
+    char request[80];
+    char reply[16];
+    ssize_t length = -1;
+    int connection = connect_address(address);
+
+    reset_player(player);
+    player->pid = -1;
+
+    if (connection < 0) {
+        return PLAYER_ERROR;
+    }
+
+    pipe(pipeOut);
+    pipe(pipeIn);
+    fds[0] = pipeOut[READ_END];
+    fds[1] = pipeIn[WRITE_END];
+    // suppresses the stderr from player
+    fds[2] = open("/dev/null", O_WRONLY);
+
+    sprintf(request, "NEWGAME%s,%s,%s,%s\n", args[1], args[2], args[3],
+            args[4]);
+    if (send_fds(connection, request, fds, 3)) {
+        length = read(connection, reply, sizeof(reply) - 1);
+    }
+
+    close(connection);
+    for (int i = 0; i < 3; i++) {
+        close(fds[i]);
+    }
+
+    if (length <= 0 || (reply[length] = '\0', atoi(reply) <= 0)) {
+        close(pipeOut[WRITE_END]);
+        close(pipeIn[READ_END]);
+        return PLAYER_ERROR;
+    }
+
+    // the zygote's player is not the hub's child, so is placed, watched
+    // and killed by its pid
+    player->forkedPid = atoi(reply);
+    player->forkedExit = syscall(SYS_pidfd_open, player->forkedPid, 0);
+    place_process(game, player->forkedPid);
+    connect_player(player, pipeOut[WRITE_END], pipeIn[READ_END]);
     return NORMAL_EXIT;
 }
 
 
+/* Allocates the seat arrays of a game, with every score and hand empty.
+ */
+void initialise_seats(struct Seats* seats, int count) {
+    void* hands;
+
+    seats->score = ledger_calloc(LEDGER_SEATS, count, sizeof(int));
+    seats->diamonds = ledger_calloc(LEDGER_SEATS, count, sizeof(int));
+    posix_memalign(&hands, CACHE_LINE, sizeof(*seats->hands) * count);
+    memset(hands, 0, sizeof(*seats->hands) * count);
+    ledger_track(LEDGER_SEATS, hands);
+    seats->hands = hands;
+}
+
+
+/* Releases the seat arrays of a game.
+ */
+void free_seats(struct Seats* seats) {
+    ledger_free(LEDGER_SEATS, seats->score);
+    ledger_free(LEDGER_SEATS, seats->diamonds);
+    ledger_free(LEDGER_SEATS, seats->hands);
+}
+
+
+/* Returns the slot of a card in a hand, or -1 if it is not a card.
+ */
+int card_slot(char suit, int rank) {
+    int suitIndex = suit_index(suit);
+
+    if (suitIndex < 0 || rank < 1 || rank > MAX_RANK) {
+        return -1;
+    }
+
+    return suitIndex * (MAX_RANK + 1) + rank;
+}
+
+
 /* Creates and executes the specified child programs as players, and also
  * opens the communication channel with players. If successful, the hub is
  * able to communicate with player programs, otherwise a player error status
@@ -317,15 +911,20 @@ enum ExitMessage initialise_pipe(struct Player* player, char* args[]) {
  */
 enum ExitMessage initialise_game_players(struct Game* game, 
         struct GameArgs gameArgs) {
-    char numPlayers[2];
-    char playerId[2];
-    char threshold[2];
-    char handSize[2];
+    char numPlayers[12];
+    char playerId[12];
+    char threshold[12];
+    char handSize[12];
     enum ExitMessage errorMessage = 0;
 
     game->handSize = game->deck.count / gameArgs.playerCount;
     game->currentRound = 0;
-    game->players = malloc(sizeof(struct Player) * gameArgs.playerCount);
+    game->players = ledger_calloc(LEDGER_PLAYERS, gameArgs.playerCount,
+            sizeof(struct Player));
+    for (int i = 0; i < gameArgs.playerCount; i++) {
+        reset_player(&game->players[i]);
+    }
+    initialise_seats(&game->seats, gameArgs.playerCount);
 
     sprintf(numPlayers, "%d", gameArgs.playerCount);
     sprintf(threshold, "%d", gameArgs.threshold);
@@ -333,18 +932,37 @@ enum ExitMessage initialise_game_players(struct Game* game,
 
     char* args[] = {NULL, numPlayers, playerId, threshold, 
             handSize, NULL};
+    char* pluginArgs[] = {NULL, NULL, numPlayers, playerId, threshold,
+            handSize, NULL};
 
     for (int i = 0; i < gameArgs.playerCount; i++) {
+        char* plugin = strchr(gameArgs.players[i], ':');
 
         game->players[i].playerId = i;
         game->currentChild = i;
-        game->players[i].score = 0;
-        game->players[i].diamondCardScore = 0;
-        
+
         args[0] = gameArgs.players[i];
         sprintf(playerId, "%d", i);
-
-        errorMessage = initialise_pipe(&game->players[i], args);
+        trace_begin("spawn", i);
+
+        if (is_address(gameArgs.players[i])) {
+            errorMessage = initialise_socket(&game->players[i],
+                    gameArgs.players[i], args);
+        } else if (is_zygote(gameArgs.players[i])) {
+            errorMessage = initialise_zygote(game, &game->players[i],
+                    gameArgs.players[i], args);
+        } else if (plugin) {
+            // program:plugin starts the program with the plugin argument
+            *plugin = '\0';
+            pluginArgs[0] = gameArgs.players[i];
+            pluginArgs[1] = plugin + 1;
+            errorMessage = initialise_pipe(game, &game->players[i],
+                    pluginArgs);
+            *plugin = ':';
+        } else {
+            errorMessage = initialise_pipe(game, &game->players[i], args);
+        }
+        trace_end("spawn", i);
 
         if (errorMessage) {
             return errorMessage;
@@ -355,96 +973,254 @@ enum ExitMessage initialise_game_players(struct Game* game,
 }
 
 
-/* Kills all children in the event of a game over or
- * SIGHUP interruption. 
+/* Starts reporting SIGCHLD through a signalfd, which the hub reads rather
+ * than taking the signal. The previous signal mask is kept for children.
  */
-void kill_children(struct Game* game) {
-    int status = 0;
+void initialise_child_signals(struct Game* game) {
+    sigset_t mask;
+
+    game->processGroup = 0;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &game->childMask);
+    game->childSignals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
 
-    // handle SIGHUP if occurred.
-    if (signalOut) {
+
+/* Reaps every child that has exited, recording its status. The pending
+ * SIGCHLD notifications are drained first, so that the signalfd only
+ * becomes readable again once another child exits.
+ */
+void reap_children(struct Game* game) {
+    struct signalfd_siginfo info;
+    int status;
+    pid_t pid;
+
+    if (game->childSignals >= 0) {
+        while (read(game->childSignals, &info, sizeof(info)) == 
+                sizeof(info)) {
+        }
+    }
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
         for (int i = 0; i < game->totalPlayers; i++) {
-            while(game->players[i].pid = waitpid(-1, 0, WNOHANG),
-                    game->players[i].pid > 0) {
-                kill(game->players[1].pid, SIGKILL); 
+            if (game->players[i].pid == pid) {
+                game->players[i].status = status;
+                game->players[i].exited = true;
             }
         }
+    }
+
+    for (int i = 0; i < game->totalPlayers; i++) {
+        struct Player* player = &game->players[i];
+        struct pollfd forked = {.fd = player->forkedExit, .events = POLLIN};
+
+        if (player->forkedExit >= 0 && poll(&forked, 1, 0) > 0) {
+            close(player->forkedExit);
+            player->forkedExit = -1;
+            player->exited = true;
+        }
+    }
+}
+
+
+/* Returns the number of children of the game which have not been reaped,
+ * counting the players forked by a zygote which are still running if
+ * their exit can be watched for. Players reached over a socket are not
+ * children.
+ */
+int count_running(const struct Game* game) {
+    int running = 0;
+
+    for (int i = 0; i < game->totalPlayers; i++) {
+        running += (game->players[i].pid > 0 ||
+                game->players[i].forkedExit >= 0) && !game->players[i].exited;
+    }
+
+    return running;
+}
+
+
+/* Waits for the game's children, and the players forked for it by a
+ * zygote, to exit, for at most timeout milliseconds or forever if timeout
+ * is negative. Returns true once all have exited.
+ */
+bool wait_children(struct Game* game, int timeout) {
+    struct pollfd* exits = ledger_malloc(LEDGER_PLAYERS,
+            sizeof(struct pollfd) * (game->totalPlayers + 1));
+    bool exited = true;
+
+    reap_children(game);
+    while (exited && count_running(game)) {
+        int numExits = 0;
+
+        for (int i = 0; i < game->totalPlayers; i++) {
+            if (game->players[i].forkedExit >= 0) {
+                exits[numExits].fd = game->players[i].forkedExit;
+                exits[numExits++].events = POLLIN;
+            }
+        }
+
+        if (game->childSignals >= 0) {
+            exits[numExits].fd = game->childSignals;
+            exits[numExits++].events = POLLIN;
+        } else if (numExits < count_running(game)) {
+            // without a signalfd a blocking wait is the only option
+            if (timeout >= 0) {
+                exited = false;
+            } else {
+                waitpid(-1, NULL, 0);
+            }
+            numExits = 0;
+        }
+
+        if (numExits && poll(exits, numExits, timeout) == 0) {
+            exited = false;
+        }
+        reap_children(game);
+    }
+
+    ledger_free(LEDGER_PLAYERS, exits);
+    return exited;
+}
+
+
+/* Kills every player forked for the game by a zygote which has not been
+ * seen to exit. They are not in the game's process group.
+ */
+void kill_forked(struct Game* game) {
+    for (int i = 0; i < game->totalPlayers; i++) {
+        if (game->players[i].forkedPid > 0 && !game->players[i].exited) {
+            kill(game->players[i].forkedPid, SIGKILL);
+        }
+    }
+}
+
+
+/* Kills all children in the event of a game over or SIGHUP interruption.
+ * On a game over every player still running is sent GAMEOVER and given a
+ * moment to exit, after which the rest of the game's process group and
+ * the players forked by a zygote are killed. Every child is reaped before
+ * returning.
+ */
+void kill_children(struct Game* game) {
+    // handle SIGHUP if occurred.
+    if (signalOut) {
+        if (game->processGroup) {
+            killpg(game->processGroup, SIGKILL);
+        }
+        kill_forked(game);
+        wait_children(game, -1);
 
         fprintf(stderr, "Ended due to signal\n");
         exit(9);
     }
 
+    reap_children(game);
     for (int i = 0; i < game->totalPlayers; i++) {
-        fprintf(game->players[i].toChild, "GAMEOVER\n");
-        fflush(game->players[i].toChild);
+        if (game->players[i].toChild >= 0 && !game->players[i].exited) {
+            send_message(&game->players[i], "GAMEOVER\n");
+        }
+    }
 
-        // brute force
-        if (!waitpid(game->players[i].pid, &status, WNOHANG)) {
-            kill(game->players[1].pid, SIGKILL);
-            continue;
+    if (!wait_children(game, GAMEOVER_GRACE_MS)) {
+        if (game->processGroup) {
+            killpg(game->processGroup, SIGKILL);
         }
+        kill_forked(game);
+        wait_children(game, -1);
+    }
+}
+
+
+/* Opens a hardware counter of the hub's cache misses if HUB_CACHE_STATS
+ * is set in the environment. The counter starts disabled, and is only
+ * enabled around the per-round bookkeeping rather than the pipe I/O.
+ */
+void open_cache_counter(struct Game* game) {
+    struct perf_event_attr attr;
+
+    game->cacheCounter = -1;
+    if (!getenv(CACHE_STATS)) {
+        return;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    game->cacheCounter = syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+            PERF_FLAG_FD_CLOEXEC);
+}
+
+
+/* Enables or disables the cache miss counter, if there is one.
+ */
+void count_cache_misses(const struct Game* game, bool enable) {
+    if (game->cacheCounter >= 0) {
+        ioctl(game->cacheCounter,
+                enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
     }
 }
 
 
-/* Resizes the games deck after each player's hand is initialised.
+/* Outputs the cache misses per round to stderr when HUB_CACHE_STATS is
+ * set, or that they could not be counted.
  */
-void resize_deck(struct Game* game) {
-    game->deck.count = game->deck.count - game->handSize;
+void report_cache_misses(const struct Game* game) {
+    long long misses;
+
+    if (!getenv(CACHE_STATS)) {
+        return;
+    }
 
-    for (int i = 0; i < game->deck.count; i++) {
-        game->deck.decodedCards[i] = 
-                game->deck.decodedCards[i + game->handSize];
+    if (game->cacheCounter < 0 || read(game->cacheCounter, &misses,
+            sizeof(misses)) != sizeof(misses)) {
+        fprintf(stderr, "Cache misses unavailable\n");
+        return;
     }
 
-    game->deck.decodedCards = realloc(game->deck.decodedCards, 
-            (sizeof(char*) * game->deck.count));
+    fprintf(stderr, "Cache misses per round=%.1f\n",
+            game->currentRound ? (double)misses / game->currentRound : 0.0);
 }
 
 
 /* Sends a player their initial hand, by removing the first (hand size)
- * number of cards from the deck.
+ * number of cards from the deck. Returns a player stalled status if a
+ * player is not taking its messages.
  */
-void send_initial_hand(struct Game* game) {
-    char* nextCard = malloc(sizeof(char) * 3);
-    char* buffer = malloc(sizeof(char) * (3 * game->handSize + 8));
-    char playerHand[80];
+enum ExitMessage send_initial_hand(struct Game* game) {
+    enum ExitMessage errorMessage = NORMAL_EXIT;
+    char* buffer = ledger_malloc(LEDGER_MESSAGES, 
+            sizeof(char) * (3 * game->handSize + 16));
     int skip;
 
-    for (int i = 0; i < game->totalPlayers; i++) {
-        strcpy(buffer, "");
-        sprintf(buffer, "HAND%d,", game->handSize);
+    for (int i = 0; i < game->totalPlayers && !errorMessage; i++) {
+        // cards are appended at the end rather than by strcat, which
+        // would rescan the message for every card
+        int length = sprintf(buffer, "HAND%d,", game->handSize);
         skip = i * game->handSize;
-        game->players[i].hand = malloc(sizeof(char) * 
-                (game->handSize * 2) + 2);
 
-        for (int j = 0; j < game->handSize - 1; j++) {
-            strcpy(nextCard, game->deck.decodedCards[j + skip]);
-            nextCard[2] = '\0';
+        for (int j = 0; j < game->handSize; j++) {
+            const char* nextCard = game->deck.decodedCards[j + skip];
 
-            if (j == 0) {
-                strcpy(playerHand, nextCard);
-            } else {
-                strcat(playerHand, nextCard);
-            }
+            game->seats.hands[i][card_slot(nextCard[0],
+                    decode_rank(nextCard[1]))]++;
 
-            strcat(buffer, nextCard);
-            strcat(buffer, ",");
+            buffer[length++] = nextCard[0];
+            buffer[length++] = nextCard[1];
+            buffer[length++] = j < game->handSize - 1 ? ',' : '\n';
         }
+        buffer[length] = '\0';
 
-        strcpy(nextCard, game->deck.decodedCards[game->handSize - 1 + skip]);
-        strcat(buffer, nextCard);
-        strcat(buffer, "\n");
-
-        strcat(playerHand, nextCard);
-        strcpy(game->players[i].hand, playerHand);
-
-        fputs(buffer, game->players[i].toChild);
-        fflush(game->players[i].toChild);  
+        errorMessage = send_message(&game->players[i], buffer);
     }
 
-    free(buffer);
-    free(nextCard);  
+    ledger_free(LEDGER_MESSAGES, buffer);
+    return errorMessage;
 }
 
 
@@ -474,31 +1250,53 @@ enum ExitMessage initialise_new_game(struct Game* game,
         return SMALL_DECK;
     }
 
+    // an unknown player type leaves no players to start
+    if (!game->totalPlayers) {
+        return PLAYER_ERROR;
+    }
+
+    initialise_child_signals(game);
+    choose_placement(game);
+    place_process(game, 0);
+    trace_begin("spawn players", -1);
     errorMessage = initialise_game_players(game, gameArgs);
+    trace_end("spawn players", -1);
 
     if (errorMessage) {
-        kill_children(game);
+        if (game->processGroup) {
+            killpg(game->processGroup, SIGKILL);
+        }
+        return errorMessage;
     }
 
-    send_initial_hand(game);
-    return NORMAL_EXIT;
+    trace_begin("deal", -1);
+    errorMessage = send_initial_hand(game);
+    trace_end("deal", -1);
+
+    if (errorMessage && game->processGroup) {
+        killpg(game->processGroup, SIGKILL);
+    }
+    return errorMessage;
 }
 
 
 /* Sends each player a message informing them of a new round and
- * the lead player for that round.
+ * the lead player for that round. Returns a player stalled status if a
+ * player is not taking its messages.
  */
-void new_round(struct Game* game) {
+enum ExitMessage new_round(struct Game* game) {
+    enum ExitMessage errorMessage = NORMAL_EXIT;
     char buffer[20];
     int leader = game->leadPlayer;
 
     printf("Lead player=%d\n", game->leadPlayer);
 
-    for (int i = 0; i < game->totalPlayers; i++) {
+    for (int i = 0; i < game->totalPlayers && !errorMessage; i++) {
         sprintf(buffer, "NEWROUND%d\n", leader);
-        fputs(buffer, game->players[i].toChild);
-        fflush(game->players[i].toChild);
+        errorMessage = send_message(&game->players[i], buffer);
     }
+
+    return errorMessage;
 }
 
 
@@ -513,46 +1311,18 @@ int is_game_over(const struct Game* game) {
 }
 
 
-/* Checks whether a card being played by a player is valid.
+/* Checks whether a card being played by a player is valid, and if so
+ * removes it from the player's hand.
  */
 enum ExitMessage check_valid_card(struct Game* game, int player, char suit, 
         int rank) {
-    int counter;
-    int isValid = 0;
-    char buffer[80];
-
-    for (int i = 0; i < game->handSize; i++) {
-        if (game->players[player].hand[2 * i] == suit && 
-                game->players[player].hand[2 * i + 1] == encode_rank(rank)) {
-            counter = i;
-            isValid = 1;
-        }
-    }
+    int slot = card_slot(suit, rank);
 
-    if (!isValid) {
+    if (slot < 0 || !game->seats.hands[player][slot]) {
         return INVALID_CARD;
     }
 
-    for (int i = 0; i < counter; i++) {
-        buffer[2 * i] = game->players[player].hand[2 * i];
-        buffer[2 * i + 1] = game->players[player].hand[2 * i + 1];
-    }
-
-    if (counter == game->handSize - 1) {
-        buffer[2 * counter] = game->players[player].hand[2 * counter + 2];
-        buffer[2 * counter + 1] = game->players[player].hand[2 * counter + 3];
-    } else {
-        for (int i = counter; i < game->handSize - 1; i++) {
-            buffer[2 * i] = game->players[player].hand[2 * i + 2];
-            buffer[2 * i + 1] = game->players[player].hand[2 * i + 3];
-
-        }   
-    }
-
-    buffer[game->handSize * 2 - 2] = '\0';
-    game->players[player].hand = realloc(game->players[player].hand, 
-            sizeof(buffer));
-    strcpy(game->players[player].hand, buffer);
+    game->seats.hands[player][slot]--;
     return NORMAL_EXIT;
 }
 
@@ -583,7 +1353,7 @@ enum ExitMessage handle_player_message(struct Game* game, char* input,
 
     errorMessage = check_valid_card(game, player, suit, rank);
 
-    if (suit == 'D') {
+    if (suit == DIAMONDS) {
         game->numDiamondCards++;
     }
 
@@ -602,6 +1372,7 @@ enum ExitMessage handle_player_message(struct Game* game, char* input,
     } else {
         if (suit == game->leadSuit && rank > game->leadRank) {
             game->leadPlayer = player;
+            game->leadRank = rank;
         }
     }
     game->currentCard.suit = suit;
@@ -618,55 +1389,42 @@ enum ExitMessage handle_player_message(struct Game* game, char* input,
  */
 void handle_round_score(struct Game* game) {
     int leader = game->leadPlayer;
-    char buffer[80];
-    char card[5];
+    const char* cards = game->currentRoundCards;
 
-    game->players[leader].score++;
-    game->players[leader].diamondCardScore += game->numDiamondCards;
+    game->seats.score[leader]++;
+    game->seats.diamonds[leader] += game->numDiamondCards;
 
     game->numDiamondCards = 0;
 
-    sprintf(buffer, "Cards=");
-    
-    for (int i = 0; i < game->totalPlayers - 1; i++) {
-        card[0] = game->currentRoundCards[2 * i];
-        card[1] = '.';
-        card[2] = game->currentRoundCards[2 * i + 1];
-        card[3] = ' ';
-        card[4] = '\0';
-
-        strcat(buffer, card);
+    // printed card by card, so that no buffer limits the number of players
+    printf("Cards=");
+    for (int i = 0; i < game->totalPlayers; i++) {
+        printf(i ? " %c.%c" : "%c.%c", cards[2 * i], cards[2 * i + 1]);
     }
-
-    card[0] = game->currentRoundCards[2 * (game->totalPlayers - 1)];
-    card[1] = '.';
-    card[2] = game->currentRoundCards[2 * (game->totalPlayers - 1) + 1];
-    card[3] = '\0';
-
-    strcat(buffer, card);
-    fprintf(stdout, "%s\n", buffer);
+    printf("\n");
     fflush(stdout);
 }
 
 
 /* Sends a player's move to all other players in the game so that they
- * can determine what move to make.
+ * can determine what move to make. Returns a player stalled status if a
+ * player is not taking its messages.
  */
-void send_player_from_hub(struct Game* game, int currentPlayer) {
+enum ExitMessage send_player_from_hub(struct Game* game, int currentPlayer) {
+    enum ExitMessage errorMessage = NORMAL_EXIT;
     char message[20];
     char rank = encode_rank(game->currentCard.rank);
     char suit = game->currentCard.suit;
-    FILE* toChild;
 
     sprintf(message, "PLAYED%d,%c%c\n", currentPlayer, suit, rank);
 
-    for (int i = 0; i < game->totalPlayers; i++) {
+    for (int i = 0; i < game->totalPlayers && !errorMessage; i++) {
         if (i != currentPlayer) {
-            toChild = game->players[i].toChild;
-            fputs(message, toChild);
-            fflush(toChild);
+            errorMessage = send_message(&game->players[i], message);
         }
     }
+
+    return errorMessage;
 }
 
 
@@ -677,27 +1435,37 @@ enum ExitMessage handle_player_moves(struct Game* game, int startIndex,
         int endIndex) {
     enum ExitMessage errorMessage = 0;
     char* input;
-    input = malloc(sizeof(char) * 80);
+    bool eof;
 
     for (int i = startIndex; i < endIndex; i++) {
 
-        input = get_line(game->players[i].fromChild);
+        trace_begin("wait", i);
+        input = read_reply(game, &game->players[i], &eof);
+        trace_end("wait", i);
 
         if (input == NULL) {
-            if (feof(game->players[i].fromChild)) {
+            if (eof) {
                 return PLAYER_EOF;
+            } else if (game->players[i].stalled) {
+                return PLAYER_STALLED;
             } else {
                 return INVALID_MESSAGE;
             }
         }
 
+        trace_begin("relay", i);
+        count_cache_misses(game, true);
         errorMessage = handle_player_message(game, input, i);
+        count_cache_misses(game, false);
+
+        if (!errorMessage) {
+            errorMessage = send_player_from_hub(game, i);
+        }
+        trace_end("relay", i);
 
         if (errorMessage) {
             return errorMessage;
         }
-
-        send_player_from_hub(game, i);
     }
 
     return errorMessage;
@@ -710,10 +1478,10 @@ enum ExitMessage handle_player_moves(struct Game* game, int startIndex,
  */
 void handle_final_score(struct Game* game) {
     for (int i = 0; i < game->totalPlayers; i++) {
-        if (game->players[i].diamondCardScore < game->threshold) {
-            game->players[i].score -= game->players[i].diamondCardScore;
+        if (game->seats.diamonds[i] < game->threshold) {
+            game->seats.score[i] -= game->seats.diamonds[i];
         } else {
-            game->players[i].score += game->players[i].diamondCardScore;
+            game->seats.score[i] += game->seats.diamonds[i];
         }
     }
 }
@@ -723,23 +1491,13 @@ void handle_final_score(struct Game* game) {
  * and successful game. Scores are outputted in order of player id.
  */
 void output_final_score(struct Game* game) {
-    char buffer[10];
-    int size = game->totalPlayers - 1;
-    char* output = malloc(sizeof(char) * (game->totalPlayers * 4));
-    strcpy(output, "");
-
     handle_final_score(game);
 
-    for (int i = 0; i < size; i++) {
-        sprintf(buffer, "%d:%d ", i, game->players[i].score);
-        strcat(output, buffer);
+    for (int i = 0; i < game->totalPlayers; i++) {
+        printf(i ? " %d:%d" : "%d:%d", i, game->seats.score[i]);
     }
-
-    sprintf(buffer, "%d:%d", size, game->players[size].score);
-    strcat(output, buffer);
-    printf("%s\n", output);
+    printf("\n");
     fflush(stdout);
-    free(output);
 }
 
 
@@ -751,31 +1509,88 @@ enum ExitMessage play_game(struct Game* game) {
     enum ExitMessage errorMessage = 0;
     game->leadPlayer = 0;
     game->numDiamondCards = 0;
-    game->currentRoundCards = malloc(sizeof(char) * 
+    open_cache_counter(game);
+    game->currentRoundCards = ledger_malloc(LEDGER_SEATS, sizeof(char) * 
             (2 * game->totalPlayers) + 1);
 
     strcpy(game->currentRoundCards, "");
 
-    while (!is_game_over(game)) {
+    while (!is_game_over(game) && !errorMessage) {
         int leader = game->leadPlayer;
-        new_round(game);
+        trace_begin("round", leader);
+        errorMessage = new_round(game);
 
-        handle_player_moves(game, leader, game->totalPlayers);
-        handle_player_moves(game, 0, leader);
+        if (!errorMessage) {
+            errorMessage = handle_player_moves(game, leader,
+                    game->totalPlayers);
+        }
+        if (!errorMessage) {
+            errorMessage = handle_player_moves(game, 0, leader);
+        }
+        if (errorMessage) {
+            trace_end("round", leader);
+            break;
+        }
 
+        trace_begin("score", -1);
+        count_cache_misses(game, true);
         handle_round_score(game);
+        count_cache_misses(game, false);
+        trace_end("score", -1);
         game->handSize--;
         strcpy(game->currentRoundCards, "");
 
         game->currentRound++;
+        reap_children(game);
+        trace_end("round", leader);
+        ledger_poll();
+    }
+
+    if (errorMessage) {
+        return errorMessage;
     }
 
     output_final_score(game);
-    free(game->currentRoundCards);
+    report_cache_misses(game);
     return errorMessage;
 }
 
 
+/* Releases everything a finished game holds once its players have been
+ * reaped, and restores the signal mask, so that another game can be
+ * played by the same hub.
+ */
+void release_game(struct Game* game) {
+    for (int i = 0; i < game->totalPlayers; i++) {
+        struct Player* player = &game->players[i];
+
+        if (player->toChild >= 0) {
+            close(player->toChild);
+        }
+        if (player->fromChild >= 0) {
+            close(player->fromChild);
+        }
+        if (player->forkedExit >= 0) {
+            close(player->forkedExit);
+        }
+        ledger_free(LEDGER_MESSAGES, player->output.data);
+        ledger_free(LEDGER_MESSAGES, player->input.data);
+    }
+    ledger_free(LEDGER_PLAYERS, game->players);
+    ledger_free(LEDGER_SEATS, game->currentRoundCards);
+    free_seats(&game->seats);
+    free_deck(&game->deck);
+
+    if (game->cacheCounter >= 0) {
+        close(game->cacheCounter);
+    }
+    if (game->childSignals >= 0) {
+        close(game->childSignals);
+    }
+    sigprocmask(SIG_SETMASK, &game->childMask, NULL);
+}
+
+
 /* Exits the program and handles the relevant error by printing
  * an error message to stderr.
  */
@@ -811,6 +1626,9 @@ void handle_game_over(enum ExitMessage errorMessage) {
         case INTERRUPTED:
             fprintf(stderr, "Ended due to signal\n");
             break;
+        case PLAYER_STALLED:
+            fprintf(stderr, "Player stalled\n");
+            break;
     }
 
     exit(errorMessage);
@@ -821,6 +1639,8 @@ int main(int argc, char** argv) {
     enum ExitMessage errorMessage;
     struct GameArgs gameArgs;
     struct Game game;
+    const char* soak;
+    long games;
 
     // set up sigaction to handle SIGHUP
     struct sigaction sig;
@@ -828,20 +1648,44 @@ int main(int argc, char** argv) {
     sig.sa_handler = child_handler;
     sig.sa_flags = SA_NOCLDSTOP;
     sigaction(SIGHUP, &sig, NULL);
+    // players which have already exited must not end the hub
+    signal(SIGPIPE, SIG_IGN);
 
     errorMessage = check_valid_args(&gameArgs, argc, argv);
     if (errorMessage) {
         handle_game_over(errorMessage);
     }
 
-    errorMessage = initialise_new_game(&game, gameArgs);
-    if (errorMessage) {
-        handle_game_over(errorMessage);
-    }
+    // with TRACE_FILE set the hub and the players it starts trace the game
+    trace_open("2310hub");
+    ledger_open("2310hub");
+
+    // with HUB_SOAK set the game is played over and over, releasing all
+    // of it in between, and the memory still held is reported at the end
+    soak = getenv(SOAK_GAMES);
+    games = soak ? atol(soak) : 1;
+
+    for (long played = 0; games <= 0 || played < games; played++) {
+        errorMessage = initialise_new_game(&game, gameArgs);
+        if (errorMessage) {
+            handle_game_over(errorMessage);
+        }
 
-    errorMessage = play_game(&game);
+        errorMessage = play_game(&game);
 
-    kill_children(&game);
+        kill_children(&game);
+        if (errorMessage) {
+            handle_game_over(errorMessage);
+        }
+        release_game(&game);
+        ledger_poll();
+    }
+
+    free_game_args(&gameArgs);
+    if (soak) {
+        ledger_report(stderr);
+    }
+    handle_game_over(NORMAL_EXIT);
 
     return NORMAL_EXIT;
 }
@@ -0,0 +1,222 @@
+// ppoll is a GNU extension
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <malloc.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "ledger.h"
+
+
+// The longest process name kept
+#define MAX_NAME 64
+
+
+/* The memory of one subsystem. Sizes are the usable sizes malloc reports,
+ * so that a free can be accounted for without a header on every block.
+ */
+struct Account {
+    // The allocations not yet freed
+    long live;
+    // The bytes of the allocations not yet freed
+    long bytes;
+    // The allocations ever made
+    long total;
+};
+
+
+// The name of each subsystem in a report
+static const char* ledgerNames[LEDGER_COUNT] = {
+    "deck", "seats", "players", "messages", "games", "table",
+};
+
+// The memory of each subsystem, updated atomically since players may
+// allocate from more than one thread
+static struct Account accounts[LEDGER_COUNT];
+
+// The name of this process in its reports
+static char ledgerName[MAX_NAME] = "";
+
+// Set by SIGUSR1 until the report is written
+static volatile sig_atomic_t reportRequested = 0;
+
+
+/* Asks for a report at the next ledger_poll.
+ */
+static void request_report(int s) {
+    (void)s;
+    reportRequested = 1;
+}
+
+
+/* Names this process in its memory reports, and makes SIGUSR1 ask for a
+ * report, which is written to stderr the next time ledger_poll is called
+ * or at once while ledger_wait waits. The handler restarts interrupted
+ * reads, so that a report never ends a game.
+ */
+void ledger_open(const char* processName) {
+    struct sigaction sig;
+
+    snprintf(ledgerName, sizeof(ledgerName), "%s", processName);
+    memset(&sig, 0, sizeof(sig));
+    sig.sa_handler = request_report;
+    sig.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sig, NULL);
+}
+
+
+/* Adds an allocation of the given number of bytes, or removes one given
+ * a negative count.
+ */
+static void account(enum Ledger ledger, long count, long bytes) {
+    struct Account* entry = &accounts[ledger];
+
+    __atomic_add_fetch(&entry->live, count, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&entry->bytes, count * bytes, __ATOMIC_RELAXED);
+    if (count > 0) {
+        __atomic_add_fetch(&entry->total, count, __ATOMIC_RELAXED);
+    }
+}
+
+
+/* Allocates memory as malloc does, accounting for it in the given
+ * subsystem.
+ */
+void* ledger_malloc(enum Ledger ledger, size_t size) {
+    void* pointer = malloc(size);
+
+    ledger_track(ledger, pointer);
+    return pointer;
+}
+
+
+/* Allocates zeroed memory as calloc does, accounting for it in the given
+ * subsystem.
+ */
+void* ledger_calloc(enum Ledger ledger, size_t count, size_t size) {
+    void* pointer = calloc(count, size);
+
+    ledger_track(ledger, pointer);
+    return pointer;
+}
+
+
+/* Resizes memory as realloc does, accounting for the change in the given
+ * subsystem.
+ */
+void* ledger_realloc(enum Ledger ledger, void* pointer, size_t size) {
+    long before = pointer ? malloc_usable_size(pointer) : 0;
+    void* resized = realloc(pointer, size);
+
+    if (!resized) {
+        return NULL;
+    }
+
+    if (pointer) {
+        account(ledger, -1, before);
+    }
+    ledger_track(ledger, resized);
+    return resized;
+}
+
+
+/* Accounts for memory allocated elsewhere, such as by get_line, in the
+ * given subsystem. Does nothing given NULL.
+ */
+void ledger_track(enum Ledger ledger, void* pointer) {
+    if (pointer) {
+        account(ledger, 1, malloc_usable_size(pointer));
+    }
+}
+
+
+/* Frees memory accounted for in the given subsystem. Does nothing given
+ * NULL.
+ */
+void ledger_free(enum Ledger ledger, void* pointer) {
+    if (pointer) {
+        account(ledger, -1, malloc_usable_size(pointer));
+        free(pointer);
+    }
+}
+
+
+/* Returns the resident set size of this process in kilobytes, or 0 if it
+ * is unknown.
+ */
+static long resident_kilobytes(void) {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    long pages = 0;
+
+    if (statm) {
+        if (fscanf(statm, "%*d %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+/* Writes the live allocations and bytes of each subsystem, and the
+ * resident size of the process, to the given file on one line. Each
+ * subsystem which has allocated is written as name=live/bytesB/total.
+ */
+void ledger_report(FILE* out) {
+    fprintf(out, "Memory of %s %d:", ledgerName, (int)getpid());
+    for (int i = 0; i < LEDGER_COUNT; i++) {
+        struct Account* entry = &accounts[i];
+        long total = __atomic_load_n(&entry->total, __ATOMIC_RELAXED);
+
+        if (total) {
+            fprintf(out, " %s=%ld/%ldB/%ld", ledgerNames[i],
+                    __atomic_load_n(&entry->live, __ATOMIC_RELAXED),
+                    __atomic_load_n(&entry->bytes, __ATOMIC_RELAXED), total);
+        }
+    }
+    fprintf(out, " rss=%ldkB\n", resident_kilobytes());
+    fflush(out);
+}
+
+
+/* Writes a report to stderr if one was asked for since the last call.
+ */
+void ledger_poll(void) {
+    if (reportRequested) {
+        reportRequested = 0;
+        ledger_report(stderr);
+    }
+}
+
+
+/* Waits until a file descriptor, such as a listening socket, is readable,
+ * writing each report asked for meanwhile. Returns false if the wait
+ * fails. SIGUSR1 is blocked but while waiting, so that a report asked for
+ * just before the wait is not left until the descriptor is ready; unlike
+ * a read, the wait is never restarted after the handler runs.
+ */
+bool ledger_wait(int fd) {
+    struct pollfd ready = {.fd = fd, .events = POLLIN};
+    sigset_t blocked, original, waiting;
+    int result;
+
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &blocked, &original);
+    waiting = original;
+    sigdelset(&waiting, SIGUSR1);
+
+    do {
+        ledger_poll();
+        result = ppoll(&ready, 1, NULL, &waiting);
+    } while (result < 0 && errno == EINTR);
+
+    sigprocmask(SIG_SETMASK, &original, NULL);
+    return result > 0;
+}
@@ -0,0 +1,69 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/* The subsystems whose memory is accounted for separately. The hub's
+ * memory is in the first four and the players' in the last two.
+ */
+enum Ledger {
+    LEDGER_DECK = 0,
+    LEDGER_SEATS = 1,
+    LEDGER_PLAYERS = 2,
+    LEDGER_MESSAGES = 3,
+    LEDGER_GAMES = 4,
+    LEDGER_TABLE = 5,
+    LEDGER_COUNT = 6
+};
+
+
+/* Names this process in its memory reports, and makes SIGUSR1 ask for a
+ * report, which is written to stderr the next time ledger_poll is called
+ * or at once while ledger_wait waits.
+ */
+void ledger_open(const char* processName);
+
+
+/* Allocates memory as malloc, calloc and realloc do, accounting for it in
+ * the given subsystem.
+ */
+void* ledger_malloc(enum Ledger ledger, size_t size);
+void* ledger_calloc(enum Ledger ledger, size_t count, size_t size);
+void* ledger_realloc(enum Ledger ledger, void* pointer, size_t size);
+
+
+/* Accounts for memory allocated elsewhere, such as by get_line, in the
+ * given subsystem. Does nothing given NULL.
+ */
+void ledger_track(enum Ledger ledger, void* pointer);
+
+
+/* Frees memory accounted for in the given subsystem. Does nothing given
+ * NULL.
+ */
+void ledger_free(enum Ledger ledger, void* pointer);
+
+
+/* Writes the live allocations and bytes of each subsystem, and the
+ * resident size of the process, to the given file on one line. Each
+ * subsystem which has allocated is written as name=live/bytesB/total.
+ */
+void ledger_report(FILE* out);
+
+
+/* Writes a report to stderr if one was asked for since the last call.
+ */
+void ledger_poll(void);
+
+
+/* Waits until a file descriptor, such as a listening socket, is readable,
+ * writing each report asked for meanwhile. Returns false if the wait
+ * fails.
+ */
+bool ledger_wait(int fd);
+
+
+#endif
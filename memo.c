@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "memo.h"
+#include "strategy.h"
+
+
+// The first bytes of a cache file, with the version of its format
+#define MEMO_MAGIC "2310memo2"
+
+// The size of the header before the entries, one cache line
+#define MEMO_HEADER 64
+
+// The size of a whole cache file
+#define MEMO_SIZE (MEMO_HEADER + sizeof(uint64_t) * MEMO_ENTRIES)
+
+// The bits of an entry holding its card, which are 0 in an empty entry
+#define CARD_BITS 0xff
+
+
+/* Writes the header of a cache file built with these rules to header,
+ * which has space for MEMO_HEADER bytes: the magic, then the suits, the
+ * diamond suit and the ranks, which the entries' keys and cards are
+ * encoded with. The rest is zeroed.
+ */
+static void memo_header(char* header) {
+    memset(header, 0, MEMO_HEADER);
+    snprintf(header, MEMO_HEADER, "%s %s %d %d %d", MEMO_MAGIC, RULES_SUITS,
+            RULES_DIAMONDS, RULES_MIN_RANK, RULES_MAX_RANK);
+}
+
+
+/* Opens the decision cache in the given file, creating it if needed.
+ * Returns NULL if the file cannot be used, or was made by a build with
+ * other rules or another version of the format.
+ */
+struct Memo* memo_open(const char* path) {
+    struct Memo* memo;
+    struct stat info;
+    void* mapping;
+    char header[MEMO_HEADER];
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // every process creating the file writes the same size and header
+    memo_header(header);
+    if (fstat(fd, &info) || (info.st_size == 0 &&
+            (ftruncate(fd, MEMO_SIZE) || pwrite(fd, header, MEMO_HEADER,
+            0) != MEMO_HEADER)) ||
+            (info.st_size != 0 && info.st_size != (off_t)MEMO_SIZE)) {
+        close(fd);
+        return NULL;
+    }
+
+    mapping = mmap(NULL, MEMO_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+            0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (memcmp(mapping, header, MEMO_HEADER)) {
+        munmap(mapping, MEMO_SIZE);
+        return NULL;
+    }
+
+    memo = calloc(1, sizeof(struct Memo));
+    memo->mapping = mapping;
+    memo->entries = (uint64_t*)((char*)mapping + MEMO_HEADER);
+    return memo;
+}
+
+
+/* Returns the key of the decision the strategy is about to make: to lead
+ * if lead is set, and to follow otherwise. The key covers the strategy's
+ * name, version and parameters, the game's arguments, the cards in the
+ * hand, the diamonds won by each player and, to follow, the lead suit and
+ * whether a diamond has been played in the round.
+ */
+uint64_t memo_key(const struct Game* game, bool lead) {
+    uint64_t hash = 0;
+    uint64_t hand = 0;
+
+    for (const char* name = game->strategy->name; *name; name++) {
+        hash = mix_hash(hash, (unsigned char)*name);
+    }
+    hash = mix_hash(hash, game->strategy->version);
+
+    if (game->strategy->params) {
+        hash = mix_hash(hash, ',');
+        for (const char* params = game->strategy->params; *params;
+                params++) {
+            hash = mix_hash(hash, (unsigned char)*params);
+        }
+    }
+
+    for (int i = 0; i < game->handSize; i++) {
+        hand |= (uint64_t)1 << (suit_index(game->hand[i].suit) *
+                (MAX_RANK + 1) + game->hand[i].rank);
+    }
+
+    hash = mix_hash(hash, hand);
+    hash = mix_hash(hash, (uint64_t)game->numPlayers << 32 |
+            game->threshold);
+    for (int i = 0; i < game->numPlayers; i++) {
+        hash = mix_hash(hash, game->numDiamondCards[i]);
+    }
+
+    if (lead) {
+        return mix_hash(hash, 0);
+    }
+
+    return mix_hash(hash, 1 + suit_index(game->leadCard.suit) * 2 +
+            (game->roundDiamonds > 0));
+}
+
+
+/* Returns the first entry a key may be stored in. The index is taken from
+ * the top bits of the key, while the entry keeps all but the bottom bits.
+ */
+static uint64_t* key_entries(struct Memo* memo, uint64_t key) {
+    return &memo->entries[(key >> 40) & (MEMO_ENTRIES - MEMO_WAYS)];
+}
+
+
+/* Looks up a decision by its key. Returns true and sets card if found.
+ */
+bool memo_find(struct Memo* memo, uint64_t key, struct Card* card) {
+    uint64_t* entries = key_entries(memo, key);
+
+    for (int i = 0; i < MEMO_WAYS; i++) {
+        uint64_t entry = __atomic_load_n(&entries[i], __ATOMIC_RELAXED);
+
+        if ((entry & CARD_BITS) && !((entry ^ key) & ~(uint64_t)CARD_BITS)) {
+            int number = (entry & CARD_BITS) - 1;
+
+            card->suit = SUITS[number / (MAX_RANK + 1)];
+            card->rank = number % (MAX_RANK + 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* Stores a decision under its key, in an empty entry if there is one and
+ * otherwise in place of one chosen by the key.
+ */
+void memo_store(struct Memo* memo, uint64_t key, struct Card card) {
+    uint64_t* entries = key_entries(memo, key);
+    uint64_t entry = (key & ~(uint64_t)CARD_BITS) |
+            (suit_index(card.suit) * (MAX_RANK + 1) + card.rank + 1);
+    int way = key % MEMO_WAYS;
+
+    for (int i = 0; i < MEMO_WAYS; i++) {
+        if (!__atomic_load_n(&entries[i], __ATOMIC_RELAXED)) {
+            way = i;
+            break;
+        }
+    }
+
+    __atomic_store_n(&entries[way], entry, __ATOMIC_RELAXED);
+}
+
+
+/* Unmaps the decision cache. Its entries stay in the file.
+ */
+void memo_close(struct Memo* memo) {
+    if (memo) {
+        munmap(memo->mapping, MEMO_SIZE);
+        free(memo);
+    }
+}
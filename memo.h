@@ -0,0 +1,76 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "players.h"
+
+
+/* The environment variable naming the file of the decision cache. Without
+ * it decisions are not cached.
+ */
+#define MEMO_ENV "STRATEGY_MEMO"
+
+
+/* The number of decisions the cache holds. It is a power of two.
+ */
+#define MEMO_ENTRIES (1 << 20)
+
+
+/* The number of entries a decision may be stored in, which share a cache
+ * line.
+ */
+#define MEMO_WAYS 4
+
+
+/* A fixed-size cache of the decisions of pure strategies, mapped from a
+ * file so that it persists between runs and is shared by every thread and
+ * process using the same file. Each entry is one 64 bit word holding the
+ * top bits of a decision's key and its card, read and written atomically,
+ * so that no locks are needed. Entries may be overwritten at any time,
+ * which only costs the decision being made again.
+ */
+struct Memo {
+    // The entries, following the file's header
+    uint64_t* entries;
+    // The mapping of the whole file
+    void* mapping;
+};
+
+
+/* Opens the decision cache in the given file, creating it if needed.
+ * Returns NULL if the file cannot be used, or was made by a build with
+ * other rules or another version of the format, so that its entries are
+ * never decoded with the wrong suits or ranks.
+ */
+struct Memo* memo_open(const char* path);
+
+
+/* Returns the key of the decision the strategy is about to make: to lead
+ * if lead is set, and to follow otherwise. The key covers the strategy's
+ * name, version and parameters, the game's arguments, the cards in the
+ * hand, the diamonds won by each player and, to follow, the lead suit and
+ * whether a diamond has been played in the round.
+ */
+uint64_t memo_key(const struct Game* game, bool lead);
+
+
+/* Looks up a decision by its key. Returns true and sets card if found.
+ */
+bool memo_find(struct Memo* memo, uint64_t key, struct Card* card);
+
+
+/* Stores a decision under its key.
+ */
+void memo_store(struct Memo* memo, uint64_t key, struct Card card);
+
+
+/* Unmaps the decision cache. Its entries stay in the file.
+ */
+void memo_close(struct Memo* memo);
+
+
+#endif
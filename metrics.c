@@ -0,0 +1,352 @@
+// fopencookie is a GNU extension
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "metrics.h"
+#include "transport.h"
+
+
+// How long a client has to send its request before the metrics are sent
+#define REQUEST_WAIT_MS 100
+
+// The largest request read from a client, the rest is ignored
+#define REQUEST_SIZE 1024
+
+// The upper bounds of the latency buckets, in nanoseconds
+static const uint64_t bucketNanos[METRICS_BUCKETS] = {
+    10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000,
+};
+
+// The upper bounds of the latency buckets, as Prometheus labels
+static const char* bucketLabels[METRICS_BUCKETS] = {
+    "1e-05", "0.0001", "0.001", "0.01", "0.1", "1", "10",
+};
+
+
+/* A stream on a connection whose reads or writes are counted.
+ */
+struct CountedStream {
+    // The connection
+    int fd;
+    // The metrics to count in
+    struct Metrics* metrics;
+};
+
+
+/* The state of the thread serving the metrics.
+ */
+struct Server {
+    // The listening socket
+    int listener;
+    // The metrics served
+    struct Metrics* metrics;
+    // The rounds completed and the time at the previous scrape
+    uint64_t lastRounds;
+    uint64_t lastNanos;
+};
+
+
+/* Returns the current time in nanoseconds, for measuring latencies.
+ */
+uint64_t metrics_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+/* Records the latency of a reply from a seat.
+ */
+void metrics_reply(struct Metrics* metrics, int seat, uint64_t nanos) {
+    struct Latency* latency = &metrics->latency[seat];
+
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        if (nanos <= bucketNanos[i]) {
+            metrics_add(&latency->buckets[i], 1);
+        }
+    }
+    metrics_add(&latency->sumNanos, nanos);
+    metrics_add(&latency->count, 1);
+}
+
+
+/* Reads from a counted stream's connection.
+ */
+static ssize_t counted_read(void* cookie, char* buffer, size_t size) {
+    struct CountedStream* stream = cookie;
+    ssize_t length = read(stream->fd, buffer, size);
+
+    metrics_add(&stream->metrics->readCalls, 1);
+    if (length > 0) {
+        metrics_add(&stream->metrics->bytesRead, length);
+    }
+    return length;
+}
+
+
+/* Writes to a counted stream's connection.
+ */
+static ssize_t counted_write(void* cookie, const char* buffer, size_t size) {
+    struct CountedStream* stream = cookie;
+    ssize_t length = write(stream->fd, buffer, size);
+
+    metrics_add(&stream->metrics->writeCalls, 1);
+    if (length > 0) {
+        metrics_add(&stream->metrics->bytesWritten, length);
+    }
+    return length;
+}
+
+
+/* Closes a counted stream's connection.
+ */
+static int counted_close(void* cookie) {
+    struct CountedStream* stream = cookie;
+    int result = close(stream->fd);
+
+    free(stream);
+    return result;
+}
+
+
+/* Opens a counted stream on a connection in the given mode.
+ */
+static FILE* open_counted(struct Metrics* metrics, int fd, const char* mode) {
+    struct CountedStream* stream = malloc(sizeof(struct CountedStream));
+    cookie_io_functions_t functions = {
+        .read = counted_read,
+        .write = counted_write,
+        .close = counted_close,
+    };
+    FILE* file;
+
+    stream->fd = fd;
+    stream->metrics = metrics;
+    file = fopencookie(stream, mode, functions);
+    if (!file) {
+        free(stream);
+    }
+    return file;
+}
+
+
+/* Opens the streams of a connection as open_streams does, but counts the
+ * bytes and system calls made on them in the metrics.
+ */
+bool metrics_open_streams(struct Metrics* metrics, int socket, FILE** input,
+        FILE** output) {
+    int copy = dup(socket);
+
+    *input = copy >= 0 ? open_counted(metrics, socket, "r") : NULL;
+    *output = *input ? open_counted(metrics, copy, "w") : NULL;
+
+    if (!*output) {
+        if (*input) {
+            fclose(*input);
+        } else {
+            close(socket);
+        }
+        if (copy >= 0) {
+            close(copy);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Returns the resident set size of this process in bytes, or 0 if it is
+ * unknown.
+ */
+static long resident_bytes(void) {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    long pages = 0;
+
+    if (statm) {
+        if (fscanf(statm, "%*d %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+
+/* Loads a metric written by the hub's thread.
+ */
+static uint64_t load(const uint64_t* metric) {
+    return __atomic_load_n(metric, __ATOMIC_RELAXED);
+}
+
+
+/* Writes a metric with its type and value.
+ */
+static void write_metric(FILE* out, const char* prefix, const char* name,
+        const char* type, const char* help, double value) {
+    fprintf(out, "# HELP %s_%s %s\n# TYPE %s_%s %s\n%s_%s %.17g\n", prefix,
+            name, help, prefix, name, type, prefix, name, value);
+}
+
+
+/* Writes the latency histogram of every seat.
+ */
+static void write_latency(FILE* out, const struct Metrics* metrics) {
+    const char* prefix = metrics->prefix;
+
+    fprintf(out, "# HELP %s_reply_seconds Time from sending a seat its turn "
+            "to reading its card.\n# TYPE %s_reply_seconds histogram\n",
+            prefix, prefix);
+    for (int seat = 0; seat < metrics->numSeats; seat++) {
+        const struct Latency* latency = &metrics->latency[seat];
+
+        for (int i = 0; i < METRICS_BUCKETS; i++) {
+            fprintf(out, "%s_reply_seconds_bucket{seat=\"%d\",le=\"%s\"} "
+                    "%lu\n", prefix, seat, bucketLabels[i],
+                    (unsigned long)load(&latency->buckets[i]));
+        }
+        fprintf(out, "%s_reply_seconds_bucket{seat=\"%d\",le=\"+Inf\"} %lu\n"
+                "%s_reply_seconds_sum{seat=\"%d\"} %.9f\n"
+                "%s_reply_seconds_count{seat=\"%d\"} %lu\n", prefix, seat,
+                (unsigned long)load(&latency->count), prefix, seat,
+                load(&latency->sumNanos) / 1e9, prefix, seat,
+                (unsigned long)load(&latency->count));
+    }
+}
+
+
+/* Writes every metric in Prometheus' text format. The rate of rounds is
+ * measured since the previous scrape.
+ */
+static void write_metrics(FILE* out, struct Server* server) {
+    const struct Metrics* metrics = server->metrics;
+    const char* prefix = metrics->prefix;
+    uint64_t rounds = load(&metrics->roundsCompleted);
+    uint64_t now = metrics_now();
+    double rate = (rounds - server->lastRounds) * 1e9 /
+            (now - server->lastNanos);
+
+    server->lastRounds = rounds;
+    server->lastNanos = now;
+
+    write_metric(out, prefix, "games_completed_total", "counter",
+            "Games finished.", load(&metrics->gamesCompleted));
+    write_metric(out, prefix, "games_in_flight", "gauge",
+            "Games being played.", load(&metrics->gamesInFlight));
+    write_metric(out, prefix, "rounds_completed_total", "counter",
+            "Rounds finished.", rounds);
+    write_metric(out, prefix, "rounds_per_second", "gauge",
+            "Rounds finished per second since the previous scrape.", rate);
+    write_metric(out, prefix, "read_bytes_total", "counter",
+            "Bytes read from the players.", load(&metrics->bytesRead));
+    write_metric(out, prefix, "written_bytes_total", "counter",
+            "Bytes written to the players.", load(&metrics->bytesWritten));
+    write_metric(out, prefix, "read_syscalls_total", "counter",
+            "Reads made on the players' connections.",
+            load(&metrics->readCalls));
+    write_metric(out, prefix, "write_syscalls_total", "counter",
+            "Writes made on the players' connections.",
+            load(&metrics->writeCalls));
+    write_latency(out, metrics);
+    write_metric(out, "process", "resident_memory_bytes", "gauge",
+            "Resident memory size in bytes.", resident_bytes());
+}
+
+
+/* Answers one client: waits briefly for its request, then sends the
+ * metrics, after an HTTP header if the request was an HTTP one.
+ */
+static void answer_client(struct Server* server, int client) {
+    struct pollfd request = {.fd = client, .events = POLLIN};
+    char buffer[REQUEST_SIZE];
+    ssize_t length = 0;
+    char* body = NULL;
+    size_t bodySize = 0;
+    FILE* out = open_memstream(&body, &bodySize);
+
+    if (poll(&request, 1, REQUEST_WAIT_MS) > 0) {
+        length = read(client, buffer, sizeof(buffer));
+    }
+
+    write_metrics(out, server);
+    fclose(out);
+
+    if (length >= 4 && !strncmp(buffer, "GET ", 4)) {
+        dprintf(client, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; "
+                "version=0.0.4\r\nContent-Length: %zu\r\n\r\n", bodySize);
+    }
+    if (write(client, body, bodySize) < 0) {
+        // the client has gone, which is its own concern
+    }
+
+    free(body);
+    close(client);
+}
+
+
+/* Serves the metrics to every client connecting, until the listening
+ * socket fails.
+ */
+static void* serve_metrics(void* argument) {
+    struct Server* server = argument;
+
+    while (1) {
+        int client = accept_connection(server->listener);
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        answer_client(server, client);
+    }
+
+    return NULL;
+}
+
+
+/* Starts serving the metrics in Prometheus' text format on the given
+ * address, from a thread of their own. Every connection is sent the
+ * current metrics and closed, with an HTTP header if it sent an HTTP
+ * request. Returns NULL if the address cannot be listened on.
+ */
+struct Metrics* metrics_start(const char* address, const char* prefix,
+        int numSeats) {
+    struct Server* server;
+    pthread_t thread;
+    int listener = listen_address(address);
+
+    if (listener < 0) {
+        return NULL;
+    }
+
+    server = calloc(1, sizeof(struct Server));
+    server->listener = listener;
+    server->metrics = calloc(1, sizeof(struct Metrics));
+    server->metrics->prefix = prefix;
+    server->metrics->numSeats = numSeats;
+    server->lastNanos = metrics_now();
+
+    if (pthread_create(&thread, NULL, serve_metrics, server)) {
+        close(listener);
+        free(server->metrics);
+        free(server);
+        return NULL;
+    }
+    pthread_detach(thread);
+
+    return server->metrics;
+}
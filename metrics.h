@@ -0,0 +1,91 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rules.h"
+
+
+/* The number of finite buckets of the reply latency histograms, whose
+ * upper bounds are 10us and each tenfold larger up to 10s.
+ */
+#define METRICS_BUCKETS 7
+
+
+/* The latency of one seat's replies, as a cumulative histogram.
+ */
+struct Latency {
+    // The number of replies no slower than each bucket's bound
+    uint64_t buckets[METRICS_BUCKETS];
+    // The number of replies
+    uint64_t count;
+    // The total time of the replies, in nanoseconds
+    uint64_t sumNanos;
+};
+
+
+/* The live counters and gauges of a running hub. They are written only by
+ * the hub's own thread, each with a relaxed atomic store, so the hot path
+ * takes no locks, and read by the thread serving the metrics socket, which
+ * may see the counters of a scrape a few updates apart.
+ */
+struct Metrics {
+    // The number of games finished
+    uint64_t gamesCompleted;
+    // The number of games being played
+    uint64_t gamesInFlight;
+    // The number of rounds finished
+    uint64_t roundsCompleted;
+    // The bytes read from and written to the players
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    // The read and write system calls made on the players' connections
+    uint64_t readCalls;
+    uint64_t writeCalls;
+    // The latency of each seat's replies
+    struct Latency latency[RULES_MAX_SEATS];
+    // The number of seats
+    int numSeats;
+    // The prefix of every metric's name
+    const char* prefix;
+};
+
+
+/* Starts serving the metrics in Prometheus' text format on the given
+ * address, from a thread of their own. Every connection is sent the
+ * current metrics and closed, with an HTTP header if it sent an HTTP
+ * request. Returns NULL if the address cannot be listened on.
+ */
+struct Metrics* metrics_start(const char* address, const char* prefix,
+        int numSeats);
+
+
+/* Adds to a counter, or to a gauge if the amount is negative. The
+ * metrics must only be written by one thread.
+ */
+static inline void metrics_add(uint64_t* counter, int64_t amount) {
+    __atomic_store_n(counter, *counter + amount, __ATOMIC_RELAXED);
+}
+
+
+/* Returns the current time in nanoseconds, for measuring latencies.
+ */
+uint64_t metrics_now(void);
+
+
+/* Records the latency of a reply from a seat.
+ */
+void metrics_reply(struct Metrics* metrics, int seat, uint64_t nanos);
+
+
+/* Opens the streams of a connection as open_streams does, but counts the
+ * bytes and system calls made on them in the metrics.
+ */
+bool metrics_open_streams(struct Metrics* metrics, int socket, FILE** input,
+        FILE** output);
+
+
+#endif
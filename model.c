@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+
+
+/* Forces a helper to be inlined into each engine, so that it is compiled
+ * with the engine's number of players.
+ */
+#define ENGINE_INLINE static inline __attribute__((always_inline))
+
+
+/* Returns the slot of a suit character, or -1 if it is not a suit.
+ */
+int model_suit(char suit) {
+    const char* position = suit ? strchr(MODEL_SUITS, suit) : NULL;
+
+    return position ? position - MODEL_SUITS : -1;
+}
+
+
+/* Returns the card number of a suit character and decimal rank.
+ */
+int model_card(char suit, int rank) {
+    return model_suit(suit) * MODEL_SUIT_BITS + rank;
+}
+
+
+/* Returns the suit character of a card number.
+ */
+char model_card_suit(int card) {
+    return MODEL_SUITS[card / MODEL_SUIT_BITS];
+}
+
+
+/* Returns the decimal rank of a card number.
+ */
+int model_card_rank(int card) {
+    return card % MODEL_SUIT_BITS;
+}
+
+
+/* Returns the cards of the given suit slot held in a hand mask, as a mask
+ * of ranks.
+ */
+unsigned model_suit_ranks(uint64_t hand, int suit) {
+    return (unsigned)(hand >> (suit * MODEL_SUIT_BITS)) & 0xffff;
+}
+
+
+/* Starts a new game with empty hands. Hands are added with model_deal.
+ */
+void model_init(struct ModelState* state, int numPlayers, int threshold,
+        int handSize) {
+    memset(state, 0, sizeof(*state));
+    state->numPlayers = numPlayers;
+    state->threshold = threshold;
+    state->leadSuit = -1;
+    state->roundsLeft = handSize;
+}
+
+
+/* Gives a card to a player.
+ */
+void model_deal(struct ModelState* state, int player, int card) {
+    state->hands[player] |= (uint64_t)1 << card;
+    state->handCounts[player]++;
+}
+
+
+/* Returns the cards of a hand which may be played on a lead suit, or
+ * before the lead if the suit is -1.
+ */
+ENGINE_INLINE uint64_t legal_moves(uint64_t hand, int leadSuit) {
+    uint64_t follow;
+
+    if (leadSuit < 0) {
+        return hand;
+    }
+
+    follow = hand & ((uint64_t)0xffff << (leadSuit * MODEL_SUIT_BITS));
+    return follow ? follow : hand;
+}
+
+
+/* Returns the mask of cards the current player may play.
+ */
+uint64_t model_legal_moves(const struct ModelState* state) {
+    return legal_moves(state->hands[state->currentPlayer], state->leadSuit);
+}
+
+
+/* Scores the round once every player has played, and starts the next
+ * round with its winner leading.
+ */
+ENGINE_INLINE void finish_round(struct ModelState* state) {
+    state->points[state->roundWinner]++;
+    state->diamonds[state->roundWinner] += state->roundDiamonds;
+    state->leadPlayer = state->roundWinner;
+    state->currentPlayer = state->roundWinner;
+    state->numCardsPlayed = 0;
+    state->leadSuit = -1;
+    state->roundDiamonds = 0;
+    state->roundsLeft--;
+}
+
+
+/* Plays a card for the current player in a game of numPlayers players.
+ */
+ENGINE_INLINE void play_card(struct ModelState* state, int card,
+        int numPlayers) {
+    int player = state->currentPlayer;
+    int suit = card / MODEL_SUIT_BITS;
+    int rank = card % MODEL_SUIT_BITS;
+
+    state->hands[player] &= ~((uint64_t)1 << card);
+    state->handCounts[player]--;
+
+    if (state->leadSuit < 0) {
+        state->leadSuit = suit;
+        state->roundWinner = player;
+        state->winningRank = rank;
+    } else if (suit == state->leadSuit && rank > state->winningRank) {
+        state->roundWinner = player;
+        state->winningRank = rank;
+    }
+
+    if (suit == MODEL_DIAMONDS) {
+        state->roundDiamonds++;
+    }
+
+    state->currentPlayer = (player + 1) % numPlayers;
+
+    if (++state->numCardsPlayed == numPlayers) {
+        finish_round(state);
+    }
+}
+
+
+/* Plays a card for the current player, finishing the round once every
+ * player has played. The card is removed from the player's hand if held,
+ * so that a state with unknown hands can follow a real game.
+ */
+void model_play(struct ModelState* state, int card) {
+    play_card(state, card, state->numPlayers);
+}
+
+
+/* Returns the next number of a pseudo random sequence (xorshift64*),
+ * advancing its state, which must not be 0.
+ */
+ENGINE_INLINE uint64_t next_random(uint64_t* random) {
+    *random ^= *random >> 12;
+    *random ^= *random << 25;
+    *random ^= *random >> 27;
+    return *random * 0x2545f4914f6cdd1dULL;
+}
+
+
+/* Returns a uniformly chosen card from a non-empty mask.
+ */
+ENGINE_INLINE int random_card(uint64_t* random, uint64_t cards) {
+    int skip = (int)(next_random(random) %
+            (uint64_t)__builtin_popcountll(cards));
+
+    while (skip--) {
+        cards &= cards - 1;
+    }
+
+    return __builtin_ctzll(cards);
+}
+
+
+/* Returns the next number of a pseudo random sequence (xorshift64*),
+ * advancing its state, which must not be 0.
+ */
+uint64_t model_random(uint64_t* random) {
+    return next_random(random);
+}
+
+
+/* Returns a uniformly chosen card from a non-empty mask.
+ */
+int model_random_card(uint64_t* random, uint64_t cards) {
+    return random_card(random, cards);
+}
+
+
+/* Plays a whole round of random legal cards, from the lead to the last
+ * player. The round is kept in locals and the seats are visited in order
+ * without a division, so that with a fixed number of players the loop is
+ * unrolled. Chooses the same cards as play_card would from the same
+ * random numbers.
+ */
+ENGINE_INLINE void play_random_round(struct ModelState* state,
+        uint64_t* random, int numPlayers) {
+    int lead = state->leadPlayer;
+    int card = random_card(random, state->hands[lead]);
+    int leadSuit = card / MODEL_SUIT_BITS;
+    uint64_t suitCards = (uint64_t)0xffff << (leadSuit * MODEL_SUIT_BITS);
+    int winningRank = card % MODEL_SUIT_BITS;
+    int roundDiamonds = leadSuit == MODEL_DIAMONDS;
+
+    state->roundWinner = lead;
+    state->hands[lead] &= ~((uint64_t)1 << card);
+    state->handCounts[lead]--;
+
+    for (int i = 1; i < numPlayers; i++) {
+        int player = lead + i < numPlayers ? lead + i : lead + i - numPlayers;
+        uint64_t hand = state->hands[player];
+        uint64_t follow = hand & suitCards;
+        int rank;
+
+        card = random_card(random, follow ? follow : hand);
+        rank = card % MODEL_SUIT_BITS;
+        if (follow && rank > winningRank) {
+            state->roundWinner = player;
+            winningRank = rank;
+        }
+        roundDiamonds += card / MODEL_SUIT_BITS == MODEL_DIAMONDS;
+        state->hands[player] = hand & ~((uint64_t)1 << card);
+        state->handCounts[player]--;
+    }
+
+    state->winningRank = winningRank;
+    state->roundDiamonds = roundDiamonds;
+    finish_round(state);
+}
+
+
+/* Plays random legal cards until the end of the game: the current round
+ * card by card, and then whole rounds.
+ */
+ENGINE_INLINE void play_out(struct ModelState* state, uint64_t* random,
+        int numPlayers) {
+    while (state->numCardsPlayed && state->roundsLeft > 0) {
+        play_card(state, random_card(random,
+                legal_moves(state->hands[state->currentPlayer],
+                state->leadSuit)), numPlayers);
+    }
+
+    while (state->roundsLeft > 0) {
+        play_random_round(state, random, numPlayers);
+    }
+}
+
+
+/* Returns the final score of a player, as defined by the hub.
+ */
+ENGINE_INLINE int score(const struct ModelState* state, int player) {
+    if (state->diamonds[player] < state->threshold) {
+        return state->points[player] - state->diamonds[player];
+    }
+
+    return state->points[player] + state->diamonds[player];
+}
+
+
+/* Returns a player's final score less the average of the other players'.
+ */
+ENGINE_INLINE double margin(const struct ModelState* state, int player,
+        int numPlayers) {
+    double others = 0;
+
+    for (int i = 0; i < numPlayers; i++) {
+        if (i != player) {
+            others += score(state, i);
+        }
+    }
+
+    others /= numPlayers - 1;
+    return score(state, player) - others;
+}
+
+
+/* Defines the engine functions for a fixed number of players.
+ */
+#define DEFINE_ENGINE(players) \
+    static void play_out_##players(struct ModelState* state, \
+            uint64_t* random) { \
+        play_out(state, random, players); \
+    } \
+    static double margin_##players(const struct ModelState* state, \
+            int player) { \
+        return margin(state, player, players); \
+    }
+
+DEFINE_ENGINE(2)
+DEFINE_ENGINE(3)
+DEFINE_ENGINE(4)
+
+
+/* The engine functions for any number of players.
+ */
+static void play_out_any(struct ModelState* state, uint64_t* random) {
+    play_out(state, random, state->numPlayers);
+}
+
+static double margin_any(const struct ModelState* state, int player) {
+    return margin(state, player, state->numPlayers);
+}
+
+
+/* The engines, with the generic one last.
+ */
+static const struct ModelEngine engines[] = {
+    {2, play_out_2, margin_2},
+    {3, play_out_3, margin_3},
+    {4, play_out_4, margin_4},
+    {0, play_out_any, margin_any},
+};
+
+
+/* Returns the engine for games with the given number of players: one
+ * specialised for it if there is one, or the generic engine otherwise.
+ */
+const struct ModelEngine* model_engine(int numPlayers) {
+    int last = sizeof(engines) / sizeof(engines[0]) - 1;
+
+    for (int i = 0; i < last; i++) {
+        if (engines[i].numPlayers == numPlayers &&
+                numPlayers <= MODEL_MAX_PLAYERS) {
+            return &engines[i];
+        }
+    }
+
+    return &engines[last];
+}
+
+
+/* Returns true once all rounds have been played.
+ */
+bool model_is_over(const struct ModelState* state) {
+    return state->roundsLeft <= 0;
+}
+
+
+/* Returns the final score of a player, as defined by the hub.
+ */
+int model_score(const struct ModelState* state, int player) {
+    return score(state, player);
+}
+
+
+/* Returns the number of the lowest card in a mask, which must not be empty.
+ */
+int model_lowest_card(uint64_t cards) {
+    return __builtin_ctzll(cards);
+}
+
+
+/* Returns the number of cards in a mask.
+ */
+int model_count(uint64_t cards) {
+    return __builtin_popcountll(cards);
+}
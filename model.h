@@ -0,0 +1,183 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rules.h"
+
+
+/* The most players the in-process model supports.
+ */
+#define MODEL_MAX_PLAYERS RULES_MAX_SEATS
+
+
+/* The number of card slots per suit in a hand mask. Ranks 1 to f use
+ * bits 1 to 15 of their suit's slot.
+ */
+#define MODEL_SUIT_BITS 16
+
+
+/* The suits in the order used for mask slots.
+ */
+#define MODEL_SUITS RULES_SUITS
+
+
+/* The slot of the diamond suit.
+ */
+#define MODEL_DIAMONDS RULES_DIAMONDS
+
+
+/* The ranks of the rules in one suit slot.
+ */
+#define MODEL_RANKS (((uint64_t)1 << (RULES_MAX_RANK + 1)) - \
+        ((uint64_t)1 << RULES_MIN_RANK))
+
+
+/* Every card of the rules, as a hand mask.
+ */
+#define MODEL_ALL_CARDS (MODEL_RANKS * \
+        ((~(uint64_t)0 >> (64 - MODEL_SUIT_BITS * RULES_NUM_SUITS)) / 0xffff))
+
+
+/* A compact copy of a game, used to simulate games inside one process.
+ * Cards are numbered suit * MODEL_SUIT_BITS + rank, so that a hand is a
+ * 64 bit mask with one 16 bit slot per suit.
+ */
+struct ModelState {
+    // The number of players in the game
+    int numPlayers;
+    // The threshold number of diamonds
+    int threshold;
+    // The cards each player holds
+    uint64_t hands[MODEL_MAX_PLAYERS];
+    // The number of cards each player holds
+    int handCounts[MODEL_MAX_PLAYERS];
+    // The number of rounds each player has won
+    int points[MODEL_MAX_PLAYERS];
+    // The number of diamonds each player has won
+    int diamonds[MODEL_MAX_PLAYERS];
+    // The player leading the current round
+    int leadPlayer;
+    // The player to play next
+    int currentPlayer;
+    // The number of cards played in the current round
+    int numCardsPlayed;
+    // The lead suit of the current round, or -1 before the lead
+    int leadSuit;
+    // The player winning the current round so far
+    int roundWinner;
+    // The rank of the winning card so far
+    int winningRank;
+    // The number of diamonds played in the current round
+    int roundDiamonds;
+    // The number of rounds left to play, including the current one
+    int roundsLeft;
+};
+
+
+/* The parts of the model which run in the inner loop of a search, with
+ * the number of players fixed where an engine is specialised for it, so
+ * that the compiler can unroll and constant fold them. model_engine picks
+ * the engine of a game when it starts.
+ */
+struct ModelEngine {
+    // The number of players the engine is specialised for, or 0 for any
+    int numPlayers;
+    // Plays uniformly random legal cards until the end of the game, using
+    // the random number generator state given
+    void (*playOut)(struct ModelState* state, uint64_t* random);
+    // Returns a player's final score less the average of the others
+    double (*margin)(const struct ModelState* state, int player);
+};
+
+
+/* Returns the engine for games with the given number of players: one
+ * specialised for it if there is one, or the generic engine otherwise.
+ */
+const struct ModelEngine* model_engine(int numPlayers);
+
+
+/* Returns the next number of a pseudo random sequence (xorshift64*),
+ * advancing its state, which must not be 0.
+ */
+uint64_t model_random(uint64_t* random);
+
+
+/* Returns a uniformly chosen card from a non-empty mask.
+ */
+int model_random_card(uint64_t* random, uint64_t cards);
+
+
+/* Returns the slot of a suit character, or -1 if it is not a suit.
+ */
+int model_suit(char suit);
+
+
+/* Returns the card number of a suit character and decimal rank.
+ */
+int model_card(char suit, int rank);
+
+
+/* Returns the suit character of a card number.
+ */
+char model_card_suit(int card);
+
+
+/* Returns the decimal rank of a card number.
+ */
+int model_card_rank(int card);
+
+
+/* Returns the cards of the given suit slot held in a hand mask, as a mask
+ * of ranks.
+ */
+unsigned model_suit_ranks(uint64_t hand, int suit);
+
+
+/* Starts a new game with empty hands. Hands are added with model_deal.
+ */
+void model_init(struct ModelState* state, int numPlayers, int threshold,
+        int handSize);
+
+
+/* Gives a card to a player.
+ */
+void model_deal(struct ModelState* state, int player, int card);
+
+
+/* Returns the mask of cards the current player may play.
+ */
+uint64_t model_legal_moves(const struct ModelState* state);
+
+
+/* Plays a card for the current player, finishing the round once every
+ * player has played. The card is removed from the player's hand if held,
+ * so that a state with unknown hands can follow a real game.
+ */
+void model_play(struct ModelState* state, int card);
+
+
+/* Returns true once all rounds have been played.
+ */
+bool model_is_over(const struct ModelState* state);
+
+
+/* Returns the final score of a player, as defined by the hub.
+ */
+int model_score(const struct ModelState* state, int player);
+
+
+/* Returns the number of the lowest card in a mask, which must not be empty.
+ */
+int model_lowest_card(uint64_t cards);
+
+
+/* Returns the number of cards in a mask.
+ */
+int model_count(uint64_t cards);
+
+
+#endif
@@ -0,0 +1,757 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "utilities.h"
+#include "transport.h"
+#include "model.h"
+#include "deck.h"
+#include "stats.h"
+#include "batch.h"
+#include "canon.h"
+#include "metrics.h"
+#include "columns.h"
+
+// The number of games played at once unless -w is given
+#define DEFAULT_WINDOW 256
+
+// The most games played at once, so that the replies a player sends in one
+// step of every game always fit in the connection's socket buffer
+#define MAX_WINDOW 4096
+
+
+/* Defines all possible exit statuses of the multiplexing hub, with the
+ * same values as the hub's.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INVALID_THRESHOLD = 2,
+    DECK_ERROR = 3,
+    SMALL_DECK = 4,
+    PLAYER_ERROR = 5,
+    PLAYER_EOF = 6,
+    INVALID_MESSAGE = 7,
+    INVALID_CARD = 8,
+    METRICS_ERROR = 9,
+    RESULTS_ERROR = 10,
+};
+
+
+/* The arguments of the multiplexing hub.
+ */
+struct MultiArgs {
+    // The number of games played at once
+    int window;
+    // The threshold of every game
+    int threshold;
+    // The deck files to play, one game each
+    char** decks;
+    // The number of deck files
+    int numDecks;
+    // The address of the player in each seat
+    char** addresses;
+    // The number of seats in each game
+    int numSeats;
+    // Whether to aggregate the scores instead of outputting every game
+    bool aggregate;
+    // Whether the seats name strategies played in-process in batches
+    bool batch;
+    // The strategy of each seat, when batch is set
+    enum BatchStrategy strategies[MODEL_MAX_PLAYERS];
+    // The parameters of each seat playing bob, when batch is set, taken
+    // from BOB_PARAMS as the bob player takes them
+    struct BobParams bobParams[MODEL_MAX_PLAYERS];
+    // Whether to play one game of each class of equivalent decks
+    bool unique;
+    // The address serving the live metrics, or NULL
+    const char* metricsAddress;
+    // The live metrics, or NULL if they are not served
+    struct Metrics* metrics;
+    // The file of columnar results, or NULL to output text
+    const char* columnsPath;
+    // The columnar results being written, or NULL
+    struct ColumnWriter* columns;
+    // The index of each seat's program among the distinct programs
+    int programs[MODEL_MAX_PLAYERS];
+};
+
+
+/* A multiplexed connection to a player, shared by every seat with the
+ * same address.
+ */
+struct Connection {
+    // The stream of messages to the player
+    FILE* toPlayer;
+    // The stream of messages from the player
+    FILE* fromPlayer;
+    // The live metrics, or NULL if they are not served
+    struct Metrics* metrics;
+    // When the messages to the player were last flushed, if metrics is set
+    uint64_t flushed;
+};
+
+
+/* A game being played, one per deck.
+ */
+struct Table {
+    // The deck file of the game
+    const char* deck;
+    // The position of the deck in the corpus, by name, which is its id in
+    // columnar results
+    int id;
+    // The cards of the deck, in the order they are dealt
+    int* cards;
+    // The number of cards in each hand
+    int handSize;
+    // The state of the game, which also applies the rules
+    struct ModelState state;
+};
+
+
+/* Checks command line arguments are valid. Returns 0 if the values are
+ * within a valid range, and the relevant exit status otherwise.
+ */
+enum ExitMessage check_valid_args(struct MultiArgs* args, int argc,
+        char** argv) {
+    int option;
+
+    args->window = DEFAULT_WINDOW;
+    args->aggregate = false;
+    args->batch = false;
+    args->unique = false;
+    args->metricsAddress = NULL;
+    args->metrics = NULL;
+    args->columnsPath = NULL;
+    args->columns = NULL;
+    args->decks = NULL;
+    args->numDecks = 0;
+
+    while ((option = getopt(argc, argv, "w:sbum:c:")) != -1) {
+        switch (option) {
+            case 'w':
+                args->window = atoi(optarg);
+                break;
+            case 's':
+                args->aggregate = true;
+                break;
+            case 'b':
+                args->batch = true;
+                break;
+            case 'u':
+                args->unique = true;
+                break;
+            case 'm':
+                if (!is_address(optarg)) {
+                    return ARGUMENT_LENGTH;
+                }
+                args->metricsAddress = optarg;
+                break;
+            case 'c':
+                args->columnsPath = optarg;
+                break;
+            default:
+                return ARGUMENT_LENGTH;
+        }
+    }
+
+    if (argc - optind < 4 || args->window < 1 ||
+            args->window > MAX_WINDOW) {
+        return ARGUMENT_LENGTH;
+    }
+
+    args->threshold = atoi(argv[optind]);
+    args->addresses = &argv[optind + 2];
+    args->numSeats = argc - optind - 2;
+
+    if (args->numSeats > MODEL_MAX_PLAYERS) {
+        return ARGUMENT_LENGTH;
+    }
+
+    for (int i = 0; i < args->numSeats; i++) {
+        int strategy = batch_strategy(args->addresses[i]);
+        const char* params = getenv(BOB_PARAMS_ENV);
+
+        if (args->batch ? strategy < 0 : !is_address(args->addresses[i])) {
+            return PLAYER_ERROR;
+        }
+        args->strategies[i] = strategy;
+
+        bob_default_params(&args->bobParams[i]);
+        if (args->batch && params &&
+                !bob_parse_params(params, &args->bobParams[i])) {
+            return PLAYER_ERROR;
+        }
+    }
+
+    if (args->threshold < 2) {
+        return INVALID_THRESHOLD;
+    }
+
+    return deck_add_corpus(argv[optind + 1], &args->decks, &args->numDecks) ?
+            NORMAL_EXIT : DECK_ERROR;
+}
+
+
+/* Connects to the player in each seat. Seats with the same address share
+ * one connection, on which each seat of each game has its own game id.
+ * Returns 0 on success, and a player error status otherwise.
+ */
+enum ExitMessage connect_players(struct MultiArgs* args,
+        struct Connection* connections, struct Connection** seats) {
+    for (int i = 0; i < args->numSeats; i++) {
+        int connection;
+
+        seats[i] = &connections[i];
+        for (int j = 0; j < i; j++) {
+            if (!strcmp(args->addresses[i], args->addresses[j])) {
+                seats[i] = seats[j];
+                break;
+            }
+        }
+
+        if (seats[i] != &connections[i]) {
+            continue;
+        }
+
+        connections[i].metrics = args->metrics;
+        connection = connect_address(args->addresses[i]);
+        if (connection < 0) {
+            return PLAYER_ERROR;
+        }
+        if (args->metrics ? !metrics_open_streams(args->metrics, connection,
+                &connections[i].fromPlayer, &connections[i].toPlayer) :
+                !open_streams(connection, &connections[i].fromPlayer,
+                &connections[i].toPlayer)) {
+            return PLAYER_ERROR;
+        }
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Flushes the messages buffered for every player, noting when for the
+ * metrics.
+ */
+void flush_players(struct Connection** seats, int numSeats) {
+    for (int i = 0; i < numSeats; i++) {
+        fflush(seats[i]->toPlayer);
+        if (seats[i]->metrics) {
+            seats[i]->flushed = metrics_now();
+        }
+    }
+}
+
+
+/* Counts a move of a game in the metrics, which may have finished its
+ * round or the game.
+ */
+void count_move(struct Metrics* metrics, const struct ModelState* state,
+        int roundsLeft) {
+    if (!metrics) {
+        return;
+    }
+
+    if (state->roundsLeft != roundsLeft) {
+        metrics_add(&metrics->roundsCompleted, 1);
+    }
+    if (model_is_over(state)) {
+        metrics_add(&metrics->gamesCompleted, 1);
+        metrics_add(&metrics->gamesInFlight, -1);
+    }
+}
+
+
+/* Reads the next reply on a connection, which must belong to the game with
+ * the given id. Returns the reply after the id, which the caller frees
+ * through line, or NULL with the relevant exit status.
+ */
+char* read_reply(struct Connection* connection, int gameId, char** line,
+        enum ExitMessage* errorMessage) {
+    char* reply;
+
+    *line = get_line(connection->fromPlayer);
+    if (!*line) {
+        *errorMessage = PLAYER_EOF;
+        return NULL;
+    }
+
+    if (strtol(*line, &reply, 10) != gameId || *reply != ' ') {
+        free(*line);
+        *errorMessage = INVALID_MESSAGE;
+        return NULL;
+    }
+
+    return reply + 1;
+}
+
+
+/* Starts the games of a batch by sending every seat its arguments, waiting
+ * for it to accept them and then sending its hand. Returns 0 on success,
+ * and the relevant exit status otherwise.
+ */
+enum ExitMessage deal_batch(struct Table* tables, int numTables, int firstId,
+        struct Connection** seats, int numSeats, int threshold) {
+    enum ExitMessage errorMessage = NORMAL_EXIT;
+    char* line;
+    char* reply;
+
+    for (int g = 0; g < numTables; g++) {
+        for (int p = 0; p < numSeats; p++) {
+            fprintf(seats[p]->toPlayer, "%d NEWGAME%d,%d,%d,%d\n",
+                    firstId + g * numSeats + p, numSeats, p, threshold,
+                    tables[g].handSize);
+        }
+    }
+    flush_players(seats, numSeats);
+
+    for (int g = 0; g < numTables; g++) {
+        for (int p = 0; p < numSeats; p++) {
+            reply = read_reply(seats[p], firstId + g * numSeats + p, &line,
+                    &errorMessage);
+            if (!reply) {
+                return errorMessage;
+            }
+            if (strcmp(reply, "@")) {
+                errorMessage = INVALID_MESSAGE;
+            }
+            free(line);
+            if (errorMessage) {
+                return errorMessage;
+            }
+        }
+    }
+
+    for (int g = 0; g < numTables; g++) {
+        for (int p = 0; p < numSeats; p++) {
+            const int* hand = &tables[g].cards[p * tables[g].handSize];
+
+            fprintf(seats[p]->toPlayer, "%d HAND%d",
+                    firstId + g * numSeats + p, tables[g].handSize);
+            for (int i = 0; i < tables[g].handSize; i++) {
+                fprintf(seats[p]->toPlayer, ",%c%c",
+                        model_card_suit(hand[i]),
+                        encode_rank(model_card_rank(hand[i])));
+            }
+            fputc('\n', seats[p]->toPlayer);
+        }
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Plays one move of every unfinished game in a batch, by reading the card
+ * of each game's current player, checking it is held and telling the
+ * other players. Games are visited in order, and every player's turn was
+ * triggered in that order during the previous step, so the replies on each
+ * connection arrive in the order they are read. Returns 0 on success, and
+ * the relevant exit status otherwise.
+ */
+enum ExitMessage play_step(struct Table* tables, int numTables, int firstId,
+        struct Connection** seats, int numSeats, struct Metrics* metrics) {
+    enum ExitMessage errorMessage = NORMAL_EXIT;
+
+    for (int g = 0; g < numTables; g++) {
+        struct ModelState* state = &tables[g].state;
+        int player = state->currentPlayer;
+        int card;
+        int roundsLeft;
+        char* line;
+        char* reply;
+
+        if (model_is_over(state)) {
+            continue;
+        }
+
+        reply = read_reply(seats[player], firstId + g * numSeats + player,
+                &line, &errorMessage);
+        if (!reply) {
+            return errorMessage;
+        }
+        if (metrics) {
+            metrics_reply(metrics, player,
+                    metrics_now() - seats[player]->flushed);
+        }
+
+        if (strncmp(reply, "PLAY", 4) || strlen(reply) != 6 ||
+                !valid_card(reply[4], reply[5])) {
+            free(line);
+            return INVALID_MESSAGE;
+        }
+
+        card = model_card(reply[4], decode_rank(reply[5]));
+        if (!(state->hands[player] >> card & 1)) {
+            free(line);
+            return INVALID_CARD;
+        }
+
+        for (int p = 0; p < numSeats; p++) {
+            if (p != player) {
+                fprintf(seats[p]->toPlayer, "%d PLAYED%d,%s\n",
+                        firstId + g * numSeats + p, player, reply + 4);
+            }
+        }
+        free(line);
+
+        roundsLeft = state->roundsLeft;
+        model_play(state, card);
+        count_move(metrics, state, roundsLeft);
+    }
+
+    flush_players(seats, numSeats);
+    return NORMAL_EXIT;
+}
+
+
+/* Creates the file of columnar results, naming each distinct program once.
+ * Returns 0 on success, and a results error status otherwise.
+ */
+enum ExitMessage create_columns(struct MultiArgs* args) {
+    char* names[MODEL_MAX_PLAYERS];
+    int numNames = 0;
+
+    for (int p = 0; p < args->numSeats; p++) {
+        args->programs[p] = numNames;
+        for (int i = 0; i < numNames; i++) {
+            if (!strcmp(names[i], args->addresses[p])) {
+                args->programs[p] = i;
+                break;
+            }
+        }
+        if (args->programs[p] == numNames) {
+            names[numNames++] = args->addresses[p];
+        }
+    }
+
+    args->columns = columns_create(args->columnsPath, args->numSeats, names,
+            numNames);
+    return args->columns ? NORMAL_EXIT : RESULTS_ERROR;
+}
+
+
+/* Outputs the final scores of a finished game after its deck file, or adds
+ * them to the statistics if given, with each seat's address as its program.
+ * With columnar results the game's rows are added to them instead of
+ * output.
+ */
+void output_scores(const struct Table* table, const struct MultiArgs* args,
+        struct Stats* stats) {
+    int numSeats = args->numSeats;
+    int scores[MODEL_MAX_PLAYERS];
+
+    for (int p = 0; p < numSeats; p++) {
+        scores[p] = model_score(&table->state, p);
+    }
+
+    if (args->columns) {
+        for (int p = 0; p < numSeats; p++) {
+            columns_add(args->columns, table->id, p, args->programs[p],
+                    scores[p], args->threshold, table->state.points[p],
+                    table->state.diamonds[p]);
+        }
+    }
+
+    if (stats) {
+        stats_add_game(stats, args->addresses, scores, numSeats);
+        return;
+    }
+
+    if (args->columns) {
+        return;
+    }
+
+    printf("%s", table->deck);
+    for (int p = 0; p < numSeats; p++) {
+        printf(" %d:%d", p, scores[p]);
+    }
+    printf("\n");
+}
+
+
+/* Plays a batch of games interleaved over the players' connections, round
+ * by round and move by move, then outputs the final scores of each game
+ * unless the games stand for classes of decks.
+ * Returns 0 on success, and the relevant exit status otherwise.
+ */
+enum ExitMessage play_batch(struct Table* tables, int numTables, int firstId,
+        struct Connection** seats, const struct MultiArgs* args,
+        struct Stats* stats) {
+    int numSeats = args->numSeats;
+    enum ExitMessage errorMessage;
+    bool playing = true;
+
+    errorMessage = deal_batch(tables, numTables, firstId, seats, numSeats,
+            args->threshold);
+    if (args->metrics) {
+        metrics_add(&args->metrics->gamesInFlight, numTables);
+    }
+
+    while (playing && !errorMessage) {
+        playing = false;
+
+        for (int g = 0; g < numTables; g++) {
+            if (model_is_over(&tables[g].state)) {
+                continue;
+            }
+
+            playing = true;
+            for (int p = 0; p < numSeats; p++) {
+                fprintf(seats[p]->toPlayer, "%d NEWROUND%d\n",
+                        firstId + g * numSeats + p,
+                        tables[g].state.leadPlayer);
+            }
+        }
+        flush_players(seats, numSeats);
+
+        for (int i = 0; i < numSeats && playing && !errorMessage; i++) {
+            errorMessage = play_step(tables, numTables, firstId, seats,
+                    numSeats, args->metrics);
+        }
+    }
+
+    if (errorMessage) {
+        return errorMessage;
+    }
+
+    for (int g = 0; g < numTables && !args->unique; g++) {
+        output_scores(&tables[g], args, stats);
+    }
+    fflush(stdout);
+
+    return NORMAL_EXIT;
+}
+
+
+/* Plays games in-process with the batch engine, BATCH_LANES at a time,
+ * then outputs the final scores of each game unless the games stand for
+ * classes of decks.
+ */
+void simulate_games(struct Table* tables, int numTables,
+        const struct MultiArgs* args, struct Stats* stats) {
+    struct Batch batch;
+
+    for (int first = 0; first < numTables; first += BATCH_LANES) {
+        int lanes = numTables - first < BATCH_LANES ?
+                numTables - first : BATCH_LANES;
+
+        batch_init(&batch, args->numSeats, args->threshold,
+                args->strategies, args->bobParams);
+        for (int lane = 0; lane < lanes; lane++) {
+            batch_deal(&batch, lane, &tables[first + lane].state);
+        }
+
+        batch_play(&batch);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            if (args->metrics) {
+                metrics_add(&args->metrics->roundsCompleted,
+                        tables[first + lane].state.roundsLeft);
+                metrics_add(&args->metrics->gamesCompleted, 1);
+            }
+            batch_result(&batch, lane, &tables[first + lane].state);
+            if (!args->unique) {
+                output_scores(&tables[first + lane], args, stats);
+            }
+        }
+    }
+    fflush(stdout);
+}
+
+
+/* Groups the decks of the tables into classes of equivalent games, and
+ * returns a new array holding the first table of each class, whose games
+ * are played in place of the others. classes[i] is set to the position in
+ * that array of table i's class.
+ */
+struct Table* find_classes(const struct Table* tables, int numTables,
+        int* classes, int* numClasses) {
+    struct Canon* canons = malloc(sizeof(struct Canon) * numTables);
+    struct Table* firsts;
+
+    for (int i = 0; i < numTables; i++) {
+        canon_deal(&canons[i], &tables[i].state);
+    }
+    *numClasses = canon_classes(canons, numTables, classes);
+    free(canons);
+
+    firsts = malloc(sizeof(struct Table) * *numClasses);
+    for (int i = 0, next = 0; i < numTables; i++) {
+        if (classes[i] == i) {
+            firsts[next] = tables[i];
+            classes[i] = next++;
+        } else {
+            classes[i] = classes[classes[i]];
+        }
+    }
+
+    fprintf(stderr, "Classes=%d of %d decks\n", *numClasses, numTables);
+    return firsts;
+}
+
+
+/* Outputs the final scores of every table from the game played for its
+ * class, in the order of the decks.
+ */
+void output_classes(struct Table* tables, int numTables,
+        const struct Table* firsts, const int* classes,
+        const struct MultiArgs* args, struct Stats* stats) {
+    for (int i = 0; i < numTables; i++) {
+        tables[i].state = firsts[classes[i]].state;
+        output_scores(&tables[i], args, stats);
+    }
+    fflush(stdout);
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_game_over(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310multihub [-w window] [-s] [-b] [-u] "
+                    "[-m address] [-c results] threshold corpus address "
+                    "{address}\n");
+            break;
+        case INVALID_THRESHOLD:
+            fprintf(stderr, "Invalid threshold\n");
+            break;
+        case DECK_ERROR:
+            fprintf(stderr, "Deck error\n");
+            break;
+        case SMALL_DECK:
+            fprintf(stderr, "Not enough cards\n");
+            break;
+        case PLAYER_ERROR:
+            fprintf(stderr, "Player error\n");
+            break;
+        case PLAYER_EOF:
+            fprintf(stderr, "Player EOF\n");
+            break;
+        case INVALID_MESSAGE:
+            fprintf(stderr, "Invalid message\n");
+            break;
+        case INVALID_CARD:
+            fprintf(stderr, "Invalid card choice\n");
+            break;
+        case METRICS_ERROR:
+            fprintf(stderr, "Metrics error\n");
+            break;
+        case RESULTS_ERROR:
+            fprintf(stderr, "Cannot write results\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+/* The multiplexing hub, 2310multihub, which plays one game per deck of a
+ * corpus against players serving many games over one connection (started
+ * with --multiplex address). Up to window games are played at once, and
+ * each game's final scores are output on a line after its deck file, or
+ * with -s summarised per seat as 2310stats would. With -b the seats name
+ * the strategies alice and bob instead, which are played in-process by the
+ * batch engine, bob with the parameters in BOB_PARAMS if it is set. With
+ * -u only one game is played for each class of decks dealing the same
+ * hands, and its scores are given to every deck of the class.
+ * -m address serves live metrics in Prometheus' text format on the given
+ * address, for example with curl --unix-socket PATH http://hub/metrics.
+ * -c results writes each seat's results to the given file in the columnar
+ * format of columns.h instead of outputting them as text.
+ */
+int main(int argc, char** argv) {
+    enum ExitMessage errorMessage;
+    struct MultiArgs args;
+    struct Connection connections[MODEL_MAX_PLAYERS];
+    struct Connection* seats[MODEL_MAX_PLAYERS];
+    struct Table* tables;
+    struct Table* played;
+    int numPlayed;
+    int* classes = NULL;
+    struct Stats stats;
+
+    errorMessage = check_valid_args(&args, argc, argv);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    if (args.metricsAddress) {
+        args.metrics = metrics_start(args.metricsAddress, "multihub",
+                args.numSeats);
+        if (!args.metrics) {
+            handle_game_over(METRICS_ERROR);
+        }
+    }
+
+    tables = calloc(args.numDecks, sizeof(struct Table));
+    for (int i = 0; i < args.numDecks; i++) {
+        tables[i].deck = args.decks[i];
+        tables[i].id = i;
+        errorMessage = (enum ExitMessage)deck_load(tables[i].deck,
+                args.numSeats, args.threshold, &tables[i].state,
+                &tables[i].cards);
+        if (errorMessage) {
+            handle_game_over(errorMessage);
+        }
+        tables[i].handSize = tables[i].state.roundsLeft;
+    }
+
+    played = tables;
+    numPlayed = args.numDecks;
+    if (args.unique) {
+        classes = malloc(sizeof(int) * args.numDecks);
+        played = find_classes(tables, args.numDecks, classes, &numPlayed);
+    }
+
+    if (args.columnsPath && (errorMessage = create_columns(&args))) {
+        handle_game_over(errorMessage);
+    }
+
+    stats_init(&stats);
+    if (args.batch) {
+        simulate_games(played, numPlayed, &args,
+                args.aggregate ? &stats : NULL);
+    } else {
+        signal(SIGPIPE, SIG_IGN);
+        errorMessage = connect_players(&args, connections, seats);
+        if (errorMessage) {
+            handle_game_over(errorMessage);
+        }
+
+        for (int i = 0; i < numPlayed && !errorMessage; i += args.window) {
+            int numTables = numPlayed - i < args.window ?
+                    numPlayed - i : args.window;
+
+            errorMessage = play_batch(&played[i], numTables,
+                    i * args.numSeats, seats, &args,
+                    args.aggregate ? &stats : NULL);
+        }
+    }
+
+    if (args.unique && !errorMessage) {
+        output_classes(tables, args.numDecks, played, classes, &args,
+                args.aggregate ? &stats : NULL);
+    }
+
+    if (args.columns && !columns_close(args.columns) && !errorMessage) {
+        errorMessage = RESULTS_ERROR;
+    }
+
+    if (args.aggregate && !errorMessage) {
+        stats_report(&stats, stdout);
+    }
+
+    handle_game_over(errorMessage);
+    return NORMAL_EXIT;
+}
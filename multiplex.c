@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "players.h"
+#include "strategy.h"
+#include "transport.h"
+#include "multiplex.h"
+#include "ledger.h"
+
+
+// The number of buckets in the table of games, a power of two
+#define TABLE_BUCKETS 4096
+
+
+/* A game in the table of games being played over a connection.
+ */
+struct Entry {
+    // The state of the game, whose gameId is the key of the entry
+    struct Game game;
+    // The next game in the same bucket
+    struct Entry* next;
+};
+
+
+/* The games being played over a connection, hashed by id.
+ */
+struct GameTable {
+    // The chain of games in each bucket
+    struct Entry* buckets[TABLE_BUCKETS];
+    // The number of games in the table
+    int count;
+};
+
+
+/* Returns the link to the game with the given id, or the empty link at the
+ * end of its bucket if there is no such game.
+ */
+static struct Entry** find_entry(struct GameTable* table, int gameId) {
+    struct Entry** link = &table->buckets[gameId & (TABLE_BUCKETS - 1)];
+
+    while (*link && (*link)->game.gameId != gameId) {
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+
+/* Removes the game at the given link from the table, releasing it and its
+ * strategy's state.
+ */
+static void remove_entry(struct GameTable* table, struct Entry** link) {
+    struct Entry* entry = *link;
+    const struct Strategy* strategy = entry->game.strategy;
+
+    *link = entry->next;
+    if (strategy->release) {
+        strategy->release(entry->game.strategyState);
+    }
+    release_game(&entry->game);
+    ledger_free(LEDGER_TABLE, entry);
+    table->count--;
+}
+
+
+/* Starts the game with the given id from its NEWGAME message, and tells
+ * the hub the player is ready. Returns the relevant exit status if the
+ * arguments are invalid, or if the id is already in use, in which case the
+ * game already using it ends too.
+ */
+static enum ExitMessage start_game(struct GameTable* table, 
+        const struct Strategy* strategy, int gameId, char* message,
+        FILE* toHub) {
+    struct Entry** link = find_entry(table, gameId);
+    struct Entry* entry;
+    enum ExitMessage errorMessage;
+
+    if (*link) {
+        remove_entry(table, link);
+        return INVALID_MESSAGE;
+    }
+
+    entry = ledger_malloc(LEDGER_TABLE, sizeof(struct Entry));
+    entry->game.gameId = gameId;
+    entry->game.fromHub = NULL;
+    entry->game.toHub = toHub;
+    errorMessage = handle_new_game(&entry->game, message);
+    if (errorMessage) {
+        ledger_free(LEDGER_TABLE, entry);
+        return errorMessage;
+    }
+
+    send_ready(&entry->game);
+    entry->game.strategy = strategy;
+    start_strategy(&entry->game, NULL);
+    begin_game(&entry->game);
+
+    entry->next = NULL;
+    *link = entry;
+    table->count++;
+    return NORMAL_EXIT;
+}
+
+
+/* Handles a message on a multiplexed connection by passing it on to the
+ * game named by its id, and removes the game once it is over. A message
+ * that is invalid, or names no game being played, is reported to stderr
+ * after its game id, and ends only its own game.
+ */
+static void handle_multiplexed_message(struct GameTable* table,
+        const struct Strategy* strategy, char* input, FILE* toHub) {
+    struct Entry** link;
+    enum ExitMessage errorMessage;
+    char* message;
+    long gameId = strtol(input, &message, 10);
+
+    if (message == input || *message != ' ' || gameId < 0 || 
+            gameId > INT_MAX) {
+        // without an id the message belongs to no game
+        report_exit(INVALID_MESSAGE);
+        return;
+    }
+    message++;
+
+    if (classify_hub_message(message) == NEWGAME) {
+        errorMessage = start_game(table, strategy, gameId, message, toHub);
+    } else if (!*(link = find_entry(table, gameId))) {
+        errorMessage = INVALID_MESSAGE;
+    } else {
+        errorMessage = handle_hub_message(&(*link)->game, message);
+        if (errorMessage || (*link)->game.isOver) {
+            remove_entry(table, link);
+        }
+    }
+
+    if (errorMessage) {
+        fprintf(stderr, "%ld ", gameId);
+        report_exit(errorMessage);
+    }
+}
+
+
+/* Plays the games of a connection until the hub closes it. Returns the
+ * EOF status if the connection closes with games still being played.
+ */
+static enum ExitMessage serve_connection(struct GameTable* table,
+        const struct Strategy* strategy, FILE* fromHub, FILE* toHub) {
+    char* input = NULL;
+    size_t size = 0;
+
+    while (read_line(fromHub, &input, &size) >= 0) {
+        handle_multiplexed_message(table, strategy, input, toHub);
+        ledger_poll();
+    }
+    free(input);
+
+    return table->count ? EOF_SIGNAL : NORMAL_EXIT;
+}
+
+
+/* Serves many games at once to hubs connecting to the given address, one
+ * connection at a time. A connection that ends with games unfinished only
+ * loses its own games.
+ */
+int serve_games(const struct Strategy* strategy, const char* address) {
+    int listener = listen_address(address);
+    struct GameTable* table;
+
+    if (listener < 0) {
+        handle_game_over(INVALID_ADDRESS);
+    }
+
+    // a hub closing its connection must not end the player
+    signal(SIGPIPE, SIG_IGN);
+    table = calloc(1, sizeof(struct GameTable));
+
+    while (1) {
+        FILE* fromHub;
+        FILE* toHub;
+        int connection;
+
+        // an idle player still reports its memory when asked
+        if (!ledger_wait(listener)) {
+            break;
+        }
+        connection = accept_connection(listener);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        if (!open_streams(connection, &fromHub, &toHub)) {
+            continue;
+        }
+
+        report_exit(serve_connection(table, strategy, fromHub, toHub));
+
+        // games left over from a failed connection can never finish
+        for (int i = 0; i < TABLE_BUCKETS; i++) {
+            while (table->buckets[i]) {
+                remove_entry(table, &table->buckets[i]);
+            }
+        }
+
+        fclose(fromHub);
+        fclose(toHub);
+    }
+
+    free(table);
+    return INVALID_ADDRESS;
+}
@@ -0,0 +1,20 @@
+#ifndef MULTIPLEX_H
+#define MULTIPLEX_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "players.h"
+
+
+/* Serves many games at once to hubs connecting to the given address, one
+ * connection at a time. Every message on a multiplexed connection starts
+ * with the id of its game and a space, and NEWGAMEplayers,myid,threshold,
+ * handsize starts a new game with that id. The games of a connection are
+ * independent, so one connection may carry several seats of the same game
+ * under different ids, and an invalid message ends only the game it names.
+ */
+int serve_games(const struct Strategy* strategy, const char* address);
+
+
+#endif
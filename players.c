@@ -8,75 +8,72 @@
 
 #include "utilities.h"
 #include "players.h"
+#include "strategy.h"
+#include "transport.h"
+#include "multiplex.h"
+#include "zygote.h"
+#include "memo.h"
+#include "trace.h"
+#include "ledger.h"
 
 
-/* Removes a card from the players hand and resizes
- * it to be one less than it originally was, removing the played
- * card.
+// The most digits in a number field of a hub message
+#define MAX_FIELD_DIGITS 9
+
+
+// The cache of pure strategies' decisions, shared by every game of the
+// process, or NULL if decisions are not cached
+static struct Memo* memo = NULL;
+
+
+/* Removes a card from the players hand by shifting the cards after
+ * it down one place, so that the hand keeps its order.
  */
 void remove_card(struct Card card, struct Game* game) {
-    char suit = card.suit;
-    int rank = card.rank;
-    int counter;
-    struct Card* newHand = malloc(sizeof(struct Card) * game->handSize - 1);
+    int counter = -1;
 
     for (int i = 0; i < game->handSize; i++) {
-        if (game->hand[i].suit == suit && game->hand[i].rank == rank) {
+        if (game->hand[i].suit == card.suit && 
+                game->hand[i].rank == card.rank) {
             counter = i;
         }
     }
 
-    for (int i = 0; i < counter; i++) {
-        newHand[i] = game->hand[i];
+    if (counter < 0) {
+        return;
     }
 
     for (int i = counter; i < game->handSize - 1; i++) {
-        newHand[i] = game->hand[i + 1];
+        game->hand[i] = game->hand[i + 1];
     }
+}
 
-    free(game->hand);
-
-    game->hand = malloc(sizeof(struct Card) * game->handSize - 1);
 
+/* Returns true if the player holds at least one card of the given suit.
+ */
+bool has_suit(const struct Game* game, char suit) {
     for (int i = 0; i < game->handSize; i++) {
-        game->hand[i] = newHand[i];
+        if (game->hand[i].suit == suit) {
+            return true;
+        }
     }
 
-    free(newHand);
+    return false;
 }
 
+
 /* Finds the highest card from a given suit, specified by the order of
  * the suit array. If there are no cards in the first suit, then the 
  * next suit is checked, and so on, until at least one card of a suit
  * is found.
  */
-void find_highest(struct Game* game, struct Card* cards, char suit[]) {
-    int handSize = game->handSize;
-    int counter = 0;
-
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < handSize; j++) {
-            if (game->hand[j].suit == suit[i]) {
-                cards = realloc(cards, sizeof(struct Card) * counter + 1);
-                cards[counter] = game->hand[j];
-                counter++;
-            } else {
-                continue;
-            }
+void find_highest(const struct Game* game, struct Card* cards, 
+        const char suit[]) {
+    for (int i = 0; i < NUM_SUITS; i++) {
+        if (find_highest_suit(game, cards, suit[i])) {
+            return;
         }
-
-        if (!counter) {
-            continue;
-        }   
-
-        for (int i = 1; i < counter; i++) {
-            if (cards[0].rank < cards[i].rank) {
-                cards[0] = cards[i];
-            }   
-        }
-        return;
     }
-    return;
 }
 
 
@@ -85,34 +82,13 @@ void find_highest(struct Game* game, struct Card* cards, char suit[]) {
  * next suit is checked, and so on, until at least one card of a suit
  * is found.
  */
-void find_lowest(struct Game* game, struct Card* cards, char suit[]) {
-    int handSize = game->handSize;
-    int counter = 0;
-
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < handSize; j++) {
-            if (game->hand[j].suit == suit[i]) {
-                cards = realloc(cards, sizeof(struct Card) * counter + 1);
-                cards[counter] = game->hand[j];
-                counter++;
-            } else {
-                continue;
-            }
+void find_lowest(const struct Game* game, struct Card* cards, 
+        const char suit[]) {
+    for (int i = 0; i < NUM_SUITS; i++) {
+        if (find_lowest_suit(game, cards, suit[i])) {
+            return;
         }
-
-        if (!counter) {
-            continue;
-        }   
-
-        for (int i = 1; i < counter; i++) {
-            if (cards[0].rank > cards[i].rank) {
-                cards[0] = cards[i];
-            }   
-        }
-        return;
     }
-
-    return;
 }
 
 
@@ -120,32 +96,22 @@ void find_lowest(struct Game* game, struct Card* cards, char suit[]) {
  * there is at least one card. Otherwise, there are no cards and false is 
  * returned.
  */
-bool find_lowest_suit(struct Game* game, struct Card* cards, char suit) {
-    int handSize = game->handSize;
-    int counter = 0;
+bool find_lowest_suit(const struct Game* game, struct Card* cards, 
+        char suit) {
+    bool found = false;
 
-    for (int i = 0; i < handSize; i++) {
-        if (game->hand[i].suit == suit) {
-            cards = realloc(cards, sizeof(struct Card) * counter + 1);
-            cards[counter] = game->hand[i];
-            counter++;
-        } else {
+    for (int i = 0; i < game->handSize; i++) {
+        if (game->hand[i].suit != suit) {
             continue;
         }
-    }
-
-    if (!counter) {
-        return false;
-    }
-
-    for (int i = 1; i < counter; i++) {
 
-        if (cards[0].rank > cards[i].rank) {
-            cards[0] = cards[i];
+        if (!found || cards[0].rank > game->hand[i].rank) {
+            cards[0] = game->hand[i];
+            found = true;
         }
     }
 
-    return true;
+    return found;
 }
 
 
@@ -153,32 +119,22 @@ bool find_lowest_suit(struct Game* game, struct Card* cards, char suit) {
  * there is at least one card. Otherwise, there are no cards and false is 
  * returned.
  */
-bool find_highest_suit(struct Game* game, struct Card* cards, char suit) {
-    int handSize = game->handSize;
-    int counter = 0;
+bool find_highest_suit(const struct Game* game, struct Card* cards, 
+        char suit) {
+    bool found = false;
 
-    for (int i = 0; i < handSize; i++) {
-        if (game->hand[i].suit == suit) {
-            cards = realloc(cards, sizeof(struct Card) * counter + 1);
-            cards[counter] = game->hand[i];
-            counter++;
-        } else {
+    for (int i = 0; i < game->handSize; i++) {
+        if (game->hand[i].suit != suit) {
             continue;
         }
-    }
-
-    if (!counter) {
-        return false;
-    }
-
-    for (int i = 1; i < counter; i++) {
 
-        if (cards[0].rank < cards[i].rank) {
-            cards[0] = cards[i];
+        if (!found || cards[0].rank < game->hand[i].rank) {
+            cards[0] = game->hand[i];
+            found = true;
         }
     }
 
-    return true;
+    return found;
 }
 
 
@@ -241,57 +197,95 @@ enum ExitMessage check_valid_args(struct Game* game, int argc, char** argv) {
         return INVALID_THRESHOLD;
     } else if (game->handSize < 1) {
         return INVALID_HAND_SIZE;
-    } else {
-        fputs("@", stdout);
-        fflush(stdout);
-        return NORMAL_EXIT;
     }
+
+    return NORMAL_EXIT;
 }
 
 
-/* Handles the initialisation of a player's hand by checking cards
- * are valid, and adding them to the player to be used throughout
- * the game.
- */
-enum ExitMessage handle_new_hand(struct Game* game, char* input) {
-    const char* currentValue;
-    const char substring[2] = ",";
-    char* card;
-    unsigned int cardCounter = 0;
-    char* error;
-    char* currentCard;
-
-    currentValue = &input[4];
-    unsigned int numCards = strtoul(currentValue, &error, 10);
-    struct Card* cardContents = malloc(sizeof(struct Card) * numCards);
-
-    if (numCards >= 10) {
-        currentValue += 3;
-    } else {
-        currentValue += 2;
+/* Starts a message to the hub, by writing the game's id first if the
+ * game is played over a multiplexed connection.
+ */
+void start_message(const struct Game* game) {
+    if (game->gameId >= 0) {
+        fprintf(game->toHub, "%d ", game->gameId);
     }
+}
 
-    currentCard = (char*)currentValue;
-    card = strtok(currentCard, substring);
 
+/* Tells the hub that the player has accepted its arguments. This is a
+ * lone @ on a plain connection, and a line of its own on a multiplexed
+ * connection.
+ */
+void send_ready(struct Game* game) {
+    start_message(game);
+    fputs(game->gameId >= 0 ? "@\n" : "@", game->toHub);
+    fflush(game->toHub);
+}
 
-    while (card != NULL) {
-        cardCounter++;
-        if (cardCounter > numCards) {
-            return INVALID_MESSAGE;
+
+/* Parses a decimal number of at most MAX_FIELD_DIGITS digits at the
+ * given position into value. Returns the position after the number, or
+ * NULL if there is no number there.
+ */
+static const char* parse_number(const char* position, int* value) {
+    const char* start = position;
+
+    *value = 0;
+    while (*position >= '0' && *position <= '9') {
+        if (position - start == MAX_FIELD_DIGITS) {
+            return NULL;
         }
+        *value = *value * 10 + (*position++ - '0');
+    }
+
+    return position == start ? NULL : position;
+}
+
 
-        cardContents[cardCounter - 1].suit = card[0];
-        cardContents[cardCounter - 1].rank = decode_rank(card[1]);
+/* Parses a card at the given position into card. Returns the position
+ * after the card, or NULL if there is no valid card there.
+ */
+static const char* parse_card(const char* position, struct Card* card) {
+    if (!position[0] || !valid_card(position[0], position[1])) {
+        return NULL;
+    }
+
+    card->suit = position[0];
+    card->rank = decode_rank(position[1]);
+    return position + 2;
+}
+
+
+/* Handles the initialisation of a player's hand by checking cards
+ * are valid, and adding them to the player to be used throughout
+ * the game. The message is HANDn followed by ,card n times, and the
+ * cards are parsed in place into the hand allocated by begin_game.
+ */
+enum ExitMessage handle_new_hand(struct Game* game, const char* input) {
+    const char* position = parse_number(input + strlen("HAND"), 
+            &game->handSize);
+
+    if (!position || game->handSize != game->initialHandSize) {
+        return INVALID_MESSAGE;
+    }
 
-        card = strtok(NULL, substring);
+    for (int i = 0; i < game->handSize; i++) {
+        if (*position != ',' ||
+                !(position = parse_card(position + 1, &game->hand[i]))) {
+            return INVALID_MESSAGE;
+        }
     }
 
-    if (cardCounter < numCards || numCards != (unsigned int)game->handSize) {
+    if (*position) {
         return INVALID_MESSAGE;
     }
 
-    game->hand = cardContents;
+    for (int i = 0; i < game->handSize; i++) {
+        game->knowledge.remaining[suit_index(game->hand[i].suit)]--;
+    }
+    game->hasHand = true;
+
     return NORMAL_EXIT;
 }
 
@@ -300,54 +294,73 @@ enum ExitMessage handle_new_hand(struct Game* game, char* input) {
  * a round, as well as checking whether this player is leader. Returns
  * status 0 on normal exit, and the relevant message otherwise.
  */
-enum ExitMessage handle_new_round(struct Game* game, char* input) {
-    unsigned int leadPlayer; 
-    const char* leader;
-
-    game->hasPlayed = false;
+enum ExitMessage handle_new_round(struct Game* game, const char* input) {
+    int leadPlayer;
+    const char* end = parse_number(input + strlen("NEWROUND"), &leadPlayer);
 
-    leader = &input[8];
-    leadPlayer = atoi(leader);
-
-    if ((int)leadPlayer > game->numPlayers) {
+    if (!end || *end || leadPlayer >= game->numPlayers) {
         return INVALID_MESSAGE;
     }
 
+    game->hasPlayed = false;
+
     game->leadPlayer = leadPlayer;
     game->roundWinner = leadPlayer;
     game->currentPlayer = leadPlayer;
     game->roundDiamonds = 0;
-    strcpy(game->cardsPlayed, "");
+    game->hasFollowTable = false;
+    game->cardsPlayed[0] = '\0';
 
     if (game->leadPlayer == game->playerId) {
         make_new_move(game);
+    } else if (game->strategy->pureFollow) {
+        trace_begin("speculate", game->playerId);
+        speculate_follow(game);
+        trace_end("speculate", game->playerId);
     }
 
     return NORMAL_EXIT;
 }
 
 
+/* Asks a strategy whose follow hook is pure for its answer to every lead
+ * suit of the round, so that the answer is ready when this player's turn
+ * comes.
+ */
+void speculate_follow(struct Game* game) {
+    struct Card leadCard = game->leadCard;
+
+    for (int suit = 0; suit < NUM_SUITS; suit++) {
+        game->leadCard.suit = SUITS[suit];
+        for (int diamonds = 0; diamonds < 2; diamonds++) {
+            game->roundDiamonds = diamonds;
+            game->followTable[suit][diamonds] = ask_strategy(game, false);
+        }
+    }
+
+    game->leadCard = leadCard;
+    game->roundDiamonds = 0;
+    game->hasFollowTable = true;
+}
+
+
 /* Displays the end of round information to stderr, including
  * the leader for the round, as well as all cards played. for that
  * round.
  */
 void handle_round_info(struct Game* game) {
-    char message[80];
-    char cardInfo[10];
-
-    sprintf(message, "Lead player=%d:", game->leadPlayer);
+    char message[24 + 4 * game->numPlayers];
+    int length = sprintf(message, "Lead player=%d:", game->leadPlayer);
 
     for (int i = 0; i < game->numPlayers; i++) {
-        cardInfo[0] = ' ';
-        cardInfo[1] = game->cardsPlayed[2 * i];
-        cardInfo[2] = '.';
-        cardInfo[3] = game->cardsPlayed[2 * i + 1];
-        cardInfo[4] = '\0';
-
-        strcat(message, cardInfo);
+        message[length++] = ' ';
+        message[length++] = game->cardsPlayed[2 * i];
+        message[length++] = '.';
+        message[length++] = game->cardsPlayed[2 * i + 1];
     }
+    message[length++] = '\n';
 
-    fprintf(stderr, "%s\n", message);
+    fwrite(message, 1, length, stderr);
 }
 
 
@@ -364,67 +377,116 @@ void calculate_num_diamonds(struct Game* game) {
  * the value can be added to the round winner's score at the end of
  * each round.
  */
-void check_round_leader(struct Game* game, char* card) {
-
-    if (card[0] == game->leadCard.suit && 
-            card[1] - '0' > game->leadCard.rank) {
+void check_round_leader(struct Game* game, struct Card card) {
+    if (card.suit == game->leadCard.suit && card.rank > game->leadCard.rank) {
         game->roundWinner = game->currentPlayer;
-        game->leadCard.suit = card[0];
-        game->leadCard.rank = card[1] - '0';
+        game->leadCard = card;
     }
 
-    if (card[0] == 'D') {
+    if (card.suit == DIAMONDS) {
         game->roundDiamonds++;
     }
 }
 
 
-/* Handles an input in which another player has played a card by
- * first checking whether they were the leader, and if so storing
- * their card information to determine the player's move. Otherwise,
- * the player track's the current player, and once it is their turn
- * outputs their move. Once all players have moved, the end of round
- * information is determined. Returns the relevant exit message.
- */
-enum ExitMessage handle_player_move(struct Game* game, char* input) {
-    char* played = "PLAYED";
-    char* playerDetails = &input[6];
-    char* playInfo;
-    int rank;
-    struct Card leadCard;
-    const char substring[2] = ",";
-
-    if (strstr(input, played) == NULL) {
-        return INVALID_MESSAGE;
+/* Initialises the knowledge of a new game, with no cards seen and
+ * no player known to be out of any suit.
+ */
+void initialise_knowledge(struct Game* game) {
+    struct Knowledge* knowledge = &game->knowledge;
+
+    knowledge->voids = ledger_malloc(LEDGER_GAMES, 
+            sizeof(unsigned) * game->numPlayers);
+
+    for (int i = 0; i < game->numPlayers; i++) {
+        knowledge->voids[i] = 0;
     }
 
-    playInfo = strtok(playerDetails, substring);
-    game->currentPlayer = atoi(playInfo);
-    game->numCardsPlayed++;
-    playInfo = strtok(NULL, substring);
-    
-    if (!valid_card(playInfo[0], playInfo[1])) {
-        return INVALID_MESSAGE;
+    for (int i = 0; i < NUM_SUITS; i++) {
+        knowledge->seen[i] = 0;
+        knowledge->remaining[i] = NUM_RANKS;
     }
+}
+
+
+/* Updates the knowledge of the game with a card played by the given
+ * player: the card is seen, is no longer held by another player, and
+ * a player who did not follow the lead suit holds none of it.
+ */
+void update_knowledge(struct Game* game, int player, struct Card card) {
+    struct Knowledge* knowledge = &game->knowledge;
+    int suit = suit_index(card.suit);
 
-    check_round_leader(game, playInfo);
-    strcat(game->cardsPlayed, playInfo);
+    knowledge->seen[suit] |= 1u << card.rank;
 
-    if (game->currentPlayer == game->leadPlayer) {
-        rank = (int)playInfo[1] - 48;
-        leadCard.suit = playInfo[0];
-        leadCard.rank = rank;
-        game->leadCard = leadCard;
+    if (player != game->playerId) {
+        knowledge->remaining[suit]--;
     }
-    
-    if (game->currentPlayer == game->playerId - 1 || 
-            game->currentPlayer - game->playerId == game->currentPlayer) {
 
-        if (!game->hasPlayed) {
-            make_new_move(game);
+    if (game->numCardsPlayed > 1 && card.suit != game->leadCard.suit) {
+        knowledge->voids[player] |= 1u << suit_index(game->leadCard.suit);
+    }
+}
+
+
+/* Returns true if the given player has shown they hold no cards of
+ * the given suit.
+ */
+bool is_void(const struct Game* game, int player, char suit) {
+    return game->knowledge.voids[player] >> suit_index(suit) & 1;
+}
+
+
+/* Records a card played by any player, including this one: tracks the
+ * lead card and round winner, the cards played in the round, and the
+ * knowledge of the game, and then informs the strategy.
+ */
+void record_card(struct Game* game, int player, struct Card card) {
+    game->currentPlayer = player;
+    game->numCardsPlayed++;
+
+    if (game->numCardsPlayed == 1) {
+        game->leadCard = card;
+        game->roundWinner = player;
+        if (card.suit == DIAMONDS) {
+            game->roundDiamonds++;
         }
-        game->currentPlayer = game->playerId;
-        check_round_leader(game, game->currentCard);
+    } else {
+        check_round_leader(game, card);
+    }
+
+    update_knowledge(game, player, card);
+
+    game->currentCard[0] = card.suit;
+    game->currentCard[1] = encode_rank(card.rank);
+    game->currentCard[2] = '\0';
+    memcpy(&game->cardsPlayed[2 * (game->numCardsPlayed - 1)],
+            game->currentCard, 3);
+
+    observe_move(game, player, card);
+}
+
+
+/* Handles an input in which another player has played a card by
+ * recording it, and once it is this player's turn outputting their
+ * move. Once all players have moved, the end of round information
+ * is determined. Returns the relevant exit message.
+ */
+enum ExitMessage handle_player_move(struct Game* game, const char* input) {
+    struct Card played;
+    int player;
+    const char* position = parse_number(input + strlen("PLAYED"), &player);
+
+    if (!position || *position != ',' || player >= game->numPlayers ||
+            !(position = parse_card(position + 1, &played)) || *position) {
+        return INVALID_MESSAGE;
+    }
+
+    record_card(game, player, played);
+    
+    if ((player + 1) % game->numPlayers == game->playerId && 
+            !game->hasPlayed) {
+        make_new_move(game);
     }
 
     if (game->numCardsPlayed == game->numPlayers) {
@@ -439,29 +501,106 @@ enum ExitMessage handle_player_move(struct Game* game, char* input) {
 }
 
 
-/* Classifies the messages being inputted by the hub,
- * in order for the player to determine their next move.
- */
-enum HubMessage classify_hub_message(char* input) {
-    if (strstr(input, "HAND") == input) {
-        return HAND;
-    } else if (strstr(input, "NEWROUND") == input) {
-        return NEWROUND;
-    } else if (strstr(input, "PLAYED") == input) {
-        return PLAYED;
-    } else if (strstr(input, "GAMEOVER") == input) {
-        return GAMEOVER;
+/* Asks the strategy for the card to lead with if lead is set, and to follow
+ * with otherwise. Decisions of a pure hook are looked up in the decision
+ * cache first, and stored in it once made.
+ */
+struct Card ask_strategy(struct Game* game, bool lead) {
+    const struct Strategy* strategy = game->strategy;
+    bool pure = lead ? strategy->pureLead : strategy->pureFollow;
+    uint64_t key = 0;
+    struct Card card;
+
+    trace_begin(lead ? "lead" : "follow", game->playerId);
+    if (memo && pure) {
+        key = memo_key(game, lead);
+        if (memo_find(memo, key, &card)) {
+            trace_end(lead ? "lead" : "follow", game->playerId);
+            return card;
+        }
+    }
+
+    card = lead ? strategy->lead(game->strategyState, game) :
+            strategy->follow(game->strategyState, game);
+
+    if (memo && pure) {
+        memo_store(memo, key, card);
+    }
+    trace_end(lead ? "lead" : "follow", game->playerId);
+
+    return card;
+}
+
+
+/* Asks the strategy for this player's next card, depending on whether this
+ * player leads the round, then sends the move to the hub and removes the
+ * card from the player's hand.
+ */
+void make_new_move(struct Game* game) {
+    struct Card card;
+
+    if (game->leadPlayer == game->playerId) {
+        card = ask_strategy(game, true);
+    } else if (game->hasFollowTable) {
+        card = game->followTable[suit_index(game->leadCard.suit)]
+                [game->roundDiamonds > 0];
     } else {
-        return INVALID;
+        card = ask_strategy(game, false);
+    }
+
+    start_message(game);
+    fprintf(game->toHub, "PLAY%c%c\n", card.suit, encode_rank(card.rank));
+    fflush(game->toHub);
+
+    remove_card(card, game);
+    game->hasPlayed = true;
+    record_card(game, game->playerId, card);
+}
+
+
+/* Informs the strategy (if it observes the game) that the given player has
+ * played the given card.
+ */
+void observe_move(struct Game* game, int player, struct Card card) {
+    if (game->strategy->observe) {
+        game->strategy->observe(game->strategyState, game, player, card);
     }
 }
 
 
+/* Classifies the messages being inputted by the hub,
+ * in order for the player to determine their next move. Messages are
+ * told apart by their first bytes, and only then is the whole keyword
+ * checked.
+ */
+enum HubMessage classify_hub_message(const char* input) {
+    switch (input[0]) {
+        case 'H':
+            return memcmp(input, "HAND", 4) ? INVALID : HAND;
+        case 'P':
+            return memcmp(input, "PLAYED", 6) ? INVALID : PLAYED;
+        case 'G':
+            return memcmp(input, "GAMEOVER", 8) ? INVALID : GAMEOVER;
+        case 'N':
+            if (input[1] != 'E' || input[2] != 'W') {
+                return INVALID;
+            } else if (input[3] == 'R') {
+                return memcmp(input + 3, "ROUND", 5) ? INVALID : NEWROUND;
+            } else if (input[3] == 'G') {
+                return memcmp(input + 3, "GAME", 4) ? INVALID : NEWGAME;
+            }
+    }
+
+    return INVALID;
+}
+
+
 /* Initialises each player's number of diamond cards to be zero
  * at the beginning of a new game.
  */
 void initialise_num_diamonds(struct Game* game) {
-    game->numDiamondCards = malloc(sizeof(int) * game->numPlayers);
+    game->numDiamondCards = ledger_malloc(LEDGER_GAMES, 
+            sizeof(int) * game->numPlayers);
 
     for (int i = 0; i < game->numPlayers; i++) {
         game->numDiamondCards[i] = 0;
@@ -469,6 +608,93 @@ void initialise_num_diamonds(struct Game* game) {
 }
 
 
+/* Creates the strategy's state for the game, or prepares the existing
+ * state if it was created for a game with the same arguments. Strategies
+ * without a reset hook are created afresh for every game.
+ */
+void start_strategy(struct Game* game, const struct Game* previous) {
+    const struct Strategy* strategy = game->strategy;
+
+    if (previous && strategy->reset && 
+            previous->numPlayers == game->numPlayers &&
+            previous->playerId == game->playerId &&
+            previous->threshold == game->threshold &&
+            previous->handSize == game->handSize) {
+        game->strategyState = previous->strategyState;
+        strategy->reset(game->strategyState, game);
+        return;
+    }
+
+    if (previous && strategy->release) {
+        strategy->release(previous->strategyState);
+    }
+
+    if (strategy->init) {
+        game->strategyState = strategy->init(game);
+    } else {
+        game->strategyState = NULL;
+    }
+}
+
+
+/* Prepares the per-game buffers once the arguments are known, before the
+ * first message of the game arrives.
+ */
+void begin_game(struct Game* game) {
+    game->cardsPlayed = ledger_malloc(LEDGER_GAMES, 
+            sizeof(char) * (2 * game->numPlayers + 1));
+    game->cardsPlayed[0] = '\0';
+    game->currentCard = ledger_malloc(LEDGER_GAMES, sizeof(char) * 3);
+    game->initialHandSize = game->handSize;
+    game->hand = ledger_malloc(LEDGER_GAMES, 
+            sizeof(struct Card) * game->handSize);
+    game->numCardsPlayed = 0;
+    game->hasHand = false;
+    game->hasRound = false;
+    game->isOver = false;
+    initialise_num_diamonds(game);
+    initialise_knowledge(game);
+}
+
+
+/* Handles a single message from the hub, making this player's move if
+ * the message is its turn. Sets isOver once the game has finished.
+ * Returns the relevant exit status if the message is invalid.
+ */
+enum ExitMessage handle_hub_message(struct Game* game, const char* input) {
+    enum ExitMessage errorMessage = 0;
+
+    switch (classify_hub_message(input)) {
+        case HAND:
+            errorMessage = game->hasHand ? INVALID_MESSAGE : 
+                    handle_new_hand(game, input);
+            break;
+        case NEWROUND:
+            errorMessage = !game->hasHand ? INVALID_MESSAGE :
+                    handle_new_round(game, input);
+            game->hasRound = true;
+            break;
+        case PLAYED:
+            errorMessage = !game->hasHand || !game->hasRound ? 
+                    INVALID_MESSAGE : handle_player_move(game, input);
+            break;
+        case GAMEOVER:
+            game->isOver = true;
+            break;
+        case NEWGAME:
+        case INVALID:
+            errorMessage = INVALID_MESSAGE;
+            break;
+    }
+
+    if (game->hasHand && game->handSize == 0) {
+        game->isOver = true;
+    }
+
+    return errorMessage;
+}
+
+
 /* Handles the entire game once everything is initialised. If the
  * player has successully been created, then it continuously checks
  * for input from the hub, and classifies the information sent through
@@ -477,63 +703,47 @@ void initialise_num_diamonds(struct Game* game) {
  * relevant exit status otherwise.
  */
 enum ExitMessage play_game(struct Game* game) {
-    bool isHand = false;
-    bool isNewRound = false;
-    char* input = malloc(sizeof(char) * 80);
     enum ExitMessage errorMessage = 0;
-    game->cardsPlayed = malloc(sizeof(char) * (2 * game->numPlayers + 1));
-    game->currentCard = malloc(sizeof(char) * 3);
-    game->numCardsPlayed = 0;
-    initialise_num_diamonds(game);
+    char* input = NULL;
+    size_t size = 0;
 
-    while (1) {
-        input = get_line(stdin);
+    begin_game(game);
+    trace_begin("game", game->playerId);
 
-        if (input == NULL) {
-            return EOF_SIGNAL;
+    while (!game->isOver && !errorMessage) {
+        trace_begin("wait", game->playerId);
+        if (read_line(game->fromHub, &input, &size) < 0) {
+            errorMessage = EOF_SIGNAL;
+            trace_end("wait", game->playerId);
+        } else {
+            trace_end("wait", game->playerId);
+            errorMessage = handle_hub_message(game, input);
         }
+        ledger_poll();
+    }
 
-        enum HubMessage hubMessage = classify_hub_message(input);
-        switch (hubMessage) {
-            case HAND:
-                errorMessage = handle_new_hand(game, input);
-                isHand = true;
-                break;
-            case NEWROUND:
-                if (!isHand) {
-                    return INVALID_MESSAGE;
-                }
-                errorMessage = handle_new_round(game, input);
-                isNewRound = true;
-                break;
-            case PLAYED:
-                if (!isHand || !isNewRound) {
-                    return INVALID_MESSAGE;
-                }
-                errorMessage = handle_player_move(game, input);
-                break;
-            case GAMEOVER:
-                return NORMAL_EXIT;
-            case INVALID:
-                return INVALID_MESSAGE;
-        }
+    trace_end("game", game->playerId);
+    trace_flush();
+    free(input);
+    return errorMessage;
+}
 
-        if (errorMessage) {
-            return errorMessage;
-        }
 
-        if (game->handSize == 0) {
-            return NORMAL_EXIT;
-        }
-    }
+/* Releases the memory used by a game once it is over, except for the
+ * strategy's state.
+ */
+void release_game(struct Game* game) {
+    ledger_free(LEDGER_GAMES, game->cardsPlayed);
+    ledger_free(LEDGER_GAMES, game->currentCard);
+    ledger_free(LEDGER_GAMES, game->hand);
+    ledger_free(LEDGER_GAMES, game->numDiamondCards);
+    ledger_free(LEDGER_GAMES, game->knowledge.voids);
 }
 
 
-/* Classifies and handles all error messages found in the program
- * and determines the appropriate output upon the completion of a
- * game - whether that be due to an error or a complete match.
+/* Outputs the message for an exit status to stderr.
  */
-void handle_game_over(enum ExitMessage exitMessage) {
+void report_exit(enum ExitMessage exitMessage) {
     switch (exitMessage) {
         case NORMAL_EXIT:
             break;
@@ -558,26 +768,179 @@ void handle_game_over(enum ExitMessage exitMessage) {
         case EOF_SIGNAL:
             fprintf(stderr, "EOF\n");
             break;
+        case INVALID_STRATEGY:
+            fprintf(stderr, "Invalid strategy\n");
+            break;
+        case INVALID_ADDRESS:
+            fprintf(stderr, "Invalid address\n");
+            break;
     }
+}
 
+
+/* Classifies and handles all error messages found in the program
+ * and determines the appropriate output upon the completion of a
+ * game - whether that be due to an error or a complete match.
+ */
+void handle_game_over(enum ExitMessage exitMessage) {
+    report_exit(exitMessage);
     exit(exitMessage);
 }
 
 
-int main(int argc, char** argv) {
+/* Handles the first message of a connection to a listening player,
+ * NEWGAMEplayers,myid,threshold,handsize, which carries the arguments a
+ * player program would otherwise be started with. The arguments are
+ * checked as if they were given on the command line.
+ */
+enum ExitMessage handle_new_game(struct Game* game, char* input) {
+    char* argv[6] = {"player", NULL, NULL, NULL, NULL, NULL};
+    int argc = 1;
+    char* field = input + strlen("NEWGAME");
+
+    while (argc < 6) {
+        argv[argc++] = field;
+        field = strchr(field, ',');
+
+        if (!field) {
+            break;
+        }
+        *field++ = '\0';
+    }
+
+    return check_valid_args(game, argc, argv);
+}
+
+
+/* Serves games to hubs connecting to the given address, one connection
+ * at a time, until the listening socket fails. Each connection plays a
+ * single game. The strategy's state is kept between games, so that a
+ * strategy can keep whatever it has computed for the next game.
+ */
+int serve_player(const struct Strategy* strategy, const char* address) {
+    int listener = listen_address(address);
+    struct Game previous;
+    bool started = false;
+
+    if (listener < 0) {
+        handle_game_over(INVALID_ADDRESS);
+    }
+
+    // a hub closing its connection must not end the player
+    signal(SIGPIPE, SIG_IGN);
+
+    while (1) {
+        struct Game game;
+        enum ExitMessage errorMessage;
+        int connection;
+        char* input;
+
+        // an idle player still reports its memory when asked
+        if (!ledger_wait(listener)) {
+            break;
+        }
+        connection = accept_connection(listener);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        if (!open_streams(connection, &game.fromHub, &game.toHub)) {
+            continue;
+        }
+        game.gameId = -1;
+
+        input = get_line(game.fromHub);
+        if (!input) {
+            errorMessage = EOF_SIGNAL;
+        } else if (classify_hub_message(input) != NEWGAME) {
+            errorMessage = INVALID_MESSAGE;
+        } else {
+            errorMessage = handle_new_game(&game, input);
+        }
+        free(input);
+
+        if (!errorMessage) {
+            send_ready(&game);
+            game.strategy = strategy;
+            start_strategy(&game, started ? &previous : NULL);
+            previous = game;
+            started = true;
+
+            errorMessage = play_game(&game);
+            release_game(&game);
+        }
+
+        report_exit(errorMessage);
+        fclose(game.fromHub);
+        fclose(game.toHub);
+    }
+
+    return INVALID_ADDRESS;
+}
+
+
+/* Plays a single game against the hub on stdin and stdout, once the game's
+ * arguments are valid, and exits with the relevant status if it fails.
+ */
+int run_game(const struct Strategy* strategy, struct Game* game) {
     enum ExitMessage errorMessage;
-    struct Game game;
-    
-    errorMessage = check_valid_args(&game, argc, argv);
+
+    send_ready(game);
+    game->strategy = strategy;
+    start_strategy(game, NULL);
+    errorMessage = play_game(game);
+    release_game(game);
     if (errorMessage) {
         handle_game_over(errorMessage);
     }
 
-    errorMessage = play_game(&game);
-    if (errorMessage) {
-        handle_game_over(errorMessage);
+    if (strategy->release) {
+        strategy->release(game->strategyState);
     }
 
     return 0;
 }
 
+
+/* Runs a complete player program using the given strategy: validates the
+ * command line arguments, plays the game against the hub on stdin/stdout
+ * and exits with the relevant status. Given --listen address instead, the
+ * player serves games to hubs connecting to that address, one at a time,
+ * given --multiplex address it serves many games over each connection,
+ * and given --zygote address it forks a player for each hub's request.
+ * If STRATEGY_MEMO names a file, the decisions of pure hooks are cached in
+ * it, across every game and run using the same file, and if TRACE_FILE
+ * does, the player's waits and decisions are traced to it. SIGUSR1 has
+ * the player report the memory of its games to stderr.
+ */
+int run_player(const struct Strategy* strategy, int argc, char** argv) {
+    enum ExitMessage errorMessage;
+    struct Game game;
+
+    if (getenv(MEMO_ENV)) {
+        memo = memo_open(getenv(MEMO_ENV));
+    }
+    trace_open(strategy->name);
+    ledger_open(strategy->name);
+
+    if (argc == 3 && !strcmp(argv[1], "--listen")) {
+        return serve_player(strategy, argv[2]);
+    } else if (argc == 3 && !strcmp(argv[1], "--multiplex")) {
+        return serve_games(strategy, argv[2]);
+    } else if (argc == 3 && !strcmp(argv[1], "--zygote")) {
+        return serve_zygote(strategy, argv[2]);
+    }
+
+    game.fromHub = stdin;
+    game.toHub = stdout;
+    game.gameId = -1;
+    errorMessage = check_valid_args(&game, argc, argv);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    return run_game(strategy, &game);
+}
@@ -9,6 +9,8 @@
 #include <signal.h>
 #include <unistd.h>
 
+#include "utilities.h"
+
 
 /* Handles all possible exit statuses of player program.
  */
@@ -21,6 +23,8 @@ enum ExitMessage {
     INVALID_HAND_SIZE = 5,
     INVALID_MESSAGE = 6,
     EOF_SIGNAL = 7,
+    INVALID_STRATEGY = 8,
+    INVALID_ADDRESS = 9,
 };
 
 
@@ -31,6 +35,7 @@ enum HubMessage {
     NEWROUND,
     PLAYED,
     GAMEOVER,
+    NEWGAME,
     INVALID,
 };
 
@@ -45,6 +50,23 @@ struct Card {
 };
 
 
+/* What a player has learnt about the cards of a game so far. It is kept
+ * up to date as each card is played, so that strategies can consult it
+ * without replaying the game. Suits are indexed by suit_index.
+ */
+struct Knowledge {
+    // The ranks played so far in each suit, as bits 1 to 15
+    unsigned seen[NUM_SUITS];
+    // The number of cards of each suit neither played nor in this hand
+    int remaining[NUM_SUITS];
+    // The suits each player has shown they hold none of, one bit per suit
+    unsigned* voids;
+};
+
+
+struct Strategy;
+
+
 /* The main way of tracking the current state of the game. Stores all
  * information concerning the game in order to determine the current
  * leaders and progress through a match.
@@ -80,6 +102,31 @@ struct Game {
     int roundDiamonds;
     // Whether this player has played their hand or not in a round
     bool hasPlayed;
+    // The card the strategy would follow with for each lead suit, without
+    // and with a diamond played in the round, if hasFollowTable is set
+    struct Card followTable[NUM_SUITS][2];
+    // Whether followTable holds this round's answers
+    bool hasFollowTable;
+    // What this player has learnt about the cards in the game
+    struct Knowledge knowledge;
+    // The id of the game on a multiplexed connection, or -1
+    int gameId;
+    // The hand size given in the arguments, which the hand must match
+    int initialHandSize;
+    // Whether the hand has been received
+    bool hasHand;
+    // Whether the first round of the game has started
+    bool hasRound;
+    // Whether the game has finished
+    bool isOver;
+    // The stream of messages from the hub
+    FILE* fromHub;
+    // The stream of messages to the hub
+    FILE* toHub;
+    // The strategy choosing this player's moves
+    const struct Strategy* strategy;
+    // The strategy's private state for this game
+    void* strategyState;
 };
 
 
@@ -89,12 +136,18 @@ struct Game {
 void remove_card(struct Card card, struct Game* game);
 
 
+/* Returns true if the player holds at least one card of the given suit.
+ */
+bool has_suit(const struct Game* game, char suit);
+
+
 /* Finds the highest card from a given suit, specified by the order of
  * the suit array. If there are no cards in the first suit, then the 
  * next suit is checked, and so on, until at least one card of a suit
  * is found.
  */
-void find_highest(struct Game* game, struct Card* cards, char suit[]);
+void find_highest(const struct Game* game, struct Card* cards, 
+        const char suit[]);
 
 
 /* Finds the lowest card from a given suit, specified by the order of
@@ -102,21 +155,24 @@ void find_highest(struct Game* game, struct Card* cards, char suit[]);
  * next suit is checked, and so on, until at least one card of a suit
  * is found.
  */
-void find_lowest(struct Game* game, struct Card* cards, char suit[]);
+void find_lowest(const struct Game* game, struct Card* cards, 
+        const char suit[]);
 
 
 /* Attempts to find the lowest card of the specified suit, and returns true if
  * there is at least one card. Otherwise, there are no cards and false is 
  * returned.
  */
-bool find_lowest_suit(struct Game* game, struct Card* cards, char suit);
+bool find_lowest_suit(const struct Game* game, struct Card* cards, 
+        char suit);
 
 
 /* Attempts to find the highest card of the specified suit, and returns true if
  * there is at least one card. Otherwise, there are no cards and false is 
  * returned.
  */
-bool find_highest_suit(struct Game* game, struct Card* cards, char suit);
+bool find_highest_suit(const struct Game* game, struct Card* cards, 
+        char suit);
 
 
 /* Verifies that the given card is valid, and returns the relevant
@@ -133,18 +189,39 @@ enum ExitMessage check_valid_number(char* input, enum ExitMessage errorCode,
 enum ExitMessage check_valid_args(struct Game* game, int argc, char** argv);
 
 
+/* Starts a message to the hub, by writing the game's id first if the
+ * game is played over a multiplexed connection.
+ */
+void start_message(const struct Game* game);
+
+
+/* Tells the hub that the player has accepted its arguments. This is a
+ * lone @ on a plain connection, and a line of its own on a multiplexed
+ * connection.
+ */
+void send_ready(struct Game* game);
+
+
 /* Handles the initialisation of a player's hand by checking cards
  * are valid, and adding them to the player to be used throughout
- * the game.
+ * the game. The message is HANDn followed by ,card n times, and the
+ * cards are parsed in place into the hand allocated by begin_game.
  */
-enum ExitMessage handle_new_hand(struct Game* game, char* input);
+enum ExitMessage handle_new_hand(struct Game* game, const char* input);
 
 
 /* Handles the beginning of a new round by resetting the state of
  * a round, as well as checking whether this player is leader. Returns
  * status 0 on normal exit, and the relevant message otherwise.
  */
-enum ExitMessage handle_new_round(struct Game* game, char* input);
+enum ExitMessage handle_new_round(struct Game* game, const char* input);
+
+
+/* Asks a strategy whose follow hook is pure for its answer to every lead
+ * suit of the round, so that the answer is ready when this player's turn
+ * comes.
+ */
+void speculate_follow(struct Game* game);
 
 
 /* Displays the end of round information to stderr, including
@@ -165,29 +242,69 @@ void calculate_num_diamonds(struct Game* game);
  * the value can be added to the round winner's score at the end of
  * each round.
  */
-void check_round_leader(struct Game* game, char* card);
+void check_round_leader(struct Game* game, struct Card card);
+
+
+/* Initialises the knowledge of a new game, with no cards seen and
+ * no player known to be out of any suit.
+ */
+void initialise_knowledge(struct Game* game);
+
+
+/* Updates the knowledge of the game with a card played by the given
+ * player: the card is seen, is no longer held by another player, and
+ * a player who did not follow the lead suit holds none of it.
+ */
+void update_knowledge(struct Game* game, int player, struct Card card);
+
+
+/* Returns true if the given player has shown they hold no cards of
+ * the given suit.
+ */
+bool is_void(const struct Game* game, int player, char suit);
+
+
+/* Records a card played by any player, including this one: tracks the
+ * lead card and round winner, the cards played in the round, and the
+ * knowledge of the game, and then informs the strategy.
+ */
+void record_card(struct Game* game, int player, struct Card card);
+
+
+/* Asks the strategy for the card to lead with if lead is set, and to follow
+ * with otherwise. Decisions of a pure hook are looked up in the decision
+ * cache first, and stored in it once made.
+ */
+struct Card ask_strategy(struct Game* game, bool lead);
 
 
-/* Checks whether the lead player for the round is this current player.
- * If so, makes move based on this, and otherwise makes a non-lead move.
+/* Asks the strategy for this player's next card, depending on whether this
+ * player leads the round, then sends the move to the hub and removes the
+ * card from the player's hand.
  */
 void make_new_move(struct Game* game);
 
 
+/* Informs the strategy (if it observes the game) that the given player has
+ * played the given card.
+ */
+void observe_move(struct Game* game, int player, struct Card card);
+
+
 /* Handles an input in which another player has played a card by
- * first checking whether they were the leader, and if so storing
- * their card information to determine the player's move. Otherwise,
- * the player track's the current player, and once it is their turn
- * outputs their move. Once all players have moved, the end of round
- * information is determined. Returns the relevant exit message.
+ * recording it, and once it is this player's turn outputting their
+ * move. Once all players have moved, the end of round information
+ * is determined. Returns the relevant exit message.
  */
-enum ExitMessage handle_player_move(struct Game* game, char* input);
+enum ExitMessage handle_player_move(struct Game* game, const char* input);
 
 
 /* Classifies the messages being inputted by the hub,
- * in order for the player to determine their next move.
+ * in order for the player to determine their next move. Messages are
+ * told apart by their first bytes, and only then is the whole keyword
+ * checked.
  */
-enum HubMessage classify_hub_message(char* input);
+enum HubMessage classify_hub_message(const char* input);
 
 
 /* Initialises each player's number of diamond cards to be zero
@@ -196,6 +313,26 @@ enum HubMessage classify_hub_message(char* input);
 void initialise_num_diamonds(struct Game* game);
 
 
+/* Creates the strategy's state for the game, or prepares the existing
+ * state if it was created for a game with the same arguments. Strategies
+ * without a reset hook are created afresh for every game.
+ */
+void start_strategy(struct Game* game, const struct Game* previous);
+
+
+/* Prepares the per-game buffers once the arguments are known, before the
+ * first message of the game arrives.
+ */
+void begin_game(struct Game* game);
+
+
+/* Handles a single message from the hub, making this player's move if
+ * the message is its turn. Sets isOver once the game has finished.
+ * Returns the relevant exit status if the message is invalid.
+ */
+enum ExitMessage handle_hub_message(struct Game* game, const char* input);
+
+
 /* Handles the entire game once everything is initialised. If the
  * player has successully been created, then it continuously checks
  * for input from the hub, and classifies the information sent through
@@ -206,6 +343,17 @@ void initialise_num_diamonds(struct Game* game);
 enum ExitMessage play_game(struct Game* game);
 
 
+/* Releases the memory used by a game once it is over, except for the
+ * strategy's state.
+ */
+void release_game(struct Game* game);
+
+
+/* Outputs the message for an exit status to stderr.
+ */
+void report_exit(enum ExitMessage exitMessage);
+
+
 /* Classifies and handles all error messages found in the program
  * and determines the appropriate output upon the completion of a
  * game - whether that be due to an error or a complete match.
@@ -213,4 +361,36 @@ enum ExitMessage play_game(struct Game* game);
 void handle_game_over(enum ExitMessage exitMessage);
 
 
+/* Handles the first message of a connection to a listening player,
+ * NEWGAMEplayers,myid,threshold,handsize, which carries the arguments a
+ * player program would otherwise be started with. The arguments are
+ * checked as if they were given on the command line.
+ */
+enum ExitMessage handle_new_game(struct Game* game, char* input);
+
+
+/* Serves games to hubs connecting to the given address, one connection
+ * at a time, until the listening socket fails. Each connection plays a
+ * single game. The strategy's state is kept between games, so that a
+ * strategy can keep whatever it has computed for the next game.
+ */
+int serve_player(const struct Strategy* strategy, const char* address);
+
+
+/* Plays a single game against the hub on stdin and stdout, once the game's
+ * arguments are valid, and exits with the relevant status if it fails.
+ */
+int run_game(const struct Strategy* strategy, struct Game* game);
+
+
+/* Runs a complete player program using the given strategy: validates the
+ * command line arguments, plays the game against the hub on stdin/stdout
+ * and exits with the relevant status. Given --listen address instead, the
+ * player serves games to hubs connecting to that address, one at a time,
+ * given --multiplex address it serves many games over each connection,
+ * and given --zygote address it forks a player for each hub's request.
+ */
+int run_player(const struct Strategy* strategy, int argc, char** argv);
+
+
 #endif
@@ -0,0 +1,83 @@
+#ifndef RULES_H
+#define RULES_H
+
+
+/* The rules of the game, fixed when the programs are built. Each can be
+ * overridden on the compiler command line, for example with
+ * make RULES="-DRULES_DIAMONDS=0", which scores spades instead of
+ * diamonds. Players, plugins and hubs must be built with the same rules.
+ * alice, bob and carol name the standard suits in their suit orders, so
+ * builds with other suits must give them orders of their own.
+ */
+
+
+/* The suits of the game, in the order used by suit_index.
+ */
+#ifndef RULES_SUITS
+#define RULES_SUITS "SCDH"
+#endif
+
+
+/* The number of suits in RULES_SUITS. A hand mask holds 16 ranks of each
+ * suit in 64 bits, so there can be at most four.
+ */
+#ifndef RULES_NUM_SUITS
+#define RULES_NUM_SUITS 4
+#endif
+
+
+/* The position of the diamond suit, whose cards are counted towards the
+ * threshold, in RULES_SUITS.
+ */
+#ifndef RULES_DIAMONDS
+#define RULES_DIAMONDS 2
+#endif
+
+
+/* The lowest and highest ranks of a card. Ranks are single hexadecimal
+ * digits, so they lie between 1 and 15.
+ */
+#ifndef RULES_MIN_RANK
+#define RULES_MIN_RANK 1
+#endif
+
+#ifndef RULES_MAX_RANK
+#define RULES_MAX_RANK 15
+#endif
+
+
+/* The most players in one game of the in-process model, and so of
+ * 2310multihub, 2310solve, 2310sweep and 2310tune, and in one game of
+ * 2310tourney or one result read by 2310stats. The hub sizes its seat
+ * arrays for each game, so it takes any number of players.
+ */
+#ifndef RULES_MAX_SEATS
+#define RULES_MAX_SEATS 16
+#endif
+
+
+#if RULES_NUM_SUITS < 1 || RULES_NUM_SUITS > 4
+#error "RULES_NUM_SUITS must be between 1 and 4"
+#endif
+
+#if RULES_MIN_RANK < 1 || RULES_MAX_RANK > 15 || \
+        RULES_MIN_RANK > RULES_MAX_RANK
+#error "ranks must lie between 1 and 15"
+#endif
+
+#if RULES_DIAMONDS < 0 || RULES_DIAMONDS >= RULES_NUM_SUITS
+#error "RULES_DIAMONDS must be the position of a suit"
+#endif
+
+#if RULES_MAX_SEATS < 2
+#error "RULES_MAX_SEATS must allow at least two players"
+#endif
+
+
+/* Fails to compile unless RULES_SUITS names RULES_NUM_SUITS suits.
+ */
+typedef char RulesSuitsCheck[
+        sizeof(RULES_SUITS) - 1 == RULES_NUM_SUITS ? 1 : -1];
+
+
+#endif
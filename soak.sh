@@ -0,0 +1,100 @@
+#!/bin/sh
+# Plays one game over and over in a single hub with HUB_SOAK, and then
+# through 2310multihub against alice and bob players serving --multiplex,
+# and fails if the hub or a player still holds memory once the games are
+# over, or if its RSS after a long soak has grown past that after a short
+# one. GAMES sets the length of the long soaks and SLACK the growth in kB
+# allowed.
+
+GAMES=${GAMES:-2000}
+SLACK=${SLACK:-64}
+dir=$(mktemp -d)
+deck="$dir/deck"
+players=""
+trap 'kill $players 2>/dev/null; rm -rf "$dir"' EXIT
+
+{
+    echo 52
+    for suit in S C D H; do
+        for rank in 1 2 3 4 5 6 7 8 9 a b c d; do
+            echo "$suit$rank"
+        done
+    done
+} > "$deck"
+
+# the hub's final memory report, one subsystem=live/bytes/total at a time
+report() {
+    HUB_SOAK=$1 ./2310hub "$deck" 4 ./2310alice ./2310bob 2>&1 >/dev/null |
+            grep '^Memory of 2310hub' | tail -n 1
+}
+
+rss() {
+    echo "$1" | sed -n 's/.*rss=\([0-9]*\)kB.*/\1/p'
+}
+
+# fails unless both reports of a process were written, the long one holds
+# no memory, and the RSS grew by no more than SLACK between them
+check() {
+    echo "$3"
+
+    if [ -z "$2" ] || [ -z "$3" ]; then
+        echo "soak: $1 gave no memory report" >&2
+        exit 1
+    fi
+
+    if echo "$3" | grep -Eq '=[1-9][0-9]*/|/[1-9][0-9]*B/'; then
+        echo "soak: $1 still holds memory after $GAMES games" >&2
+        exit 1
+    fi
+
+    if [ $(($(rss "$3") - $(rss "$2"))) -gt "$SLACK" ]; then
+        echo "soak: $1 RSS grew from $(rss "$2")kB to $(rss "$3")kB" >&2
+        exit 1
+    fi
+}
+
+check 2310hub "$(report 100)" "$(report "$GAMES")"
+
+# a corpus of 100 copies of the deck, played GAMES / 100 times over
+mkdir "$dir/corpus"
+for i in $(seq 100); do
+    cp "$deck" "$dir/corpus/$i"
+done
+
+./2310alice --multiplex "unix:$dir/alice" 2>"$dir/alice.log" &
+players="$!"
+./2310bob --multiplex "unix:$dir/bob" 2>"$dir/bob.log" &
+players="$players $!"
+for i in $(seq 50); do
+    [ -S "$dir/alice" ] && [ -S "$dir/bob" ] && break
+    sleep 0.1
+done
+
+# the latest memory report of a player, asked for with SIGUSR1 once it has
+# served every game so far
+player_report() {
+    before=$(grep -c '^Memory of' "$dir/$2.log")
+
+    kill -USR1 "$1"
+    for i in $(seq 50); do
+        [ "$(grep -c '^Memory of' "$dir/$2.log")" -gt "$before" ] && break
+        sleep 0.1
+    done
+    grep '^Memory of' "$dir/$2.log" | tail -n 1
+}
+
+play() {
+    ./2310multihub 4 "$dir/corpus" "unix:$dir/alice" "unix:$dir/bob" \
+            >/dev/null
+}
+
+play
+set -- $players
+alice=$(player_report "$1" alice)
+bob=$(player_report "$2" bob)
+
+for i in $(seq 2 $((GAMES / 100))); do
+    play
+done
+check alice "$alice" "$(player_report "$1" alice)"
+check bob "$bob" "$(player_report "$2" bob)"
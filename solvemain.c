@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "utilities.h"
+#include "model.h"
+#include "deck.h"
+#include "solver.h"
+
+
+/* Defines all possible exit statuses of the solver, with the same values
+ * as the hub's.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INVALID_THRESHOLD = 2,
+    DECK_ERROR = 3,
+    SMALL_DECK = 4,
+    SOLVER_ERROR = 5,
+    UNSOLVED = 6,
+};
+
+
+/* The arguments of the solver.
+ */
+struct SolveArgs {
+    // The number of threads searching
+    int threads;
+    // The most positions searched for each deck, or 0 for no limit
+    long budget;
+    // The threshold of every game
+    int threshold;
+    // The number of seats in every game
+    int numSeats;
+    // The deck files to solve, one game each
+    char** decks;
+    // The number of deck files
+    int numDecks;
+};
+
+
+/* Checks the arguments and fills args from them. Returns 0 on success,
+ * and the relevant exit status otherwise.
+ */
+enum ExitMessage check_valid_args(struct SolveArgs* args, int argc,
+        char** argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+    char* end;
+
+    args->threads = threads > 0 ? threads : 1;
+    args->budget = 0;
+    while ((option = getopt(argc, argv, "j:n:")) != -1) {
+        switch (option) {
+            case 'j':
+                args->threads = atoi(optarg);
+                if (args->threads < 1) {
+                    return ARGUMENT_LENGTH;
+                }
+                break;
+            case 'n':
+                args->budget = strtol(optarg, &end, 10);
+                if (end == optarg || *end || args->budget < 0) {
+                    return ARGUMENT_LENGTH;
+                }
+                break;
+            default:
+                return ARGUMENT_LENGTH;
+        }
+    }
+
+    if (argc - optind < 3) {
+        return ARGUMENT_LENGTH;
+    }
+
+    args->threshold = atoi(argv[optind]);
+    args->numSeats = atoi(argv[optind + 1]);
+    args->decks = &argv[optind + 2];
+    args->numDecks = argc - optind - 2;
+
+    if (args->numSeats < 2 || args->numSeats > MODEL_MAX_PLAYERS) {
+        return ARGUMENT_LENGTH;
+    }
+
+    if (args->threshold < 2) {
+        return INVALID_THRESHOLD;
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_game_over(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310solve [-j threads] [-n positions] "
+                    "threshold players deck {deck}\n");
+            break;
+        case INVALID_THRESHOLD:
+            fprintf(stderr, "Invalid threshold\n");
+            break;
+        case DECK_ERROR:
+            fprintf(stderr, "Deck error\n");
+            break;
+        case SMALL_DECK:
+            fprintf(stderr, "Not enough cards\n");
+            break;
+        case SOLVER_ERROR:
+            fprintf(stderr, "Cannot allocate solver\n");
+            break;
+        case UNSOLVED:
+            fprintf(stderr, "Some decks were not solved\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+/* The double-dummy solver, 2310solve, which plays each deck's game with
+ * every hand known, and outputs after the deck file the score each seat
+ * is sure of by its best play when every other seat plays against it, in
+ * the format 2310stats reads. The search is shared between the given
+ * number of threads, by default one per online processor. The number of
+ * positions searched for each deck is written to stderr. Every deck is
+ * solved unless -n gives a budget of positions for each, since a full
+ * deck of four seats takes a few minutes of one processor and some take
+ * more than twenty. A deck whose search spends its budget is left out of
+ * the output, the bounds found on each seat's score are written to
+ * stderr instead as lower..upper, and the solver exits with status 6
+ * after the last deck.
+ */
+int main(int argc, char** argv) {
+    struct SolveArgs args;
+    struct Solver* solver;
+    bool unsolved = false;
+    enum ExitMessage errorMessage = check_valid_args(&args, argc, argv);
+
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    solver = solver_create(args.threads);
+    if (!solver) {
+        handle_game_over(SOLVER_ERROR);
+    }
+
+    for (int i = 0; i < args.numDecks && !errorMessage; i++) {
+        struct ModelState state;
+        int lower[MODEL_MAX_PLAYERS];
+        int upper[MODEL_MAX_PLAYERS];
+        bool solved = true;
+        long nodes;
+
+        errorMessage = (enum ExitMessage)deck_load(args.decks[i],
+                args.numSeats, args.threshold, &state, NULL);
+        if (errorMessage) {
+            break;
+        }
+
+        nodes = solver_solve(solver, &state, args.budget, lower, upper);
+        for (int j = 0; j < args.numSeats; j++) {
+            solved = solved && lower[j] == upper[j];
+        }
+        fprintf(stderr, "%s: %ld positions", args.decks[i], nodes);
+        if (!solved) {
+            // bounds are not scores, so 2310stats is never given them
+            fprintf(stderr, ", unsolved");
+            for (int j = 0; j < args.numSeats; j++) {
+                fprintf(stderr, " %d:%d..%d", j, lower[j], upper[j]);
+            }
+            fprintf(stderr, "\n");
+            unsolved = true;
+            continue;
+        }
+        fprintf(stderr, "\n");
+
+        printf("%s", args.decks[i]);
+        for (int j = 0; j < args.numSeats; j++) {
+            printf(" %d:%d", j, lower[j]);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    solver_free(solver);
+    handle_game_over(!errorMessage && unsolved ? UNSOLVED : errorMessage);
+    return NORMAL_EXIT;
+}
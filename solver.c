@@ -0,0 +1,887 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "solver.h"
+
+
+// A score beyond any reachable one, bounding every search window
+#define SCORE_LIMIT 1000
+
+// The number of entries in the transposition table
+#define TABLE_SIZE ((size_t)1 << SOLVER_TABLE_BITS)
+
+// The number of entries in each bucket of the table
+#define BUCKET_SIZE 2
+
+// The card recorded in a table entry without a best lead
+#define NO_CARD 0xff
+
+// The most moves in one position: every card of a hand
+#define MAX_MOVES 64
+
+// The cards of one suit
+#define SUIT_CARDS(suit) ((uint64_t)0xffff << ((suit) * MODEL_SUIT_BITS))
+
+// The cards of the diamond suit
+#define DIAMOND_CARDS SUIT_CARDS(MODEL_DIAMONDS)
+
+// The priority of the best lead recorded for a position
+#define BEST_PRIORITY 1000
+
+// The number of positions a thread searches between checks of the budget
+#define BUDGET_STEP 4096
+
+
+/* An entry of the transposition table, read and written by every thread
+ * without locks. The key is stored xored with the data, so that an entry
+ * torn by two threads writing at once no longer matches its key.
+ */
+struct Entry {
+    // The round's key xored with the data
+    uint64_t check;
+    // The bounds of the round's value, its rounds left and best lead
+    uint64_t data;
+};
+
+
+/* A solver of dealt games with every hand known.
+ */
+struct Solver {
+    // The number of threads searching
+    int threads;
+    // The transposition table, shared by every thread
+    struct Entry* table;
+    // The number of games solved so far
+    unsigned games;
+};
+
+
+struct Work;
+
+
+/* The search of one seat's score by one thread. The seat plays for its
+ * own score and every other seat plays against it.
+ */
+struct Search {
+    // The shared transposition table
+    struct Entry* table;
+    // The game being solved, counted from the solver's first, modulo 256
+    unsigned game;
+    // The work of the solve, whose budget every search shares
+    struct Work* work;
+    // Whether the budget has been spent, so that the search is abandoned
+    // and nothing more is stored in the table
+    bool abandoned;
+    // The number of players in the game
+    int numPlayers;
+    // The seat whose score is searched
+    int seat;
+    // The threshold number of diamonds
+    int threshold;
+    // The cards each player still holds
+    uint64_t hands[MODEL_MAX_PLAYERS];
+    // The number of positions searched
+    long nodes;
+};
+
+
+/* The position of a round. Its value is the seat's final score less the
+ * rounds the seat has already won.
+ */
+struct Round {
+    // The player leading the round
+    int leader;
+    // The number of rounds left, including this one
+    int roundsLeft;
+    // The diamonds the seat has won in earlier rounds
+    int diamonds;
+    // The number of cards played in the round
+    int numPlayed;
+    // The lead suit, or -1 before the lead
+    int leadSuit;
+    // The player winning the round so far
+    int winner;
+    // The rank of the winning card so far
+    int winningRank;
+    // The number of diamonds played in the round
+    int roundDiamonds;
+    // The cards played in the round
+    uint64_t played;
+};
+
+
+/* A card which may be played, with the priority it is searched in.
+ */
+struct Move {
+    // The card
+    int card;
+    // Higher priorities are searched first
+    int priority;
+};
+
+
+/* The work shared by the threads of one solve: a task for each move of
+ * the first lead for each seat, and each seat's best score so far.
+ */
+struct Work {
+    // The solver
+    struct Solver* solver;
+    // The game being solved
+    const struct ModelState* state;
+    // The seat and first lead of each task
+    int (*tasks)[2];
+    // The bounds found on the value of each task's lead
+    int (*bounds)[2];
+    // The number of tasks
+    int numTasks;
+    // The next task to take
+    int next;
+    // The best score found for each seat, as its first lead is chosen by
+    // the lead player, who plays for it only if it is that seat
+    int best[MODEL_MAX_PLAYERS];
+    // The most positions to search, or 0 for no limit
+    long budget;
+    // The positions counted against the budget so far
+    long spent;
+    // The number of positions searched
+    long nodes;
+};
+
+
+/* Mixes the bits of a 64 bit number (the splitmix64 finaliser).
+ */
+static inline uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+
+/* Returns the highest card of a mask, which must not be empty.
+ */
+static inline int highest_card(uint64_t cards) {
+    return 63 - __builtin_clzll(cards);
+}
+
+
+/* Returns the cards of each player by their rank relative to the other
+ * live cards of their suit: a card with n lower live cards is bit
+ * suit * 16 + n. Only the order of the cards of a suit decides who wins a
+ * round, so rounds differing only in which lower cards have been played
+ * are the same.
+ */
+static void relative_hands(const struct Search* search, uint64_t live,
+        uint64_t relative[]) {
+    unsigned char owners[64];
+
+    for (int i = 0; i < search->numPlayers; i++) {
+        relative[i] = 0;
+        for (uint64_t cards = search->hands[i]; cards; cards &= cards - 1) {
+            owners[__builtin_ctzll(cards)] = i;
+        }
+    }
+
+    for (int suit = 0; suit < RULES_NUM_SUITS; suit++) {
+        uint64_t cards = live & SUIT_CARDS(suit);
+
+        for (int place = 0; cards; place++, cards &= cards - 1) {
+            relative[owners[__builtin_ctzll(cards)]] |= (uint64_t)1 <<
+                    (suit * MODEL_SUIT_BITS + place);
+        }
+    }
+}
+
+
+/* Returns the relative rank of a live card, as relative_hands gives it.
+ */
+static int relative_card(int card, uint64_t live) {
+    uint64_t below = live & SUIT_CARDS(card / MODEL_SUIT_BITS) &
+            (((uint64_t)1 << card) - 1);
+
+    return card / MODEL_SUIT_BITS * MODEL_SUIT_BITS +
+            __builtin_popcountll(below);
+}
+
+
+/* Returns the live card of the given relative rank, or NO_CARD if there
+ * is none.
+ */
+static int absolute_card(int relative, uint64_t live) {
+    uint64_t cards = live & SUIT_CARDS(relative / MODEL_SUIT_BITS);
+
+    for (int place = relative % MODEL_SUIT_BITS; place > 0 && cards;
+            place--) {
+        cards &= cards - 1;
+    }
+
+    return cards ? __builtin_ctzll(cards) : NO_CARD;
+}
+
+
+/* Returns the key of a round which has not started, given how its
+ * diamonds are keyed: the seat's diamonds, or a class of them in which
+ * the round's values differ only by an offset.
+ */
+static uint64_t round_key(const struct Search* search,
+        const struct Round* round, uint64_t live, int diamonds) {
+    uint64_t relative[MODEL_MAX_PLAYERS];
+    uint64_t key = mix(((uint64_t)search->seat << 48) ^
+            ((uint64_t)round->leader << 40) ^ ((uint64_t)diamonds << 20) ^
+            (uint64_t)search->threshold);
+
+    relative_hands(search, live, relative);
+    for (int i = 0; i < search->numPlayers; i++) {
+        key = mix(key ^ relative[i]);
+    }
+
+    // the key of an empty entry never matches
+    return key | 1;
+}
+
+
+/* Looks up the bounds and best lead of a round, with its best lead as a
+ * relative rank. Returns false if the table does not hold it.
+ */
+static bool probe(const struct Search* search, uint64_t key, int* lower,
+        int* upper, int* best) {
+    struct Entry* bucket = &search->table[key & (TABLE_SIZE - BUCKET_SIZE)];
+
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+
+        if ((check ^ data) == key) {
+            *lower = (int)(data & 0xffff) - 0x8000;
+            *upper = (int)(data >> 16 & 0xffff) - 0x8000;
+            *best = data >> 40 & 0xff;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* Records the bounds and best lead of a round, replacing the entry of the
+ * same round, or else whichever of its bucket has fewest rounds left,
+ * entries stored by earlier games first so that they never crowd out the
+ * rounds of this one.
+ */
+static void store(struct Search* search, uint64_t key, int lower, int upper,
+        int roundsLeft, int best) {
+    struct Entry* bucket = &search->table[key & (TABLE_SIZE - BUCKET_SIZE)];
+    struct Entry* entry = &bucket[0];
+    unsigned fewest = 0x200;
+    uint64_t data = (uint64_t)(lower + 0x8000) |
+            (uint64_t)(upper + 0x8000) << 16 | (uint64_t)roundsLeft << 32 |
+            (uint64_t)best << 40 | (uint64_t)search->game << 48;
+
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t old = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        unsigned rank = (old >> 32 & 0xff) |
+                ((old >> 48 & 0xff) == search->game) << 8;
+
+        if ((__atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED) ^ old) ==
+                key) {
+            entry = &bucket[i];
+            break;
+        }
+        if (rank < fewest) {
+            entry = &bucket[i];
+            fewest = rank;
+        }
+    }
+
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+
+/* Returns the cards of a mask with no equal among them: of each run of
+ * cards of one suit with no other live card between them, only the
+ * highest, since playing any card of a run has the same outcome.
+ */
+static uint64_t distinct_cards(uint64_t cards, uint64_t live) {
+    uint64_t distinct = 0;
+
+    while (cards) {
+        uint64_t card = cards & -cards;
+        uint64_t above = live & SUIT_CARDS(__builtin_ctzll(card) /
+                MODEL_SUIT_BITS) & ~(card | (card - 1));
+
+        // the card heads its run unless the next live card is one of ours
+        if (!(above & -above & cards)) {
+            distinct |= card;
+        }
+        cards &= cards - 1;
+    }
+
+    return distinct;
+}
+
+
+/* Returns the priority of a card following the lead: cards taking the
+ * round from the other side of the seat come first, lowest first, then
+ * every other card lowest first.
+ */
+static int follow_priority(const struct Search* search,
+        const struct Round* round, int player, int card) {
+    int suit = card / MODEL_SUIT_BITS;
+    int rank = card % MODEL_SUIT_BITS;
+    bool forSeat = player == search->seat;
+    bool wins = suit == round->leadSuit && rank > round->winningRank;
+    bool takes = wins && (round->winner == search->seat) != forSeat;
+
+    return takes ? 100 - rank : 50 - rank;
+}
+
+
+/* Fills moves with the distinct cards the current player may play, in
+ * the order they are searched: a lead's high cards first, and otherwise
+ * by follow_priority. Returns the number of moves.
+ */
+static int order_moves(const struct Search* search, const struct Round* round,
+        int player, uint64_t live, int best, struct Move* moves) {
+    uint64_t hand = search->hands[player];
+    uint64_t legal = hand;
+    uint64_t distinct;
+    int count = 0;
+
+    if (round->numPlayed) {
+        uint64_t follow = hand & SUIT_CARDS(round->leadSuit);
+
+        legal = follow ? follow : hand;
+    }
+
+    for (distinct = distinct_cards(legal, live); distinct;
+            distinct &= distinct - 1) {
+        int card = __builtin_ctzll(distinct);
+        struct Move move = {card, 0};
+        int i;
+
+        if (card == best) {
+            move.priority = BEST_PRIORITY;
+        } else if (!round->numPlayed) {
+            move.priority = card % MODEL_SUIT_BITS;
+        } else {
+            move.priority = follow_priority(search, round, player, card);
+        }
+
+        // insertion keeps the moves sorted by priority
+        for (i = count++; i > 0 && moves[i - 1].priority < move.priority;
+                i--) {
+            moves[i] = moves[i - 1];
+        }
+        moves[i] = move;
+    }
+
+    return count;
+}
+
+
+/* Returns the score from diamonds of a seat which has won the given
+ * number of diamonds.
+ */
+static inline int diamond_score(const struct Search* search, int diamonds) {
+    return diamonds < search->threshold ? -diamonds : diamonds;
+}
+
+
+/* Returns the least score from diamonds of a seat which will have won
+ * between the given numbers of diamonds: the most below the threshold, or
+ * the least at or above it.
+ */
+static int least_diamond_score(const struct Search* search, int least,
+        int most) {
+    if (least >= search->threshold) {
+        return least;
+    }
+
+    return most < search->threshold ? -most : -(search->threshold - 1);
+}
+
+
+/* Returns the greatest score from diamonds of a seat which will have won
+ * between the given numbers of diamonds, which is at one end.
+ */
+static int most_diamond_score(const struct Search* search, int least,
+        int most) {
+    int first = diamond_score(search, least);
+    int last = diamond_score(search, most);
+
+    return first > last ? first : last;
+}
+
+
+/* Returns the cards of a player higher than every other live card of
+ * their suit, which win every round the player leads them in.
+ */
+static uint64_t sure_winners(const struct Search* search, int player,
+        uint64_t live) {
+    uint64_t hand = search->hands[player];
+    uint64_t others = live & ~hand;
+    uint64_t winners = 0;
+
+    for (int suit = 0; suit < RULES_NUM_SUITS; suit++) {
+        uint64_t rivals = others & SUIT_CARDS(suit);
+
+        // with 2 << 63 wrapping to 0, no card is above the highest slot
+        winners |= hand & SUIT_CARDS(suit) & (rivals ?
+                ~((2ULL << highest_card(rivals)) - 1) : ~0ULL);
+    }
+
+    return winners;
+}
+
+
+/* Returns true if the seat, not on lead, can never win a round: each of
+ * its suits is below every other player's cards of that suit, so it loses
+ * every round led by another player and never leads.
+ */
+static bool never_wins(const struct Search* search, uint64_t live) {
+    uint64_t hand = search->hands[search->seat];
+
+    for (int suit = 0; suit < RULES_NUM_SUITS; suit++) {
+        uint64_t mine = hand & SUIT_CARDS(suit);
+        uint64_t theirs = live & ~hand & SUIT_CARDS(suit);
+
+        if (mine && theirs &&
+                highest_card(mine) > __builtin_ctzll(theirs)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Bounds the value of a round which has not started. The player on lead
+ * can win a round with each of its sure winners in turn, so if that is
+ * the seat, its score is at least those rounds and the least its diamonds
+ * can score once it has their diamonds, and if every card it holds is a
+ * sure winner it wins every round. Otherwise the seat wins none of those
+ * rounds, nor the diamonds of the leader's winners, nor more than every
+ * card of the rounds left after them.
+ */
+static void quick_bounds(const struct Search* search,
+        const struct Round* round, uint64_t live, int* lower, int* upper) {
+    uint64_t winners = sure_winners(search, round->leader, live);
+    int quick = __builtin_popcountll(winners);
+    int quickDiamonds = __builtin_popcountll(winners & DIAMOND_CARDS);
+    int least = round->diamonds;
+    int most = least + __builtin_popcountll(live & DIAMOND_CARDS);
+
+    if (round->leader == search->seat) {
+        if (quick == round->roundsLeft) {
+            *lower = quick + diamond_score(search, most);
+            *upper = *lower;
+            return;
+        }
+        *lower = quick + least_diamond_score(search, least + quickDiamonds,
+                most);
+        *upper = round->roundsLeft + most_diamond_score(search, least, most);
+    } else if (never_wins(search, live)) {
+        *lower = diamond_score(search, least);
+        *upper = *lower;
+    } else {
+        int cards = search->numPlayers * (round->roundsLeft - quick);
+
+        most -= quickDiamonds;
+        *lower = least_diamond_score(search, least, most);
+        *upper = round->roundsLeft - quick + most_diamond_score(search, least,
+                most < least + cards ? most : least + cards);
+    }
+}
+
+
+static int search_round(struct Search* search, const struct Round* round,
+        int alpha, int beta);
+
+
+/* Counts a step of positions against the budget of the solve, and
+ * abandons the search if the budget has been spent.
+ */
+static void spend_budget(struct Search* search) {
+    struct Work* work = search->work;
+
+    if (work->budget && __atomic_add_fetch(&work->spent, BUDGET_STEP,
+            __ATOMIC_RELAXED) >= work->budget) {
+        search->abandoned = true;
+    }
+}
+
+
+/* Returns the value of a round after the current player plays a card,
+ * finishing the round if it is the last card of it.
+ */
+static int play_move(struct Search* search, const struct Round* round,
+        int card, int alpha, int beta) {
+    int player = (round->leader + round->numPlayed) % search->numPlayers;
+    int suit = card / MODEL_SUIT_BITS;
+    int rank = card % MODEL_SUIT_BITS;
+    struct Round next = *round;
+    int value;
+
+    search->hands[player] &= ~((uint64_t)1 << card);
+    next.played |= (uint64_t)1 << card;
+    next.roundDiamonds += suit == MODEL_DIAMONDS;
+
+    if (!next.numPlayed) {
+        next.leadSuit = suit;
+        next.winner = player;
+        next.winningRank = rank;
+    } else if (suit == next.leadSuit && rank > next.winningRank) {
+        next.winner = player;
+        next.winningRank = rank;
+    }
+
+    if (++next.numPlayed < search->numPlayers) {
+        value = search_round(search, &next, alpha, beta);
+    } else {
+        int point = next.winner == search->seat;
+
+        next.leader = next.winner;
+        next.roundsLeft--;
+        next.diamonds += point ? next.roundDiamonds : 0;
+        next.numPlayed = 0;
+        next.leadSuit = -1;
+        next.roundDiamonds = 0;
+        next.played = 0;
+        value = point + search_round(search, &next, alpha - point,
+                beta - point);
+    }
+
+    search->hands[player] |= (uint64_t)1 << card;
+    return value;
+}
+
+
+/* Returns the value of a round by alpha-beta search within the window
+ * alpha to beta: the seat takes the greatest value of its moves and every
+ * other player the least. A value outside the window is a bound on the
+ * true value. Rounds which have not started are kept in the table.
+ */
+static int search_round(struct Search* search, const struct Round* round,
+        int alpha, int beta) {
+    int player = (round->leader + round->numPlayed) % search->numPlayers;
+    bool forSeat = player == search->seat;
+    struct Move moves[MAX_MOVES];
+    uint64_t live = round->played;
+    uint64_t key = 0;
+    int lower = -SCORE_LIMIT;
+    int upper = SCORE_LIMIT;
+    int best = NO_CARD;
+    int offset = 0;
+    int searchAlpha, searchBeta;
+    int value;
+    int count;
+
+    if (++search->nodes % BUDGET_STEP == 0) {
+        spend_budget(search);
+    }
+    if (search->abandoned) {
+        return 0;
+    }
+
+    for (int i = 0; i < search->numPlayers; i++) {
+        live |= search->hands[i];
+    }
+
+    if (!round->numPlayed) {
+        int diamonds = round->diamonds;
+        int tableLower, tableUpper;
+
+        if (!round->roundsLeft) {
+            return diamond_score(search, diamonds);
+        }
+
+        quick_bounds(search, round, live, &lower, &upper);
+        if (upper <= alpha || lower >= beta || lower == upper) {
+            return upper <= alpha ? upper : lower;
+        }
+
+        // past the threshold the seat's diamonds only add to its score,
+        // and once it cannot reach it they only take from it, so rounds
+        // differing only in them share a key, offsetting the values kept
+        if (diamonds >= search->threshold) {
+            offset = diamonds;
+            diamonds = search->threshold;
+        } else if (diamonds + __builtin_popcountll(live & DIAMOND_CARDS) <
+                search->threshold) {
+            offset = -diamonds;
+            diamonds = search->threshold + 1;
+        }
+
+        key = round_key(search, round, live, diamonds);
+        if (probe(search, key, &tableLower, &tableUpper, &best)) {
+            tableLower += offset;
+            tableUpper += offset;
+            lower = tableLower > lower ? tableLower : lower;
+            upper = tableUpper < upper ? tableUpper : upper;
+            if (lower >= beta || upper <= alpha || lower == upper) {
+                return lower >= beta || lower == upper ? lower : upper;
+            }
+            best = absolute_card(best, live);
+        }
+        alpha = alpha > lower ? alpha : lower;
+        beta = beta < upper ? beta : upper;
+    }
+
+    searchAlpha = alpha;
+    searchBeta = beta;
+    count = order_moves(search, round, player, live, best, moves);
+    value = forSeat ? -SCORE_LIMIT : SCORE_LIMIT;
+
+    for (int i = 0; i < count && alpha < beta; i++) {
+        int moveValue = play_move(search, round, moves[i].card, alpha, beta);
+
+        // an abandoned search's values are not bounds, so are not kept
+        if (search->abandoned) {
+            return 0;
+        }
+        if (forSeat ? moveValue > value : moveValue < value) {
+            value = moveValue;
+            best = moves[i].card;
+        }
+        if (forSeat && value > alpha) {
+            alpha = value;
+        } else if (!forSeat && value < beta) {
+            beta = value;
+        }
+    }
+
+    if (key) {
+        store(search, key, (value > searchAlpha ? value : lower) - offset,
+                (value < searchBeta ? value : upper) - offset,
+                round->roundsLeft, relative_card(best, live));
+    }
+
+    return value;
+}
+
+
+/* Finds the value of a first lead by null-window searches, each testing
+ * whether the value reaches a guess and narrowing the bounds on it, with
+ * the table keeping what each test learnt for the next (MTD(f)). Only a
+ * value improving on the seat's best so far matters, so the tests stop
+ * once the bounds show the lead cannot, and otherwise the best is updated.
+ * The bounds reached are left in bounds, which start as bounds on every
+ * score of the game, when the tests stop or the budget is spent.
+ */
+static void solve_move(struct Search* search, const struct Round* start,
+        int card, int* best, bool maximise, int bounds[2]) {
+    int lower = bounds[0];
+    int upper = bounds[1];
+    int guess = 0;
+    int bound;
+
+    while (lower < upper) {
+        int value;
+
+        bound = __atomic_load_n(best, __ATOMIC_RELAXED);
+        if (maximise ? upper <= bound : lower >= bound) {
+            break;
+        }
+
+        // test value >= guess, for a guess in (lower, upper] which would
+        // improve on the best
+        if (maximise && guess <= bound) {
+            guess = bound + 1;
+        } else if (!maximise && guess > bound) {
+            guess = bound;
+        }
+        guess = guess <= lower ? lower + 1 : guess > upper ? upper : guess;
+
+        value = play_move(search, start, card, guess - 1, guess);
+        if (search->abandoned) {
+            break;
+        }
+        if (value >= guess) {
+            lower = value;
+            guess = value + 1;
+        } else {
+            upper = value;
+            guess = value;
+        }
+    }
+
+    bounds[0] = lower;
+    bounds[1] = upper;
+    if (lower < upper) {
+        return;
+    }
+
+    bound = __atomic_load_n(best, __ATOMIC_RELAXED);
+    while ((maximise ? lower > bound : lower < bound) &&
+            !__atomic_compare_exchange_n(best, &bound, lower, false,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+
+/* Takes tasks until none are left, solving each seat's first leads.
+ */
+static void* solve_tasks(void* argument) {
+    struct Work* work = argument;
+    const struct ModelState* state = work->state;
+    struct Search search;
+    struct Round start;
+    int task;
+
+    memset(&start, 0, sizeof(start));
+    start.leader = state->leadPlayer;
+    start.roundsLeft = state->roundsLeft;
+    start.leadSuit = -1;
+
+    search.table = work->solver->table;
+    search.game = work->solver->games & 0xff;
+    search.work = work;
+    search.abandoned = false;
+    search.numPlayers = state->numPlayers;
+    search.threshold = state->threshold;
+    search.nodes = 0;
+    memcpy(search.hands, state->hands, sizeof(search.hands));
+
+    while (!search.abandoned && (task = __atomic_fetch_add(&work->next, 1,
+            __ATOMIC_RELAXED)) < work->numTasks) {
+        int seat = work->tasks[task][0];
+
+        search.seat = seat;
+        solve_move(&search, &start, work->tasks[task][1], &work->best[seat],
+                seat == state->leadPlayer, work->bounds[task]);
+    }
+
+    __atomic_fetch_add(&work->nodes, search.nodes, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+
+/* Creates a solver searching with the given number of threads. Returns
+ * NULL if its table cannot be allocated.
+ */
+struct Solver* solver_create(int threads) {
+    struct Solver* solver = malloc(sizeof(struct Solver));
+
+    solver->threads = threads < 1 ? 1 : threads;
+    solver->table = calloc(TABLE_SIZE, sizeof(struct Entry));
+    solver->games = 0;
+    if (!solver->table) {
+        free(solver);
+        return NULL;
+    }
+
+    return solver;
+}
+
+
+/* Solves a game which has been dealt but not started, giving the score
+ * each seat is sure of with every hand known: the score it reaches by its
+ * best play when every other seat plays against it. The first leads of
+ * every seat are searched as separate tasks, shared between the threads,
+ * each searching only for values improving on its seat's best so far.
+ * Returns the number of positions searched.
+ */
+long solver_solve(struct Solver* solver, const struct ModelState* state,
+        long budget, int lower[], int upper[]) {
+    struct Work work;
+    struct Search search;
+    struct Round start;
+    struct Move moves[MAX_MOVES];
+    pthread_t threads[solver->threads];
+    bool started[solver->threads];
+    uint64_t live = 0;
+    int count;
+    int diamonds;
+
+    if (!state->roundsLeft) {
+        for (int i = 0; i < state->numPlayers; i++) {
+            lower[i] = 0;
+            upper[i] = 0;
+        }
+        return 0;
+    }
+
+    memset(&start, 0, sizeof(start));
+    start.leader = state->leadPlayer;
+    start.roundsLeft = state->roundsLeft;
+    start.leadSuit = -1;
+    memset(&search, 0, sizeof(search));
+    search.numPlayers = state->numPlayers;
+    search.threshold = state->threshold;
+    memcpy(search.hands, state->hands, sizeof(search.hands));
+    for (int i = 0; i < state->numPlayers; i++) {
+        live |= state->hands[i];
+    }
+
+    count = order_moves(&search, &start, state->leadPlayer, live, NO_CARD,
+            moves);
+    diamonds = __builtin_popcountll(live & DIAMOND_CARDS);
+    work.solver = solver;
+    work.state = state;
+    work.numTasks = count * state->numPlayers;
+    work.tasks = malloc(sizeof(*work.tasks) * work.numTasks);
+    work.bounds = malloc(sizeof(*work.bounds) * work.numTasks);
+    work.next = 0;
+    work.budget = budget;
+    work.spent = 0;
+    work.nodes = 0;
+    for (int seat = 0; seat < state->numPlayers; seat++) {
+        work.best[seat] = seat == state->leadPlayer ? -SCORE_LIMIT :
+                SCORE_LIMIT;
+        for (int i = 0; i < count; i++) {
+            work.tasks[seat * count + i][0] = seat;
+            work.tasks[seat * count + i][1] = moves[i].card;
+            // a lead never searched is known only to score within the game
+            work.bounds[seat * count + i][0] = least_diamond_score(&search, 0,
+                    diamonds);
+            work.bounds[seat * count + i][1] = state->roundsLeft +
+                    most_diamond_score(&search, 0, diamonds);
+        }
+    }
+
+    for (int i = 1; i < solver->threads; i++) {
+        started[i] = !pthread_create(&threads[i], NULL, solve_tasks, &work);
+    }
+    solve_tasks(&work);
+    for (int i = 1; i < solver->threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    // the leader takes the best of its leads for itself and the worst for
+    // every other seat, so the bounds on the game are those of the leads
+    for (int seat = 0; seat < state->numPlayers; seat++) {
+        bool maximise = seat == state->leadPlayer;
+
+        lower[seat] = work.bounds[seat * count][0];
+        upper[seat] = work.bounds[seat * count][1];
+        for (int i = 1; i < count; i++) {
+            int* bounds = work.bounds[seat * count + i];
+
+            if (maximise ? bounds[0] > lower[seat] : bounds[0] < lower[seat]) {
+                lower[seat] = bounds[0];
+            }
+            if (maximise ? bounds[1] > upper[seat] : bounds[1] < upper[seat]) {
+                upper[seat] = bounds[1];
+            }
+        }
+    }
+
+    free(work.tasks);
+    free(work.bounds);
+    solver->games++;
+    return work.nodes;
+}
+
+
+/* Releases a solver and its table.
+ */
+void solver_free(struct Solver* solver) {
+    free(solver->table);
+    free(solver);
+}
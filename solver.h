@@ -0,0 +1,49 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+
+
+/* The number of bits of a transposition table index. Each entry takes 16
+ * bytes, so the table takes 64MB.
+ */
+#define SOLVER_TABLE_BITS 22
+
+
+/* A solver of dealt games with every hand known. The solver keeps its
+ * transposition table between games, since positions of different decks
+ * never share a key, though an earlier game's entries give way to the
+ * current one's.
+ */
+struct Solver;
+
+
+/* Creates a solver searching with the given number of threads. Returns
+ * NULL if its table cannot be allocated.
+ */
+struct Solver* solver_create(int threads);
+
+
+/* Solves a game which has been dealt but not started, bounding the score
+ * each seat is sure of with every hand known: the score it reaches by its
+ * best play when every other seat plays against it. The search stops once
+ * about budget positions have been searched, unless budget is 0, and each
+ * seat's score is then known to lie between lower and upper, which are
+ * equal for a seat solved in full. Returns the number of positions
+ * searched.
+ */
+long solver_solve(struct Solver* solver, const struct ModelState* state,
+        long budget, int lower[], int upper[]);
+
+
+/* Releases a solver and its table.
+ */
+void solver_free(struct Solver* solver);
+
+
+#endif
@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "players.h"
+#include "strategy.h"
+
+
+/* A player program with its strategy linked in, such as 2310alice. The
+ * strategy may refuse its configuration, such as bob's BOB_PARAMS.
+ */
+int main(int argc, char** argv) {
+    const struct Strategy* strategy = strategy_entry();
+
+    if (!strategy) {
+        handle_game_over(INVALID_STRATEGY);
+    }
+
+    return run_player(strategy, argc, argv);
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <math.h>
+
+#include "utilities.h"
+#include "stats.h"
+
+// The first line of saved statistics, with the version of the format
+#define STATS_HEADER "2310stats 1"
+
+// The bucket of a score of zero
+#define ZERO_BUCKET (STATS_LINEAR_LIMIT + STATS_LOG_BUCKETS)
+
+// The quantiles shown in the report
+static const double reportQuantiles[] = {0.05, 0.25, 0.5, 0.75, 0.95};
+#define NUM_QUANTILES 5
+
+
+/* Returns the bucket offset of a score's magnitude: the magnitude itself
+ * in the linear range, and its logarithmic bucket beyond.
+ */
+static int magnitude_bucket(long magnitude) {
+    int bucket;
+
+    if (magnitude < STATS_LINEAR_LIMIT) {
+        return magnitude;
+    }
+
+    bucket = log((double)magnitude / STATS_LINEAR_LIMIT) / log(STATS_GAMMA);
+    if (bucket >= STATS_LOG_BUCKETS) {
+        bucket = STATS_LOG_BUCKETS - 1;
+    }
+    return STATS_LINEAR_LIMIT + bucket;
+}
+
+
+/* Returns the bucket of a score.
+ */
+static int score_bucket(int score) {
+    return score < 0 ? ZERO_BUCKET - magnitude_bucket(-(long)score) :
+            ZERO_BUCKET + magnitude_bucket(score);
+}
+
+
+/* Returns the score a bucket stands for: the score itself in the linear
+ * range, and the middle of the bucket beyond.
+ */
+static double bucket_score(int bucket) {
+    int offset = abs(bucket - ZERO_BUCKET);
+    double magnitude = offset;
+
+    if (offset >= STATS_LINEAR_LIMIT) {
+        magnitude = STATS_LINEAR_LIMIT *
+                pow(STATS_GAMMA, offset - STATS_LINEAR_LIMIT) *
+                (1 + STATS_GAMMA) / 2;
+    }
+
+    return bucket < ZERO_BUCKET ? -magnitude : magnitude;
+}
+
+
+/* Starts empty statistics.
+ */
+void stats_init(struct Stats* stats) {
+    stats->cells = NULL;
+    stats->numCells = 0;
+}
+
+
+/* Returns a new empty cell for a program in a seat.
+ */
+static struct Cell* new_cell(const char* program, int seat) {
+    struct Cell* cell = calloc(1, sizeof(struct Cell));
+
+    cell->program = strdup(program);
+    cell->seat = seat;
+    return cell;
+}
+
+
+/* Returns the cell of a program in a seat, creating it if needed.
+ */
+struct Cell* stats_cell(struct Stats* stats, const char* program, int seat) {
+    for (int i = 0; i < stats->numCells; i++) {
+        if (stats->cells[i]->seat == seat &&
+                !strcmp(stats->cells[i]->program, program)) {
+            return stats->cells[i];
+        }
+    }
+
+    stats->cells = realloc(stats->cells, sizeof(struct Cell*) *
+            (stats->numCells + 1));
+    stats->cells[stats->numCells] = new_cell(program, seat);
+    return stats->cells[stats->numCells++];
+}
+
+
+/* Adds one score to a cell, with the share of the game it won. The mean
+ * and variance are updated with Welford's method.
+ */
+void stats_add(struct Cell* cell, int score, double win) {
+    double delta = score - cell->mean;
+
+    cell->count++;
+    cell->mean += delta / cell->count;
+    cell->m2 += delta * (score - cell->mean);
+    cell->wins += win;
+    cell->sketch.counts[score_bucket(score)]++;
+}
+
+
+/* Adds the final scores of one game. A game is won by the seats with the
+ * highest score, which share the win if tied.
+ */
+void stats_add_game(struct Stats* stats, char** programs, const int* scores,
+        int numSeats) {
+    int best = INT_MIN;
+    int winners = 0;
+
+    for (int i = 0; i < numSeats; i++) {
+        if (scores[i] > best) {
+            best = scores[i];
+            winners = 0;
+        }
+        winners += scores[i] == best;
+    }
+
+    for (int i = 0; i < numSeats; i++) {
+        stats_add(stats_cell(stats, programs[i], i), scores[i],
+                scores[i] == best ? 1.0 / winners : 0);
+    }
+}
+
+
+/* Merges the statistics of one cell into another, combining the means and
+ * variances as in Chan et al.'s parallel algorithm.
+ */
+void stats_merge_cell(struct Cell* into, const struct Cell* from) {
+    long count = into->count + from->count;
+    double delta = from->mean - into->mean;
+
+    if (!from->count) {
+        return;
+    }
+
+    into->m2 += from->m2 + delta * delta * into->count * from->count / count;
+    into->mean += delta * from->count / count;
+    into->count = count;
+    into->wins += from->wins;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        into->sketch.counts[i] += from->sketch.counts[i];
+    }
+}
+
+
+/* Returns the estimated score at quantile q, between 0 and 1, of a cell
+ * with at least one game.
+ */
+double stats_quantile(const struct Cell* cell, double q) {
+    long rank = (long)(q * (cell->count - 1));
+    long seen = 0;
+
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += cell->sketch.counts[i];
+        if (seen > rank) {
+            return bucket_score(i);
+        }
+    }
+
+    return bucket_score(STATS_BUCKETS - 1);
+}
+
+
+/* Parses a saved cell, cell program seat count mean m2 wins followed by
+ * bucket:count for each non-empty bucket, into a new cell. Returns NULL
+ * if the line is invalid.
+ */
+static struct Cell* read_cell(char* line) {
+    struct Cell cell;
+    struct Cell* copy;
+    char program[256];
+    int length;
+    char* position;
+
+    memset(&cell, 0, sizeof(cell));
+    if (sscanf(line, "cell %255s %d %ld %lf %lf %lf%n", program, &cell.seat,
+            &cell.count, &cell.mean, &cell.m2, &cell.wins, &length) != 6 ||
+            cell.seat < 0 || cell.count < 1) {
+        return NULL;
+    }
+
+    position = line + length;
+    while (*position) {
+        char* end;
+        long bucket = strtol(position, &end, 10);
+
+        if (end == position || *end != ':' || bucket < 0 ||
+                bucket >= STATS_BUCKETS) {
+            return NULL;
+        }
+        cell.sketch.counts[bucket] = strtol(end + 1, &position, 10);
+    }
+
+    copy = new_cell(program, cell.seat);
+    stats_merge_cell(copy, &cell);
+    return copy;
+}
+
+
+/* Merges statistics saved by stats_write into stats. Returns false if the
+ * input is not valid saved statistics.
+ */
+bool stats_read(struct Stats* stats, FILE* input) {
+    char* line = get_line(input);
+    bool valid = line && !strcmp(line, STATS_HEADER);
+
+    free(line);
+    while (valid && (line = get_line(input))) {
+        struct Cell* cell = read_cell(line);
+
+        if (cell) {
+            stats_merge_cell(stats_cell(stats, cell->program, cell->seat),
+                    cell);
+            free(cell->program);
+            free(cell);
+        } else {
+            valid = false;
+        }
+        free(line);
+    }
+
+    return valid;
+}
+
+
+/* Saves statistics so that they can be merged with other shards later.
+ * Only the non-empty buckets of each sketch are written.
+ */
+void stats_write(const struct Stats* stats, FILE* output) {
+    fprintf(output, "%s\n", STATS_HEADER);
+
+    for (int i = 0; i < stats->numCells; i++) {
+        const struct Cell* cell = stats->cells[i];
+
+        fprintf(output, "cell %s %d %ld %.17g %.17g %.17g", cell->program,
+                cell->seat, cell->count, cell->mean, cell->m2, cell->wins);
+        for (int j = 0; j < STATS_BUCKETS; j++) {
+            if (cell->sketch.counts[j]) {
+                fprintf(output, " %d:%ld", j, cell->sketch.counts[j]);
+            }
+        }
+        fprintf(output, "\n");
+    }
+    fflush(output);
+}
+
+
+/* Outputs one row of the report.
+ */
+static void report_cell(const struct Cell* cell, FILE* output) {
+    char seat[12];
+
+    if (cell->seat < 0) {
+        strcpy(seat, "all");
+    } else {
+        sprintf(seat, "%d", cell->seat);
+    }
+
+    fprintf(output, "%-20s %4s %10ld %10.3f %10.3f %7.1f%%", cell->program,
+            seat, cell->count, cell->mean, cell->count > 1 ?
+            sqrt(cell->m2 / (cell->count - 1)) : 0.0,
+            100 * cell->wins / cell->count);
+    for (int i = 0; i < NUM_QUANTILES; i++) {
+        fprintf(output, " %7.1f", stats_quantile(cell, reportQuantiles[i]));
+    }
+    fprintf(output, "\n");
+}
+
+
+/* Outputs a table of each program's statistics in each seat, and over
+ * all seats, in the order the programs were first seen.
+ */
+void stats_report(const struct Stats* stats, FILE* output) {
+    fprintf(output, "%-20s %4s %10s %10s %10s %8s", "program", "seat",
+            "games", "mean", "stddev", "wins");
+    for (int i = 0; i < NUM_QUANTILES; i++) {
+        fprintf(output, "     p%02d", (int)(100 * reportQuantiles[i]));
+    }
+    fprintf(output, "\n");
+
+    for (int i = 0; i < stats->numCells; i++) {
+        struct Cell* total;
+        bool reported = false;
+        int maxSeat = 0;
+
+        for (int j = 0; j < i && !reported; j++) {
+            reported = !strcmp(stats->cells[j]->program,
+                    stats->cells[i]->program);
+        }
+        if (reported) {
+            continue;
+        }
+
+        total = new_cell(stats->cells[i]->program, -1);
+        for (int j = i; j < stats->numCells; j++) {
+            if (!strcmp(stats->cells[j]->program, total->program) &&
+                    stats->cells[j]->seat > maxSeat) {
+                maxSeat = stats->cells[j]->seat;
+            }
+        }
+
+        for (int seat = 0; seat <= maxSeat; seat++) {
+            for (int j = i; j < stats->numCells; j++) {
+                if (stats->cells[j]->seat == seat &&
+                        !strcmp(stats->cells[j]->program, total->program)) {
+                    report_cell(stats->cells[j], output);
+                    stats_merge_cell(total, stats->cells[j]);
+                }
+            }
+        }
+
+        report_cell(total, output);
+        free(total->program);
+        free(total);
+    }
+    fflush(output);
+}
+
+
+/* Releases the memory used by statistics.
+ */
+void stats_free(struct Stats* stats) {
+    for (int i = 0; i < stats->numCells; i++) {
+        free(stats->cells[i]->program);
+        free(stats->cells[i]);
+    }
+    free(stats->cells);
+    stats_init(stats);
+}
@@ -0,0 +1,123 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/* Scores of smaller magnitude than this are counted exactly by the
+ * sketches.
+ */
+#define STATS_LINEAR_LIMIT 256
+
+
+/* The number of logarithmic buckets for scores of each sign beyond the
+ * linear range. Each covers a factor of STATS_GAMMA, so quantiles of large
+ * scores are within 1% of the true value.
+ */
+#define STATS_LOG_BUCKETS 1024
+#define STATS_GAMMA 1.02
+
+
+/* The number of buckets in a sketch, for both signs.
+ */
+#define STATS_BUCKETS (2 * (STATS_LINEAR_LIMIT + STATS_LOG_BUCKETS))
+
+
+/* A fixed size histogram of scores from which quantiles are estimated.
+ * Sketches of different shards are merged by adding their buckets.
+ */
+struct Sketch {
+    // The number of scores in each bucket, lowest scores first
+    long counts[STATS_BUCKETS];
+};
+
+
+/* The running statistics of one program in one seat.
+ */
+struct Cell {
+    // The name of the program
+    char* program;
+    // The seat, or -1 for the program over all seats
+    int seat;
+    // The number of games played
+    long count;
+    // The mean score
+    double mean;
+    // The sum of squared differences from the mean
+    double m2;
+    // The games won, shared between ties
+    double wins;
+    // The distribution of scores
+    struct Sketch sketch;
+};
+
+
+/* The statistics of every program and seat seen so far. Memory grows with
+ * the number of programs and seats, not with the number of games.
+ */
+struct Stats {
+    // The statistics of each program and seat
+    struct Cell** cells;
+    // The number of cells
+    int numCells;
+};
+
+
+/* Starts empty statistics.
+ */
+void stats_init(struct Stats* stats);
+
+
+/* Returns the cell of a program in a seat, creating it if needed.
+ */
+struct Cell* stats_cell(struct Stats* stats, const char* program, int seat);
+
+
+/* Adds one score to a cell, with the share of the game it won.
+ */
+void stats_add(struct Cell* cell, int score, double win);
+
+
+/* Adds the final scores of one game. A game is won by the seats with the
+ * highest score, which share the win if tied.
+ */
+void stats_add_game(struct Stats* stats, char** programs, const int* scores,
+        int numSeats);
+
+
+/* Merges the statistics of one cell into another.
+ */
+void stats_merge_cell(struct Cell* into, const struct Cell* from);
+
+
+/* Returns the estimated score at quantile q, between 0 and 1, of a cell
+ * with at least one game.
+ */
+double stats_quantile(const struct Cell* cell, double q);
+
+
+/* Merges statistics saved by stats_write into stats. Returns false if the
+ * input is not valid saved statistics.
+ */
+bool stats_read(struct Stats* stats, FILE* input);
+
+
+/* Saves statistics so that they can be merged with other shards later.
+ */
+void stats_write(const struct Stats* stats, FILE* output);
+
+
+/* Outputs a table of each program's statistics in each seat, and over
+ * all seats.
+ */
+void stats_report(const struct Stats* stats, FILE* output);
+
+
+/* Releases the memory used by statistics.
+ */
+void stats_free(struct Stats* stats);
+
+
+#endif
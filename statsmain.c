@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "utilities.h"
+#include "stats.h"
+#include "columns.h"
+
+// The most seats in one result line
+#define MAX_SEATS RULES_MAX_SEATS
+
+// The name of a seat's program when neither the line nor the command line
+// names it
+#define UNNAMED "-"
+
+
+/* Defines all possible exit statuses of the statistics program.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INPUT_ERROR = 2,
+    STATE_ERROR = 3,
+};
+
+
+/* Parses one result line into the program and score of each seat. Seat
+ * scores are written seat:score, as the hub outputs them, or
+ * program=seat:score to name the seat's program; other fields such as the
+ * multiplexing hub's deck names are skipped. Seats not named on the line
+ * take their name from names. Returns the number of seats, 0 if the line
+ * has no scores, or -1 if the seats are not 0, 1, 2 and so on.
+ */
+int parse_result(char* line, char** names, int numNames,
+        char* programs[], int scores[]) {
+    int numSeats = 0;
+    char* field = line;
+
+    while (*field) {
+        char* end = field + strcspn(field, " \t");
+        char* equals = memchr(field, '=', end - field);
+        char* start = equals ? equals + 1 : field;
+        char* colon;
+        long seat = strtol(start, &colon, 10);
+        bool last = !*end;
+
+        *end = '\0';
+        if (colon != start && *colon == ':') {
+            char* number = colon + 1;
+            char* rest;
+            long score = strtol(number, &rest, 10);
+
+            if (rest == number || *rest || seat != numSeats ||
+                    numSeats == MAX_SEATS) {
+                return -1;
+            }
+
+            if (equals) {
+                *equals = '\0';
+                programs[numSeats] = field;
+            } else {
+                programs[numSeats] = seat < numNames ? names[seat] : UNNAMED;
+            }
+            scores[numSeats++] = score;
+        }
+
+        field = last ? end : end + 1;
+    }
+
+    return numSeats;
+}
+
+
+/* Adds every result line of a stream to the statistics. Returns the number
+ * of lines which were not results.
+ */
+long read_results(struct Stats* stats, FILE* input, char** names,
+        int numNames) {
+    char* programs[MAX_SEATS];
+    int scores[MAX_SEATS];
+    long skipped = 0;
+    char* line;
+
+    while ((line = get_line(input))) {
+        int numSeats = parse_result(line, names, numNames, programs,
+                scores);
+
+        if (numSeats > 0) {
+            stats_add_game(stats, programs, scores, numSeats);
+        } else {
+            skipped++;
+        }
+        free(line);
+    }
+
+    return skipped;
+}
+
+
+/* Adds every game of a columnar results file to the statistics, scanning
+ * only the score and program columns. Returns false if the file is not
+ * valid columnar results.
+ */
+bool read_columns(struct Stats* stats, const char* path) {
+    struct ColumnReader reader;
+    struct ColumnBlock block;
+    char* programs[MAX_SEATS];
+    int scores[MAX_SEATS];
+    int numSeats;
+
+    if (!columns_open(&reader, path)) {
+        return false;
+    }
+
+    numSeats = reader.numSeats;
+    if (numSeats > MAX_SEATS) {
+        columns_release(&reader);
+        return false;
+    }
+
+    while (columns_next(&reader, &block)) {
+        if (block.rows % numSeats) {
+            break;
+        }
+
+        for (int row = 0; row < block.rows; row += numSeats) {
+            for (int p = 0; p < numSeats; p++) {
+                int program = block.program[row + p];
+
+                programs[p] = program < reader.numNames ?
+                        (char*)reader.names[program] : UNNAMED;
+                scores[p] = block.score[row + p];
+            }
+            stats_add_game(stats, programs, scores, numSeats);
+        }
+    }
+
+    if (!columns_done(&reader)) {
+        columns_release(&reader);
+        return false;
+    }
+
+    columns_release(&reader);
+    return true;
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_exit(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310stats [-r results] [-c results] "
+                    "[-m state] [-o state] {program}\n");
+            break;
+        case INPUT_ERROR:
+            fprintf(stderr, "Cannot read input\n");
+            break;
+        case STATE_ERROR:
+            fprintf(stderr, "Invalid state file\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+/* The statistics program, 2310stats, which aggregates final score lines
+ * into each program's mean, standard deviation, win rate and quantiles in
+ * each seat, in one pass and in memory independent of the number of
+ * games. Results are read from each -r file and each -c file of columnar
+ * results, or stdin if none of -r, -c and -m is given, and the programs
+ * named on the command line are the programs of seats 0, 1 and so on of
+ * text results. Shards saved with -o can be merged
+ * later with -m.
+ */
+int main(int argc, char** argv) {
+    struct Stats stats;
+    char** results = NULL;
+    int numResults = 0;
+    char** states = NULL;
+    int numStates = 0;
+    char** columns = NULL;
+    int numColumns = 0;
+    const char* output = NULL;
+    long skipped = 0;
+    int option;
+    FILE* file;
+
+    while ((option = getopt(argc, argv, "r:c:m:o:")) != -1) {
+        switch (option) {
+            case 'r':
+                results = realloc(results, sizeof(char*) * (numResults + 1));
+                results[numResults++] = optarg;
+                break;
+            case 'c':
+                columns = realloc(columns, sizeof(char*) * (numColumns + 1));
+                columns[numColumns++] = optarg;
+                break;
+            case 'm':
+                states = realloc(states, sizeof(char*) * (numStates + 1));
+                states[numStates++] = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                handle_exit(ARGUMENT_LENGTH);
+        }
+    }
+
+    stats_init(&stats);
+    for (int i = 0; i < numStates; i++) {
+        file = fopen(states[i], "r");
+        if (!file) {
+            handle_exit(INPUT_ERROR);
+        }
+        if (!stats_read(&stats, file)) {
+            handle_exit(STATE_ERROR);
+        }
+        fclose(file);
+    }
+
+    for (int i = 0; i < numResults; i++) {
+        file = fopen(results[i], "r");
+        if (!file) {
+            handle_exit(INPUT_ERROR);
+        }
+        skipped += read_results(&stats, file, &argv[optind], argc - optind);
+        fclose(file);
+    }
+
+    for (int i = 0; i < numColumns; i++) {
+        if (!read_columns(&stats, columns[i])) {
+            handle_exit(INPUT_ERROR);
+        }
+    }
+
+    if (!numResults && !numStates && !numColumns) {
+        skipped += read_results(&stats, stdin, &argv[optind], argc - optind);
+    }
+
+    if (skipped) {
+        fprintf(stderr, "Skipped %ld lines without results\n", skipped);
+    }
+
+    if (output) {
+        file = fopen(output, "w");
+        if (!file) {
+            handle_exit(INPUT_ERROR);
+        }
+        stats_write(&stats, file);
+        fclose(file);
+    } else {
+        stats_report(&stats, stdout);
+    }
+
+    stats_free(&stats);
+    free(results);
+    free(states);
+    free(columns);
+    return NORMAL_EXIT;
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <dlfcn.h>
+
+#include "strategy.h"
+
+
+/* The type of a plugin's exported entry point.
+ */
+typedef const struct Strategy* (*StrategyEntry)(void);
+
+
+/* Loads the strategy plugin at the given path and checks it was built
+ * against this version of the interface. Returns NULL on failure, and
+ * if error is not NULL sets it to a static description of the problem.
+ */
+const struct Strategy* load_strategy(const char* path, const char** error) {
+    const char* message = NULL;
+    const struct Strategy* strategy = NULL;
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+    if (!handle) {
+        message = "Unable to open plugin";
+    } else {
+        StrategyEntry entry;
+
+        // dlsym returns an object pointer, which ISO C cannot convert to
+        // a function pointer directly
+        *(void**)&entry = dlsym(handle, STRATEGY_ENTRY_SYMBOL);
+        strategy = entry ? entry() : NULL;
+
+        if (!entry) {
+            message = "Plugin has no strategy";
+        } else if (!strategy) {
+            message = "Plugin strategy refused its configuration";
+        } else if (strategy->abiVersion != STRATEGY_ABI_VERSION) {
+            message = "Plugin built for another strategy version";
+        } else if (!strategy->lead || !strategy->follow) {
+            message = "Plugin strategy is incomplete";
+        }
+    }
+
+    if (message) {
+        if (handle) {
+            dlclose(handle);
+        }
+        if (error) {
+            *error = message;
+        }
+        return NULL;
+    }
+
+    return strategy;
+}
@@ -0,0 +1,87 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "players.h"
+
+
+/* The version of the strategy plugin interface. This is increased whenever
+ * the layout of struct Strategy or struct Game, or the meaning of one of
+ * the hooks changes, so that a host refuses plugins built against a
+ * different interface.
+ */
+#define STRATEGY_ABI_VERSION 9
+
+
+/* The symbol every strategy plugin exports, a function returning
+ * the plugin's struct Strategy.
+ */
+#define STRATEGY_ENTRY_SYMBOL "strategy_entry"
+
+
+/* The hooks a strategy provides to the player protocol loop. The loop
+ * handles all communication with the hub and keeps struct Game up to date,
+ * and only asks the strategy which card to play. Strategies must not write
+ * to stdout, and must only return cards held in the player's hand.
+ */
+struct Strategy {
+    // Must be STRATEGY_ABI_VERSION
+    int abiVersion;
+    // The name of the strategy, used in error messages and results
+    const char* name;
+    // The strategy's parameters as text, which its decisions are cached
+    // under together with its name, or NULL if it has none
+    const char* params;
+    // The version of the strategy's decisions, also part of their cache
+    // key. It is increased whenever the strategy would choose a different
+    // card in some position, so that cached decisions are never replayed
+    // by a strategy that has changed
+    int version;
+    // Creates the strategy's state for a game, called once the arguments
+    // are valid. May be NULL, in which case the state is NULL
+    void* (*init)(const struct Game* game);
+    // Chooses the card to play when this player leads the round
+    struct Card (*lead)(void* state, const struct Game* game);
+    // True if lead only depends on the hand, the diamonds won in earlier
+    // rounds and the game's arguments, so that its decisions can be cached
+    bool pureLead;
+    // Chooses the card to play when another player led the round
+    struct Card (*follow)(void* state, const struct Game* game);
+    // True if follow only depends on the hand, the lead suit, whether a
+    // diamond has been played in the round and the diamonds won in earlier
+    // rounds. The player then computes its answer to every lead as soon as
+    // the round starts, while the other players move, and its decisions
+    // can be cached
+    bool pureFollow;
+    // Called for every card played by any player, including this one.
+    // May be NULL
+    void (*observe)(void* state, const struct Game* game, int player,
+            struct Card card);
+    // Prepares the state for a new game with the same arguments, for players
+    // serving many games. May be NULL, in which case the state is released
+    // and created again
+    void (*reset)(void* state, const struct Game* game);
+    // Releases the state created by init. May be NULL
+    void (*release)(void* state);
+};
+
+
+/* The entry point of a strategy. Each strategy source file defines this
+ * function, whether it is linked into a player program or built as a
+ * plugin. It returns NULL if the strategy's configuration, such as an
+ * environment variable it reads, is not valid.
+ */
+const struct Strategy* strategy_entry(void);
+
+
+/* Loads the strategy plugin at the given path and checks it was built
+ * against this version of the interface. Returns NULL on failure, and
+ * if error is not NULL sets it to a static description of the problem.
+ */
+const struct Strategy* load_strategy(const char* path, const char** error);
+
+
+#endif
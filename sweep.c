@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sweep.h"
+
+
+/* Returns the highest or lowest card of the first suit of an order held
+ * in a hand, as find_highest and find_lowest do, or -1 if it is empty.
+ */
+static int pick_in_order(uint64_t hand, const char* order, bool high) {
+    for (int i = 0; i < NUM_SUITS; i++) {
+        int suit = model_suit(order[i]);
+        unsigned ranks = model_suit_ranks(hand, suit);
+
+        if (ranks) {
+            return suit * MODEL_SUIT_BITS + (high ?
+                    31 - __builtin_clz(ranks) : __builtin_ctz(ranks));
+        }
+    }
+
+    return -1;
+}
+
+
+/* Returns the highest or lowest card of the lead suit held in a hand, as
+ * find_highest_suit and find_lowest_suit do, or -1 if there is none.
+ */
+static int pick_lead_suit(const struct ModelState* state, uint64_t hand,
+        bool high) {
+    unsigned ranks = model_suit_ranks(hand, state->leadSuit);
+
+    if (!ranks) {
+        return -1;
+    }
+
+    return state->leadSuit * MODEL_SUIT_BITS + (high ?
+            31 - __builtin_clz(ranks) : __builtin_ctz(ranks));
+}
+
+
+/* Returns the card a strategy plays for the current player, bob playing
+ * with the sweep's parameters. near is bob's check_diamond_quantity, the
+ * only part of either strategy depending on the threshold, and is ignored
+ * otherwise.
+ */
+static int decide(const struct Sweep* sweep, const struct ModelState* state,
+        enum BatchStrategy strategy, bool near) {
+    uint64_t hand = state->hands[state->currentPlayer];
+    bool lead = state->numCardsPlayed == 0;
+    int card;
+
+    switch (strategy) {
+        case BATCH_ALICE:
+            if (lead) {
+                return pick_in_order(hand, "SCDH", true);
+            }
+            card = pick_lead_suit(state, hand, false);
+            return card >= 0 ? card : pick_in_order(hand, "DHSC", true);
+        case BATCH_BOB:
+            if (lead) {
+                return pick_in_order(hand, sweep->bob.leadOrder, false);
+            }
+            card = pick_lead_suit(state, hand, near);
+            if (card >= 0) {
+                return card;
+            }
+            return near ? pick_in_order(hand, sweep->bob.winOrder, false) :
+                    pick_in_order(hand, sweep->bob.duckOrder, true);
+    }
+
+    return -1;
+}
+
+
+/* Returns the thresholds of a branch for which bob's check passes at the
+ * current move: a diamond has been played in the round and some player
+ * has won at least the threshold less bob's margin of diamonds.
+ */
+static uint64_t near_thresholds(const struct Sweep* sweep,
+        const struct SweepBranch* branch) {
+    const struct ModelState* state = &branch->state;
+    uint64_t near = 0;
+    int most = 0;
+
+    if (state->numCardsPlayed == 0 || state->roundDiamonds <= 0) {
+        return 0;
+    }
+
+    for (int p = 0; p < state->numPlayers; p++) {
+        if (state->diamonds[p] > most) {
+            most = state->diamonds[p];
+        }
+    }
+
+    for (int i = 0; i < sweep->numThresholds; i++) {
+        if (most >= sweep->thresholds[i] - sweep->bob.margin) {
+            near |= (uint64_t)1 << i;
+        }
+    }
+
+    return near & branch->thresholds;
+}
+
+
+/* Adds a copy of a branch to the pending branches of a sweep.
+ */
+static void push_branch(struct Sweep* sweep,
+        const struct SweepBranch* branch) {
+    if (sweep->numPending == sweep->pendingSize) {
+        sweep->pendingSize = sweep->pendingSize ? sweep->pendingSize * 2 : 16;
+        sweep->pending = realloc(sweep->pending,
+                sizeof(struct SweepBranch) * sweep->pendingSize);
+    }
+
+    sweep->pending[sweep->numPending++] = *branch;
+}
+
+
+/* Returns the card a branch plays next, forking it first where its
+ * thresholds or the sweep's what-if move call for different cards. The
+ * forked branches are left pending, and the branch keeps the rest.
+ */
+static int next_card(struct Sweep* sweep, struct SweepBranch* branch) {
+    const struct ModelState* state = &branch->state;
+    enum BatchStrategy strategy = sweep->seats[state->currentPlayer];
+    uint64_t near;
+    int card;
+
+    if (branch->movesPlayed == sweep->whatIf) {
+        if (branch->alternative == SWEEP_NO_CARD) {
+            uint64_t legal = model_legal_moves(state);
+
+            branch->alternative = model_lowest_card(legal);
+            for (legal &= legal - 1; legal; legal &= legal - 1) {
+                struct SweepBranch fork = *branch;
+
+                fork.alternative = model_lowest_card(legal);
+                push_branch(sweep, &fork);
+                sweep->forks++;
+            }
+        }
+        return branch->alternative;
+    }
+
+    if (strategy != BATCH_BOB) {
+        return decide(sweep, state, strategy, false);
+    }
+
+    near = near_thresholds(sweep, branch);
+    if (near == branch->thresholds) {
+        return decide(sweep, state, strategy, true);
+    }
+
+    card = decide(sweep, state, strategy, false);
+    if (near && decide(sweep, state, strategy, true) != card) {
+        struct SweepBranch fork = *branch;
+
+        // the near thresholds go their own way from here
+        fork.thresholds = near;
+        branch->thresholds &= ~near;
+        push_branch(sweep, &fork);
+        sweep->forks++;
+    }
+
+    return card;
+}
+
+
+/* Starts a sweep of the given thresholds, none repeated, with the
+ * strategies of each seat, bob playing with the given parameters or the
+ * defaults if they are NULL. If whatIf is not negative, the player on turn
+ * at that move tries every card it may play there instead of its
+ * strategy's choice.
+ */
+void sweep_init(struct Sweep* sweep, int numPlayers,
+        const enum BatchStrategy* seats, const struct BobParams* bob,
+        const int* thresholds, int numThresholds, int whatIf) {
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->numPlayers = numPlayers;
+    memcpy(sweep->seats, seats, sizeof(enum BatchStrategy) * numPlayers);
+    if (bob) {
+        sweep->bob = *bob;
+    } else {
+        bob_default_params(&sweep->bob);
+    }
+    memcpy(sweep->thresholds, thresholds, sizeof(int) * numThresholds);
+    sweep->numThresholds = numThresholds;
+    sweep->whatIf = whatIf;
+}
+
+
+/* Plays the deal of a model state, which must not have started, for
+ * every threshold and alternative of the sweep, writing one result for
+ * each to results, which has space for SWEEP_MAX_RESULTS. Returns the
+ * number of results. Branches are played depth first, so that at most one
+ * branch per threshold and alternative is pending at a time.
+ */
+int sweep_play(struct Sweep* sweep, const struct ModelState* deal,
+        struct SweepResult* results) {
+    struct SweepBranch branch = {
+        .state = *deal,
+        .thresholds = ~(uint64_t)0 >>
+                (SWEEP_MAX_THRESHOLDS - sweep->numThresholds),
+        .alternative = SWEEP_NO_CARD,
+    };
+    int numResults = 0;
+
+    push_branch(sweep, &branch);
+    while (sweep->numPending) {
+        branch = sweep->pending[--sweep->numPending];
+
+        while (!model_is_over(&branch.state)) {
+            model_play(&branch.state, next_card(sweep, &branch));
+            branch.movesPlayed++;
+            sweep->moves++;
+        }
+
+        for (uint64_t left = branch.thresholds; left; left &= left - 1) {
+            struct SweepResult* result = &results[numResults++];
+
+            branch.state.threshold = sweep->thresholds[__builtin_ctzll(left)];
+            result->threshold = branch.state.threshold;
+            result->alternative = branch.alternative;
+            for (int p = 0; p < sweep->numPlayers; p++) {
+                result->scores[p] = model_score(&branch.state, p);
+            }
+        }
+    }
+
+    return numResults;
+}
+
+
+/* Releases the pending branches of a sweep.
+ */
+void sweep_free(struct Sweep* sweep) {
+    free(sweep->pending);
+    sweep->pending = NULL;
+    sweep->numPending = 0;
+    sweep->pendingSize = 0;
+}
@@ -0,0 +1,115 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+#include "batch.h"
+
+
+/* The most thresholds one sweep plays, one bit each in a branch's set.
+ */
+#define SWEEP_MAX_THRESHOLDS 64
+
+
+/* The most results one deal of a sweep gives: one per threshold and
+ * card of the rules.
+ */
+#define SWEEP_MAX_RESULTS (SWEEP_MAX_THRESHOLDS * NUM_SUITS * NUM_RANKS)
+
+
+/* No card, for a result without an alternative play.
+ */
+#define SWEEP_NO_CARD (-1)
+
+
+/* One game of a sweep played to the end.
+ */
+struct SweepResult {
+    // The threshold the game was played and scored with
+    int threshold;
+    // The card played at the sweep's what-if move, or SWEEP_NO_CARD
+    int alternative;
+    // The final score of each player
+    int scores[MODEL_MAX_PLAYERS];
+};
+
+
+/* A game part way through, shared by every threshold in its set: until
+ * the strategies decide differently for two of them, the thresholds play
+ * the same cards, so one state stands for all of them.
+ */
+struct SweepBranch {
+    // The state of the game, which is copied when the branch forks
+    struct ModelState state;
+    // The thresholds sharing the branch, as bits of the sweep's list
+    uint64_t thresholds;
+    // The card played at the what-if move, or SWEEP_NO_CARD
+    int alternative;
+    // The number of cards played since the start of the game
+    int movesPlayed;
+};
+
+
+/* Plays one deal with the same strategies over a list of thresholds and,
+ * optionally, every legal card at one move, sharing each game's moves
+ * with every other game for as long as they agree. A branch forks only at
+ * a decision that differs between its thresholds, so a sweep costs the
+ * common prefix once plus each divergent suffix.
+ */
+struct Sweep {
+    // The number of players in every game
+    int numPlayers;
+    // The strategy of each seat
+    enum BatchStrategy seats[MODEL_MAX_PLAYERS];
+    // The parameters of every seat playing bob
+    struct BobParams bob;
+    // The thresholds of the sweep
+    int thresholds[SWEEP_MAX_THRESHOLDS];
+    // The number of thresholds
+    int numThresholds;
+    // The move, counted in cards from the start of the game, at which
+    // every legal card is tried, or -1 for none
+    int whatIf;
+    // The branches waiting to be played, most recently forked last
+    struct SweepBranch* pending;
+    // The number of pending branches
+    int numPending;
+    // The space allocated for pending branches
+    int pendingSize;
+    // The number of cards played over every branch so far
+    long moves;
+    // The number of times a branch has forked so far
+    long forks;
+};
+
+
+/* Starts a sweep of the given thresholds, none repeated, with the
+ * strategies of each seat, bob playing with the given parameters or the
+ * defaults if they are NULL. If whatIf is not negative, the player on turn
+ * at that move tries every card it may play there instead of its
+ * strategy's choice.
+ */
+void sweep_init(struct Sweep* sweep, int numPlayers,
+        const enum BatchStrategy* seats, const struct BobParams* bob,
+        const int* thresholds, int numThresholds, int whatIf);
+
+
+/* Plays the deal of a model state, which must not have started, for
+ * every threshold and alternative of the sweep, writing one result for
+ * each to results, which has space for SWEEP_MAX_RESULTS. Returns the
+ * number of results.
+ */
+int sweep_play(struct Sweep* sweep, const struct ModelState* deal,
+        struct SweepResult* results);
+
+
+/* Releases the pending branches of a sweep.
+ */
+void sweep_free(struct Sweep* sweep);
+
+
+#endif
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "utilities.h"
+#include "model.h"
+#include "deck.h"
+#include "batch.h"
+#include "sweep.h"
+
+
+/* Defines all possible exit statuses of the sweep, with the same values
+ * as the hub's.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INVALID_THRESHOLD = 2,
+    DECK_ERROR = 3,
+    SMALL_DECK = 4,
+    PLAYER_ERROR = 5,
+};
+
+
+/* The arguments of the sweep.
+ */
+struct SweepArgs {
+    // The deck file to play
+    char* deck;
+    // The thresholds to play it with
+    int thresholds[SWEEP_MAX_THRESHOLDS];
+    // The number of thresholds
+    int numThresholds;
+    // The move at which every legal card is tried, or -1 for none
+    int whatIf;
+    // The number of seats
+    int numSeats;
+    // The strategy of each seat
+    enum BatchStrategy seats[MODEL_MAX_PLAYERS];
+    // The parameters of the seats playing bob, from BOB_PARAMS
+    struct BobParams bob;
+};
+
+
+/* Parses a list of thresholds such as 2-6,9 into args, each at least 2
+ * and none repeated. Returns 0 on success, and INVALID_THRESHOLD
+ * otherwise.
+ */
+enum ExitMessage parse_thresholds(struct SweepArgs* args, const char* list) {
+    const char* next = list;
+
+    args->numThresholds = 0;
+    do {
+        char* end;
+        long first = strtol(next, &end, 10);
+        long last = first;
+
+        if (end == next) {
+            return INVALID_THRESHOLD;
+        }
+        if (*end == '-') {
+            next = end + 1;
+            last = strtol(next, &end, 10);
+            if (end == next) {
+                return INVALID_THRESHOLD;
+            }
+        }
+        if ((*end && *end != ',') || first < 2 || last < first) {
+            return INVALID_THRESHOLD;
+        }
+
+        for (long threshold = first; threshold <= last; threshold++) {
+            for (int i = 0; i < args->numThresholds; i++) {
+                if (args->thresholds[i] == threshold) {
+                    return INVALID_THRESHOLD;
+                }
+            }
+            if (args->numThresholds == SWEEP_MAX_THRESHOLDS) {
+                return INVALID_THRESHOLD;
+            }
+            args->thresholds[args->numThresholds++] = threshold;
+        }
+        next = end + 1;
+    } while (next[-1]);
+
+    return NORMAL_EXIT;
+}
+
+
+/* Checks the arguments and fills args from them. Returns 0 on success,
+ * and the relevant exit status otherwise.
+ */
+enum ExitMessage check_valid_args(struct SweepArgs* args, int argc,
+        char** argv) {
+    int option;
+    char* end;
+
+    args->whatIf = -1;
+    while ((option = getopt(argc, argv, "m:")) != -1) {
+        switch (option) {
+            case 'm':
+                args->whatIf = strtol(optarg, &end, 10);
+                if (end == optarg || *end || args->whatIf < 0) {
+                    return ARGUMENT_LENGTH;
+                }
+                break;
+            default:
+                return ARGUMENT_LENGTH;
+        }
+    }
+
+    if (argc - optind < 4) {
+        return ARGUMENT_LENGTH;
+    }
+
+    args->deck = argv[optind];
+    args->numSeats = argc - optind - 2;
+    if (args->numSeats > MODEL_MAX_PLAYERS) {
+        return ARGUMENT_LENGTH;
+    }
+
+    if (parse_thresholds(args, argv[optind + 1])) {
+        return INVALID_THRESHOLD;
+    }
+
+    for (int i = 0; i < args->numSeats; i++) {
+        int strategy = batch_strategy(argv[optind + 2 + i]);
+
+        if (strategy < 0) {
+            return PLAYER_ERROR;
+        }
+        args->seats[i] = strategy;
+    }
+
+    bob_default_params(&args->bob);
+    if (getenv(BOB_PARAMS_ENV) &&
+            !bob_parse_params(getenv(BOB_PARAMS_ENV), &args->bob)) {
+        return PLAYER_ERROR;
+    }
+
+    return NORMAL_EXIT;
+}
+
+
+/* Orders results by the card played at the what-if move, then by
+ * threshold.
+ */
+int compare_results(const void* first, const void* second) {
+    const struct SweepResult* a = first;
+    const struct SweepResult* b = second;
+
+    if (a->alternative != b->alternative) {
+        return a->alternative - b->alternative;
+    }
+
+    return a->threshold - b->threshold;
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_game_over(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310sweep [-m move] deck thresholds "
+                    "player0 player1 {player2}\n");
+            break;
+        case INVALID_THRESHOLD:
+            fprintf(stderr, "Invalid threshold\n");
+            break;
+        case DECK_ERROR:
+            fprintf(stderr, "Deck error\n");
+            break;
+        case SMALL_DECK:
+            fprintf(stderr, "Not enough cards\n");
+            break;
+        case PLAYER_ERROR:
+            fprintf(stderr, "Player error\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+/* The threshold sweep, 2310sweep, which plays a deck in-process with the
+ * strategies alice and bob, bob with the parameters in BOB_PARAMS if it is
+ * set, for every threshold in a list such as 2-6,9, and with -m, for every
+ * card the player on turn at the given move (0 for the first lead, and
+ * less than the number of cards dealt) may play there. Games share their
+ * moves until the strategies first decide differently, and then fork. One
+ * line is output per game, with the deck, the threshold, the card tried if
+ * any and the scores in the hub's format, and the moves played against the
+ * moves of separate games are written to stderr.
+ */
+int main(int argc, char** argv) {
+    static struct SweepResult results[SWEEP_MAX_RESULTS];
+    struct SweepArgs args;
+    struct ModelState deal;
+    struct Sweep sweep;
+    enum ExitMessage errorMessage = check_valid_args(&args, argc, argv);
+    int numResults;
+
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    // every threshold is set by the sweep as the game is scored
+    errorMessage = (enum ExitMessage)deck_load(args.deck, args.numSeats, 0,
+            &deal, NULL);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    // the what-if move must be one of the game's moves, counted from 0
+    if (args.whatIf >= deal.roundsLeft * args.numSeats) {
+        handle_game_over(ARGUMENT_LENGTH);
+    }
+
+    sweep_init(&sweep, args.numSeats, args.seats, &args.bob,
+            args.thresholds, args.numThresholds, args.whatIf);
+    numResults = sweep_play(&sweep, &deal, results);
+    qsort(results, numResults, sizeof(struct SweepResult), compare_results);
+
+    for (int i = 0; i < numResults; i++) {
+        printf("%s threshold=%d", args.deck, results[i].threshold);
+        if (results[i].alternative != SWEEP_NO_CARD) {
+            printf(" card=%c%c", model_card_suit(results[i].alternative),
+                    encode_rank(model_card_rank(results[i].alternative)));
+        }
+        for (int p = 0; p < args.numSeats; p++) {
+            printf(" %d:%d", p, results[i].scores[p]);
+        }
+        printf("\n");
+    }
+
+    fprintf(stderr, "%s: %ld moves in %ld forks, %ld as separate games\n",
+            args.deck, sweep.moves, sweep.forks,
+            (long)numResults * args.numSeats * deal.roundsLeft);
+    sweep_free(&sweep);
+    return NORMAL_EXIT;
+}
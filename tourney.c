@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "rules.h"
+#include "deck.h"
+
+#define WRITE_END 1
+#define READ_END 0
+
+// The most seats in one game of the tournament
+#define MAX_SEATS RULES_MAX_SEATS
+
+// The most player programs in one tournament
+#define MAX_PROGRAMS 16
+
+
+/* Defines all possible exit statuses of the tournament program.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INVALID_PLAYERS = 2,
+    INVALID_THRESHOLD = 3,
+    CORPUS_ERROR = 4,
+    WORKER_ERROR = 5,
+};
+
+
+/* The arguments of the tournament.
+ */
+struct TourneyArgs {
+    // The hub program used to play each game
+    const char* hub;
+    // The number of worker processes
+    int numWorkers;
+    // Whether each game must seat different programs
+    bool distinct;
+    // The number of seats in each game
+    int numSeats;
+    // The threshold passed to the hub
+    const char* threshold;
+    // The player programs taking part
+    char** programs;
+    // The number of player programs
+    int numPrograms;
+    // The deck files of the corpus
+    char** decks;
+    // The number of deck files
+    int numDecks;
+};
+
+
+/* A game to play, sent from the tournament to any idle worker. Jobs and
+ * results are smaller than PIPE_BUF, so the workers can share one pipe
+ * of each without their messages interleaving.
+ */
+struct Job {
+    // The deck file to play
+    int deck;
+    // The program in each seat
+    int seats[MAX_SEATS];
+};
+
+
+/* The outcome of a game, sent from a worker back to the tournament.
+ */
+struct Result {
+    // The game that was played
+    struct Job job;
+    // The exit status of the hub, or -1 if it could not be run
+    int status;
+    // The final score of each seat
+    int scores[MAX_SEATS];
+};
+
+
+/* The results matrix, accumulated per program and seat.
+ */
+struct Matrix {
+    // The number of games each program played in each seat
+    long games[MAX_PROGRAMS][MAX_SEATS];
+    // The total score of each program in each seat
+    long scores[MAX_PROGRAMS][MAX_SEATS];
+    // The games each program won in each seat, shared between ties
+    double wins[MAX_PROGRAMS][MAX_SEATS];
+    // The number of games completed
+    long completed;
+    // The number of games the hub failed to complete
+    long failed;
+};
+
+
+/* Checks command line arguments are valid. Returns 0 if the values are
+ * within a valid range, and the relevant exit status otherwise.
+ */
+enum ExitMessage check_valid_args(struct TourneyArgs* args, int argc,
+        char** argv) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+
+    args->hub = "./2310hub";
+    args->numWorkers = cores > 0 ? (int)cores : 1;
+    args->distinct = false;
+    args->decks = NULL;
+    args->numDecks = 0;
+
+    while ((option = getopt(argc, argv, "j:H:u")) != -1) {
+        switch (option) {
+            case 'j':
+                args->numWorkers = atoi(optarg);
+                break;
+            case 'H':
+                args->hub = optarg;
+                break;
+            case 'u':
+                args->distinct = true;
+                break;
+            default:
+                return ARGUMENT_LENGTH;
+        }
+    }
+
+    if (argc - optind < 4 || args->numWorkers < 1) {
+        return ARGUMENT_LENGTH;
+    }
+
+    args->numSeats = atoi(argv[optind]);
+    args->threshold = argv[optind + 1];
+    args->programs = &argv[optind + 3];
+    args->numPrograms = argc - optind - 3;
+
+    if (args->numSeats < 2 || args->numSeats > MAX_SEATS ||
+            args->numPrograms > MAX_PROGRAMS ||
+            (args->distinct && args->numPrograms < args->numSeats)) {
+        return INVALID_PLAYERS;
+    }
+
+    if (atoi(args->threshold) < 2) {
+        return INVALID_THRESHOLD;
+    }
+
+    return deck_add_corpus(argv[optind + 2], &args->decks, &args->numDecks) ?
+            NORMAL_EXIT : CORPUS_ERROR;
+}
+
+
+/* Returns the number of seat assignments: every program in every seat,
+ * or only assignments of different programs if they must be distinct.
+ */
+long count_assignments(const struct TourneyArgs* args) {
+    long count = 1;
+
+    for (int i = 0; i < args->numSeats; i++) {
+        count *= args->distinct ? args->numPrograms - i : args->numPrograms;
+    }
+
+    return count;
+}
+
+
+/* Fills in the seats of the given assignment number. With distinct
+ * programs the number is decoded in the factorial number system over
+ * the programs not yet seated, and otherwise in base numPrograms.
+ */
+void decode_assignment(const struct TourneyArgs* args, long assignment,
+        struct Job* job) {
+    bool used[MAX_PROGRAMS] = {false};
+
+    for (int i = 0; i < args->numSeats; i++) {
+        int base = args->distinct ? args->numPrograms - i : args->numPrograms;
+        int choice = assignment % base;
+
+        assignment /= base;
+        if (!args->distinct) {
+            job->seats[i] = choice;
+            continue;
+        }
+
+        for (int j = 0; j < args->numPrograms; j++) {
+            if (!used[j] && choice-- == 0) {
+                job->seats[i] = j;
+                used[j] = true;
+                break;
+            }
+        }
+    }
+}
+
+
+/* Parses the final score line of the hub, such as 0:3 1:-2, into the
+ * scores of each seat. Returns true if every seat had a score.
+ */
+bool parse_scores(const char* line, int numSeats, int scores[]) {
+    const char* position = line;
+
+    for (int i = 0; i < numSeats; i++) {
+        char* end;
+
+        if (strtol(position, &end, 10) != i || *end != ':') {
+            return false;
+        }
+
+        scores[i] = strtol(end + 1, &end, 10);
+        position = end;
+    }
+
+    return *position == '\0' || *position == '\n';
+}
+
+
+/* Plays one game by running the hub with its output on a pipe, and
+ * returns the result parsed from the last line of its output.
+ */
+struct Result play_job(const struct TourneyArgs* args, struct Job job) {
+    struct Result result;
+    char* argv[MAX_SEATS + 4];
+    char line[256];
+    char last[256] = "";
+    int output[2];
+    FILE* fromHub;
+    pid_t pid;
+
+    result.job = job;
+    result.status = -1;
+
+    argv[0] = (char*)args->hub;
+    argv[1] = args->decks[job.deck];
+    argv[2] = (char*)args->threshold;
+    for (int i = 0; i < args->numSeats; i++) {
+        argv[i + 3] = args->programs[job.seats[i]];
+    }
+    argv[args->numSeats + 3] = NULL;
+
+    if (pipe(output)) {
+        return result;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        close(output[READ_END]);
+        close(output[WRITE_END]);
+        return result;
+    } else if (!pid) {
+        close(output[READ_END]);
+        dup2(output[WRITE_END], STDOUT_FILENO);
+        close(output[WRITE_END]);
+        // the hub's error messages would only interleave with the matrix,
+        // and stderr must stay open so that the hub's pipes cannot reuse it
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDERR_FILENO);
+        close(null);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    close(output[WRITE_END]);
+    fromHub = fdopen(output[READ_END], "r");
+    while (fgets(line, sizeof(line), fromHub)) {
+        strcpy(last, line);
+    }
+    fclose(fromHub);
+
+    waitpid(pid, &result.status, 0);
+    result.status = WIFEXITED(result.status) ? WEXITSTATUS(result.status) :
+            128 + WTERMSIG(result.status);
+
+    if (!parse_scores(last, args->numSeats, result.scores) &&
+            !result.status) {
+        result.status = -1;
+    }
+
+    return result;
+}
+
+
+/* The body of a worker process: takes jobs from the shared job pipe
+ * until it is closed, and writes each result to the shared result pipe.
+ */
+void run_worker(const struct TourneyArgs* args, int jobs, int results) {
+    struct Job job;
+
+    while (read(jobs, &job, sizeof(job)) == sizeof(job)) {
+        struct Result result = play_job(args, job);
+
+        if (write(results, &result, sizeof(result)) != sizeof(result)) {
+            break;
+        }
+    }
+
+    _exit(0);
+}
+
+
+/* Adds the result of a game to the matrix. A game is won by the seats
+ * with the highest score, which share the win if tied.
+ */
+void record_result(const struct TourneyArgs* args, struct Matrix* matrix,
+        const struct Result* result) {
+    int best = INT_MIN;
+    int winners = 0;
+
+    if (result->status) {
+        matrix->failed++;
+        return;
+    }
+
+    for (int i = 0; i < args->numSeats; i++) {
+        if (result->scores[i] > best) {
+            best = result->scores[i];
+            winners = 0;
+        }
+        winners += result->scores[i] == best;
+    }
+
+    for (int i = 0; i < args->numSeats; i++) {
+        int program = result->job.seats[i];
+
+        matrix->games[program][i]++;
+        matrix->scores[program][i] += result->scores[i];
+        if (result->scores[i] == best) {
+            matrix->wins[program][i] += 1.0 / winners;
+        }
+    }
+
+    matrix->completed++;
+}
+
+
+/* Starts the worker processes, all reading the same job pipe and
+ * writing the same result pipe. Returns the number started.
+ */
+int start_workers(const struct TourneyArgs* args, int jobs[2],
+        int results[2], pid_t workers[]) {
+    int started = 0;
+
+    for (int i = 0; i < args->numWorkers; i++) {
+        workers[i] = fork();
+
+        if (workers[i] < 0) {
+            break;
+        } else if (!workers[i]) {
+            close(jobs[WRITE_END]);
+            close(results[READ_END]);
+            run_worker(args, jobs[READ_END], results[WRITE_END]);
+        }
+        started++;
+    }
+
+    close(jobs[READ_END]);
+    close(results[WRITE_END]);
+    return started;
+}
+
+
+/* Plays every seat assignment on every deck. Jobs are written to the job
+ * pipe whenever it has room, so that each worker takes the next game as
+ * soon as it finishes one, and results are read as they arrive.
+ */
+enum ExitMessage run_tourney(const struct TourneyArgs* args,
+        struct Matrix* matrix) {
+    long assignments = count_assignments(args);
+    long total = assignments * args->numDecks;
+    long sent = 0;
+    long received = 0;
+    int jobs[2];
+    int results[2];
+    pid_t* workers = malloc(sizeof(pid_t) * args->numWorkers);
+    int numWorkers;
+
+    if (pipe(jobs) || pipe(results)) {
+        return WORKER_ERROR;
+    }
+
+    numWorkers = start_workers(args, jobs, results, workers);
+    if (!numWorkers) {
+        return WORKER_ERROR;
+    }
+    fcntl(jobs[WRITE_END], F_SETFL, O_NONBLOCK);
+
+    while (received < total) {
+        struct pollfd fds[2] = {
+            {.fd = results[READ_END], .events = POLLIN},
+            {.fd = sent < total ? jobs[WRITE_END] : -1, .events = POLLOUT},
+        };
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        while (sent < total && (fds[1].revents & POLLOUT)) {
+            struct Job job;
+
+            job.deck = sent / assignments;
+            decode_assignment(args, sent % assignments, &job);
+            if (write(jobs[WRITE_END], &job, sizeof(job)) != sizeof(job)) {
+                break;
+            }
+            if (++sent == total) {
+                close(jobs[WRITE_END]);
+            }
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            struct Result result;
+
+            if (read(results[READ_END], &result, sizeof(result)) !=
+                    sizeof(result)) {
+                break;
+            }
+            record_result(args, matrix, &result);
+            received++;
+        }
+    }
+
+    if (sent < total) {
+        close(jobs[WRITE_END]);
+    }
+    close(results[READ_END]);
+    for (int i = 0; i < numWorkers; i++) {
+        waitpid(workers[i], NULL, 0);
+    }
+    free(workers);
+
+    return received == total ? NORMAL_EXIT : WORKER_ERROR;
+}
+
+
+/* Outputs the results matrix: the mean score of each program in each
+ * seat, then its mean score and win rate over all seats.
+ */
+void output_matrix(const struct TourneyArgs* args,
+        const struct Matrix* matrix) {
+    printf("Games=%ld Failed=%ld\n", matrix->completed, matrix->failed);
+    printf("%-20s", "program");
+    for (int i = 0; i < args->numSeats; i++) {
+        printf(" %8s%-2d", "seat", i);
+    }
+    printf(" %10s %8s\n", "mean", "wins");
+
+    for (int i = 0; i < args->numPrograms; i++) {
+        long games = 0;
+        long scores = 0;
+        double wins = 0;
+
+        printf("%-20s", args->programs[i]);
+        for (int j = 0; j < args->numSeats; j++) {
+            if (matrix->games[i][j]) {
+                printf(" %10.3f", (double)matrix->scores[i][j] /
+                        matrix->games[i][j]);
+            } else {
+                printf(" %10s", "-");
+            }
+            games += matrix->games[i][j];
+            scores += matrix->scores[i][j];
+            wins += matrix->wins[i][j];
+        }
+
+        if (games) {
+            printf(" %10.3f %7.1f%%\n", (double)scores / games,
+                    100 * wins / games);
+        } else {
+            printf(" %10s %8s\n", "-", "-");
+        }
+    }
+    fflush(stdout);
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_game_over(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310tourney [-j workers] [-H hub] [-u] "
+                    "players threshold corpus program {program}\n");
+            break;
+        case INVALID_PLAYERS:
+            fprintf(stderr, "Invalid players\n");
+            break;
+        case INVALID_THRESHOLD:
+            fprintf(stderr, "Invalid threshold\n");
+            break;
+        case CORPUS_ERROR:
+            fprintf(stderr, "Corpus error\n");
+            break;
+        case WORKER_ERROR:
+            fprintf(stderr, "Worker error\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+int main(int argc, char** argv) {
+    enum ExitMessage errorMessage;
+    struct TourneyArgs args;
+    struct Matrix* matrix = calloc(1, sizeof(struct Matrix));
+
+    // a worker exiting early must not kill the tournament, and hubs
+    // inherit this so players exiting before GAMEOVER end games cleanly
+    signal(SIGPIPE, SIG_IGN);
+
+    errorMessage = check_valid_args(&args, argc, argv);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    errorMessage = run_tourney(&args, matrix);
+    output_matrix(&args, matrix);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    free(matrix);
+    return NORMAL_EXIT;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+
+// The size of the buffer of events, written out whenever it fills
+#define TRACE_BUFFER 65536
+
+// The longest event written
+#define MAX_EVENT 256
+
+// The longest process name kept
+#define MAX_NAME 64
+
+
+bool traceEnabled = false;
+
+// The trace file, opened for appending
+static int traceFile = -1;
+
+// The process the buffer belongs to, since a forked child must not write
+// out its parent's events
+static pid_t tracePid;
+
+// The name of this process in the trace
+static char traceName[MAX_NAME];
+
+// The events not yet written out
+static char buffer[TRACE_BUFFER];
+static size_t buffered = 0;
+
+
+/* Appends text to the buffer, writing the buffer out first if it would
+ * not fit.
+ */
+static void append(const char* text, size_t length) {
+    if (buffered + length > TRACE_BUFFER) {
+        trace_flush();
+    }
+    memcpy(buffer + buffered, text, length);
+    buffered += length;
+}
+
+
+/* Starts the buffer of this process with the event naming it.
+ */
+static void name_process(void) {
+    char event[MAX_EVENT];
+    int length;
+
+    tracePid = getpid();
+    buffered = 0;
+    length = snprintf(event, sizeof(event), "{\"name\":\"process_name\","
+            "\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s %d\"}},\n",
+            (int)tracePid, traceName, (int)tracePid);
+    append(event, length);
+}
+
+
+/* Starts tracing if TRACE_FILE is set, naming this process in the trace.
+ * Events are written as trace-event JSON (the array format, which may be
+ * left unterminated), which trace viewers such as Perfetto and
+ * chrome://tracing load. Every process appends to the file, which is
+ * created by the first, so it must be removed before tracing a new run.
+ */
+void trace_open(const char* processName) {
+    const char* path = getenv(TRACE_ENV);
+
+    if (!path || traceEnabled) {
+        return;
+    }
+
+    // only the process creating the file starts the array
+    traceFile = open(path, O_WRONLY | O_APPEND | O_CREAT | O_EXCL |
+            O_CLOEXEC, 0644);
+    if (traceFile >= 0) {
+        if (write(traceFile, "[\n", 2) != 2) {
+            close(traceFile);
+            return;
+        }
+    } else {
+        traceFile = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (traceFile < 0) {
+            return;
+        }
+    }
+
+    // the hub starts players with stderr closed, whose writes must not
+    // land in the trace
+    if (traceFile <= STDERR_FILENO) {
+        int moved = fcntl(traceFile, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+
+        close(traceFile);
+        traceFile = moved;
+        if (traceFile < 0) {
+            return;
+        }
+    }
+
+    snprintf(traceName, sizeof(traceName), "%s", processName);
+    name_process();
+    atexit(trace_flush);
+    traceEnabled = true;
+}
+
+
+/* Records an event of the given phase: B to begin a span and E to end it.
+ * The seat is recorded as an argument unless it is negative.
+ */
+void trace_event(const char* name, char phase, int seat) {
+    char event[MAX_EVENT];
+    struct timespec now;
+    int length;
+
+    if (getpid() != tracePid) {
+        name_process();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    length = snprintf(event, sizeof(event), "{\"name\":\"%s\",\"ph\":\"%c\","
+            "\"ts\":%ld.%03ld,\"pid\":%d,\"tid\":%d", name, phase,
+            (long)now.tv_sec * 1000000 + now.tv_nsec / 1000,
+            now.tv_nsec % 1000, (int)tracePid, (int)tracePid);
+    if (seat >= 0) {
+        length += snprintf(event + length, sizeof(event) - length,
+                ",\"args\":{\"seat\":%d}", seat);
+    }
+    length += snprintf(event + length, sizeof(event) - length, "},\n");
+
+    append(event, length < MAX_EVENT ? length : MAX_EVENT - 1);
+}
+
+
+/* Writes the buffered events to the trace file, in one write so that the
+ * events of different processes do not interleave. Also done when the
+ * buffer fills and when the process exits.
+ */
+void trace_flush(void) {
+    if (traceFile < 0 || getpid() != tracePid) {
+        return;
+    }
+
+    if (write(traceFile, buffer, buffered) < 0) {
+        // a trace which cannot be written is dropped, not fatal
+    }
+    buffered = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/* The environment variable naming the file trace events are appended to.
+ * Without it nothing is traced. The hub passes it on to the players it
+ * starts, so that their events land in the same file.
+ */
+#define TRACE_ENV "TRACE_FILE"
+
+
+/* Whether this process is tracing. Checked before every event, so that
+ * tracing costs one branch when it is off.
+ */
+extern bool traceEnabled;
+
+
+/* Starts tracing if TRACE_FILE is set, naming this process in the trace.
+ * Events are written as trace-event JSON (the array format, which may be
+ * left unterminated), which trace viewers such as Perfetto and
+ * chrome://tracing load. Every process appends to the file, which is
+ * created by the first, so it must be removed before tracing a new run.
+ */
+void trace_open(const char* processName);
+
+
+/* Records an event of the given phase: B to begin a span and E to end it.
+ * The seat is recorded as an argument unless it is negative.
+ */
+void trace_event(const char* name, char phase, int seat);
+
+
+/* Writes the buffered events to the trace file. Also done when the buffer
+ * fills and when the process exits.
+ */
+void trace_flush(void);
+
+
+/* Begins a span of the given name, for the given seat or -1.
+ */
+static inline void trace_begin(const char* name, int seat) {
+    if (traceEnabled) {
+        trace_event(name, 'B', seat);
+    }
+}
+
+
+/* Ends the innermost span of the given name, for the given seat or -1.
+ */
+static inline void trace_end(const char* name, int seat) {
+    if (traceEnabled) {
+        trace_event(name, 'E', seat);
+    }
+}
+
+
+#endif
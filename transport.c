@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "transport.h"
+
+
+// The number of connections a listening player queues
+#define BACKLOG 64
+
+
+/* Returns true if the given player name is a socket address rather than
+ * a program to run.
+ */
+bool is_address(const char* name) {
+    return !strncmp(name, UNIX_PREFIX, strlen(UNIX_PREFIX)) ||
+            !strncmp(name, TCP_PREFIX, strlen(TCP_PREFIX));
+}
+
+
+/* Returns true if the given player name is the address of a zygote.
+ */
+bool is_zygote(const char* name) {
+    return !strncmp(name, ZYGOTE_PREFIX, strlen(ZYGOTE_PREFIX));
+}
+
+
+/* Fills in the socket address for a player address. Returns the length of
+ * the socket address, or 0 if the address is invalid.
+ */
+static socklen_t resolve_address(const char* address,
+        struct sockaddr_storage* storage) {
+    memset(storage, 0, sizeof(*storage));
+
+    if (!strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX)) ||
+            is_zygote(address)) {
+        struct sockaddr_un* local = (struct sockaddr_un*)storage;
+        const char* path = strchr(address, ':') + 1;
+
+        if (!*path || strlen(path) >= sizeof(local->sun_path)) {
+            return 0;
+        }
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, path);
+        return sizeof(struct sockaddr_un);
+    }
+
+    if (!strncmp(address, TCP_PREFIX, strlen(TCP_PREFIX))) {
+        struct sockaddr_in* inet = (struct sockaddr_in*)storage;
+        char* end;
+        long port = strtol(address + strlen(TCP_PREFIX), &end, 10);
+
+        if (*end || port < 1 || port > 65535) {
+            return 0;
+        }
+        inet->sin_family = AF_INET;
+        inet->sin_port = htons(port);
+        inet->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return sizeof(struct sockaddr_in);
+    }
+
+    return 0;
+}
+
+
+/* Disables Nagle's algorithm on TCP sockets, since every message is a
+ * single short line that the other side waits for.
+ */
+static void set_no_delay(int fd, const struct sockaddr_storage* storage) {
+    int on = 1;
+
+    if (storage->ss_family == AF_INET) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+}
+
+
+/* Creates a socket listening on the given address. A stale Unix domain
+ * socket file is replaced. Returns the socket, or -1 on failure.
+ */
+int listen_address(const char* address) {
+    struct sockaddr_storage storage;
+    socklen_t length = resolve_address(address, &storage);
+    int on = 1;
+    int fd;
+
+    if (!length) {
+        return -1;
+    }
+
+    fd = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (storage.ss_family == AF_UNIX) {
+        unlink(((struct sockaddr_un*)&storage)->sun_path);
+    } else {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+
+    if (bind(fd, (struct sockaddr*)&storage, length) ||
+            listen(fd, BACKLOG)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/* Connects to a player listening on the given address. Returns the
+ * connected socket, or -1 on failure.
+ */
+int connect_address(const char* address) {
+    struct sockaddr_storage storage;
+    socklen_t length = resolve_address(address, &storage);
+    int fd;
+
+    if (!length) {
+        return -1;
+    }
+
+    fd = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr*)&storage, length)) {
+        close(fd);
+        return -1;
+    }
+
+    set_no_delay(fd, &storage);
+    return fd;
+}
+
+
+/* Accepts the next connection on a listening socket. Returns the
+ * connected socket, or -1 on failure.
+ */
+int accept_connection(int listener) {
+    struct sockaddr_storage storage;
+    socklen_t length = sizeof(storage);
+    int fd = accept(listener, (struct sockaddr*)&storage, &length);
+
+    if (fd >= 0) {
+        set_no_delay(fd, &storage);
+    }
+
+    return fd;
+}
+
+
+/* Sends a message over a Unix domain socket together with the given file
+ * descriptors, which the receiver gets copies of. Returns false on failure.
+ */
+bool send_fds(int socket, const char* message, const int* fds, int count) {
+    char control[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+    struct iovec data = {.iov_base = (void*)message,
+            .iov_len = strlen(message)};
+    struct msghdr header;
+    struct cmsghdr* rights;
+
+    if (count < 1 || count > MAX_PASSED_FDS) {
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memset(control, 0, sizeof(control));
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+    rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(rights), fds, sizeof(int) * count);
+
+    return sendmsg(socket, &header, 0) == (ssize_t)data.iov_len;
+}
+
+
+/* Receives a message sent by send_fds into buffer, which is terminated,
+ * and the passed file descriptors into fds. Returns the number of file
+ * descriptors received, or -1 on failure. Descriptors beyond maxFds are
+ * closed.
+ */
+int receive_fds(int socket, char* buffer, size_t size, int* fds,
+        int maxFds) {
+    char control[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+    struct iovec data = {.iov_base = buffer, .iov_len = size - 1};
+    struct msghdr header;
+    struct cmsghdr* rights;
+    ssize_t length;
+    int count = 0;
+
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    length = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+    if (length < 0) {
+        return -1;
+    }
+    buffer[length] = '\0';
+
+    for (rights = CMSG_FIRSTHDR(&header); rights;
+            rights = CMSG_NXTHDR(&header, rights)) {
+        int passed[MAX_PASSED_FDS];
+        int number = (rights->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+        if (rights->cmsg_level != SOL_SOCKET ||
+                rights->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        memcpy(passed, CMSG_DATA(rights), sizeof(int) * number);
+        for (int i = 0; i < number; i++) {
+            if (count < maxFds) {
+                fds[count++] = passed[i];
+            } else {
+                close(passed[i]);
+            }
+        }
+    }
+
+    return count;
+}
+
+
+/* Opens a connected socket as a pair of streams, one for reading and one
+ * for writing, so that each can be closed independently. Returns false on
+ * failure, in which case the socket is closed.
+ */
+bool open_streams(int socket, FILE** input, FILE** output) {
+    int copy = dup(socket);
+
+    *input = copy >= 0 ? fdopen(socket, "r") : NULL;
+    *output = *input ? fdopen(copy, "w") : NULL;
+
+    if (!*output) {
+        if (*input) {
+            fclose(*input);
+        } else {
+            close(socket);
+        }
+        if (copy >= 0) {
+            close(copy);
+        }
+        return false;
+    }
+
+    return true;
+}
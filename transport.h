@@ -0,0 +1,74 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+
+/* Player addresses are written unix:PATH for a Unix domain socket, or
+ * tcp:PORT for a TCP socket on the loopback interface. A zygote, which
+ * forks a player for each game rather than playing itself, is written
+ * zygote:PATH and always listens on a Unix domain socket.
+ */
+#define UNIX_PREFIX "unix:"
+#define TCP_PREFIX "tcp:"
+#define ZYGOTE_PREFIX "zygote:"
+
+
+/* The most file descriptors passed in one message.
+ */
+#define MAX_PASSED_FDS 4
+
+
+/* Returns true if the given player name is a socket address rather than
+ * a program to run.
+ */
+bool is_address(const char* name);
+
+
+/* Creates a socket listening on the given address. A stale Unix domain
+ * socket file is replaced. Returns the socket, or -1 on failure.
+ */
+int listen_address(const char* address);
+
+
+/* Connects to a player listening on the given address. Returns the
+ * connected socket, or -1 on failure.
+ */
+int connect_address(const char* address);
+
+
+/* Accepts the next connection on a listening socket. Returns the
+ * connected socket, or -1 on failure.
+ */
+int accept_connection(int listener);
+
+
+/* Returns true if the given player name is the address of a zygote.
+ */
+bool is_zygote(const char* name);
+
+
+/* Sends a message over a Unix domain socket together with the given file
+ * descriptors, which the receiver gets copies of. Returns false on failure.
+ */
+bool send_fds(int socket, const char* message, const int* fds, int count);
+
+
+/* Receives a message sent by send_fds into buffer, which is terminated,
+ * and the passed file descriptors into fds. Returns the number of file
+ * descriptors received, or -1 on failure. Descriptors beyond maxFds are
+ * closed.
+ */
+int receive_fds(int socket, char* buffer, size_t size, int* fds,
+        int maxFds);
+
+
+/* Opens a connected socket as a pair of streams, one for reading and one
+ * for writing, so that each can be closed independently. Returns false on
+ * failure, in which case the socket is closed.
+ */
+bool open_streams(int socket, FILE** input, FILE** output);
+
+
+#endif
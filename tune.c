@@ -0,0 +1,751 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "utilities.h"
+#include "model.h"
+#include "deck.h"
+#include "batch.h"
+#include "bobparams.h"
+
+// The candidates of a random search, and the population of an evolutionary
+// search, when not given
+#define DEFAULT_CANDIDATES 256
+
+// The generations of an evolutionary search when not given
+#define DEFAULT_GENERATIONS 10
+
+// The lowest margin searched; the highest is the threshold, from which on
+// bob always tries to win rounds with diamonds
+#define MIN_MARGIN (-1)
+
+// The most candidates of a grid search
+#define MAX_GRID (1 << 22)
+
+// The decks every candidate plays before any is discarded. Each stage of
+// a race doubles the decks played
+#define FIRST_STAGE 64
+
+// The decks one task plays for one candidate
+#define TASK_DECKS 64
+
+// How many standard errors a candidate's mean must be below the best
+// one's to be discarded as clearly worse
+#define DISCARD_Z 3.0
+
+// The number of best candidates output
+#define SHOWN 10
+
+
+/* Defines all possible exit statuses of the tuner, with the same values
+ * as the hub's.
+ */
+enum ExitMessage {
+    NORMAL_EXIT = 0,
+    ARGUMENT_LENGTH = 1,
+    INVALID_THRESHOLD = 2,
+    DECK_ERROR = 3,
+    SMALL_DECK = 4,
+    PLAYER_ERROR = 5,
+};
+
+
+/* The ways of choosing the candidates to race.
+ */
+enum SearchMethod {
+    SEARCH_GRID = 0,
+    SEARCH_RANDOM = 1,
+    SEARCH_EVOLVE = 2,
+};
+
+
+/* The arguments of the tuner.
+ */
+struct TuneArgs {
+    // The number of threads playing games
+    int threads;
+    // How candidates are chosen
+    enum SearchMethod method;
+    // The number of candidates, or the population of an evolutionary search
+    int numCandidates;
+    // The generations of an evolutionary search
+    int generations;
+    // The seed of the random choices
+    uint64_t seed;
+    // The threshold of every game
+    int threshold;
+    // The strategy of each opponent, seated after the tuned bob in order
+    enum BatchStrategy opponents[MODEL_MAX_PLAYERS];
+    // The number of seats, the tuned bob's and the opponents'
+    int numSeats;
+    // The deck files of the corpus
+    char** decks;
+    // The number of deck files
+    int numDecks;
+};
+
+
+/* A set of bob's parameters, and how it has played so far in a race.
+ */
+struct Candidate {
+    // The parameters played
+    struct BobParams params;
+    // The sum over the decks played of the candidate's margin, its score
+    // less the average of the other seats', averaged over its seats
+    double sum;
+    // The sum of the squares of the margins
+    double sumSquares;
+    // The number of decks played
+    int decks;
+    // Whether the candidate was discarded as clearly worse than the best
+    bool discarded;
+};
+
+
+/* The sums of margins one task adds to its candidate.
+ */
+struct Partial {
+    // The sum of the margins of the task's decks
+    double sum;
+    // The sum of their squares
+    double sumSquares;
+};
+
+
+/* A race of candidates over the dealt corpus, shared with the threads
+ * playing one stage of it.
+ */
+struct Race {
+    // The arguments of the tuner
+    const struct TuneArgs* args;
+    // The games of the corpus, dealt and not started
+    const struct ModelState* deals;
+    // The number of games
+    int numDeals;
+    // The candidates racing
+    struct Candidate* candidates;
+    // The indices of the candidates not yet discarded
+    int* alive;
+    // The number of candidates not yet discarded
+    int numAlive;
+    // The first deck of the stage being played
+    int from;
+    // The deck after the last of the stage
+    int to;
+    // The number of tasks of each candidate in the stage
+    int chunks;
+    // The sums of each task, numAlive * chunks of them
+    struct Partial* partials;
+    // The next task to take, taken atomically
+    int next;
+    // The number of games played, added to atomically
+    long games;
+};
+
+
+/* Returns the mean margin of a candidate, which has played some decks.
+ */
+static double mean(const struct Candidate* candidate) {
+    return candidate->sum / candidate->decks;
+}
+
+
+/* Returns the variance of the mean margin of a candidate.
+ */
+static double mean_variance(const struct Candidate* candidate) {
+    double average = mean(candidate);
+    double variance = candidate->sumSquares / candidate->decks -
+            average * average;
+
+    return (variance > 0 ? variance : 0) / candidate->decks;
+}
+
+
+/* Sets the seats of a game in which the tuned bob sits in the given
+ * seat, and the opponents in order in the seats after it.
+ */
+static void seat_players(const struct TuneArgs* args,
+        const struct BobParams* tuned, int tunedSeat,
+        enum BatchStrategy* seats, struct BobParams* bobParams) {
+    for (int p = 0; p < args->numSeats; p++) {
+        int opponent = (p - tunedSeat - 1 + args->numSeats) % args->numSeats;
+
+        if (p == tunedSeat) {
+            seats[p] = BATCH_BOB;
+            bobParams[p] = *tuned;
+        } else {
+            seats[p] = args->opponents[opponent];
+            bob_default_params(&bobParams[p]);
+        }
+    }
+}
+
+
+/* Plays a candidate on the decks from first to before last, in every seat
+ * in turn, BATCH_LANES decks at a time. The margin of each deck, averaged
+ * over the seats, is added to partial.
+ */
+static void play_decks(struct Race* race, const struct BobParams* params,
+        int first, int last, struct Partial* partial) {
+    const struct TuneArgs* args = race->args;
+    enum BatchStrategy seats[MODEL_MAX_PLAYERS];
+    struct BobParams bobParams[MODEL_MAX_PLAYERS];
+    struct Batch batch;
+
+    for (int deck = first; deck < last; deck += BATCH_LANES) {
+        int lanes = last - deck < BATCH_LANES ? last - deck : BATCH_LANES;
+        double margins[BATCH_LANES] = {0};
+
+        for (int tunedSeat = 0; tunedSeat < args->numSeats; tunedSeat++) {
+            seat_players(args, params, tunedSeat, seats, bobParams);
+            batch_init(&batch, args->numSeats, args->threshold, seats,
+                    bobParams);
+            for (int lane = 0; lane < lanes; lane++) {
+                batch_deal(&batch, lane, &race->deals[deck + lane]);
+            }
+            batch_play(&batch);
+
+            for (int lane = 0; lane < lanes; lane++) {
+                struct ModelState result = race->deals[deck + lane];
+                int others = 0;
+
+                batch_result(&batch, lane, &result);
+                for (int p = 0; p < args->numSeats; p++) {
+                    others += p == tunedSeat ? 0 : model_score(&result, p);
+                }
+                margins[lane] += model_score(&result, tunedSeat) -
+                        (double)others / (args->numSeats - 1);
+            }
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            double margin = margins[lane] / args->numSeats;
+
+            partial->sum += margin;
+            partial->sumSquares += margin * margin;
+        }
+        __atomic_add_fetch(&race->games, (long)lanes * args->numSeats,
+                __ATOMIC_RELAXED);
+    }
+}
+
+
+/* Takes tasks of the current stage until none are left. Each task plays
+ * one candidate on one chunk of the stage's decks.
+ */
+static void* play_tasks(void* data) {
+    struct Race* race = data;
+    int numTasks = race->numAlive * race->chunks;
+    int task;
+
+    while ((task = __atomic_fetch_add(&race->next, 1, __ATOMIC_RELAXED)) <
+            numTasks) {
+        struct Candidate* candidate =
+                &race->candidates[race->alive[task / race->chunks]];
+        int first = race->from + (task % race->chunks) * TASK_DECKS;
+        int last = first + TASK_DECKS < race->to ? first + TASK_DECKS :
+                race->to;
+
+        play_decks(race, &candidate->params, first, last,
+                &race->partials[task]);
+    }
+
+    return NULL;
+}
+
+
+/* Plays one stage of a race, the decks from race->from to race->to for
+ * every candidate alive, spread over the tuner's threads, and adds the
+ * margins to the candidates.
+ */
+static void play_stage(struct Race* race) {
+    pthread_t threads[race->args->threads];
+    bool started[race->args->threads];
+    int numTasks;
+
+    race->chunks = (race->to - race->from + TASK_DECKS - 1) / TASK_DECKS;
+    numTasks = race->numAlive * race->chunks;
+    race->partials = calloc(numTasks, sizeof(struct Partial));
+    race->next = 0;
+
+    for (int i = 1; i < race->args->threads && i < numTasks; i++) {
+        started[i] = !pthread_create(&threads[i], NULL, play_tasks, race);
+    }
+    play_tasks(race);
+    for (int i = 1; i < race->args->threads && i < numTasks; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (int task = 0; task < numTasks; task++) {
+        struct Candidate* candidate =
+                &race->candidates[race->alive[task / race->chunks]];
+
+        candidate->sum += race->partials[task].sum;
+        candidate->sumSquares += race->partials[task].sumSquares;
+        if (task % race->chunks == 0) {
+            candidate->decks += race->to - race->from;
+        }
+    }
+
+    free(race->partials);
+}
+
+
+/* Discards the candidates alive whose mean margin is clearly below the
+ * best one's: by more than DISCARD_Z standard errors of the difference.
+ */
+static void discard_worse(struct Race* race) {
+    const struct Candidate* best = &race->candidates[race->alive[0]];
+    int kept = 0;
+
+    for (int i = 1; i < race->numAlive; i++) {
+        const struct Candidate* candidate =
+                &race->candidates[race->alive[i]];
+
+        if (mean(candidate) > mean(best)) {
+            best = candidate;
+        }
+    }
+
+    for (int i = 0; i < race->numAlive; i++) {
+        struct Candidate* candidate = &race->candidates[race->alive[i]];
+        double error = sqrt(mean_variance(best) + mean_variance(candidate));
+
+        if (mean(best) - mean(candidate) > DISCARD_Z * error) {
+            candidate->discarded = true;
+        } else {
+            race->alive[kept++] = race->alive[i];
+        }
+    }
+
+    race->numAlive = kept;
+}
+
+
+/* Races candidates over the whole corpus. Every candidate alive plays the
+ * same decks in stages, each twice as long as the one before, and after
+ * each stage the clearly worse candidates are discarded, so that most of
+ * the games go to the candidates which might be best. Returns the number
+ * of games played.
+ */
+static long race_candidates(const struct TuneArgs* args,
+        const struct ModelState* deals, struct Candidate* candidates,
+        int numCandidates) {
+    struct Race race = {
+        .args = args,
+        .deals = deals,
+        .numDeals = args->numDecks,
+        .candidates = candidates,
+        .alive = malloc(sizeof(int) * numCandidates),
+        .numAlive = numCandidates,
+    };
+
+    for (int i = 0; i < numCandidates; i++) {
+        candidates[i].sum = 0;
+        candidates[i].sumSquares = 0;
+        candidates[i].decks = 0;
+        candidates[i].discarded = false;
+        race.alive[i] = i;
+    }
+
+    while (race.to < race.numDeals) {
+        race.from = race.to;
+        race.to = race.from < FIRST_STAGE ? FIRST_STAGE : 2 * race.from;
+        if (race.to > race.numDeals) {
+            race.to = race.numDeals;
+        }
+        play_stage(&race);
+        discard_worse(&race);
+    }
+
+    free(race.alive);
+    return race.games;
+}
+
+
+/* Orders candidates by how well they did: those never discarded first,
+ * then by the decks they played, then by their mean margin.
+ */
+static int compare_candidates(const void* first, const void* second) {
+    const struct Candidate* a = first;
+    const struct Candidate* b = second;
+
+    if (a->discarded != b->discarded) {
+        return a->discarded ? 1 : -1;
+    }
+    if (a->decks != b->decks) {
+        return b->decks - a->decks;
+    }
+
+    return (mean(b) > mean(a)) - (mean(b) < mean(a));
+}
+
+
+/* Shuffles an order of suits in place.
+ */
+static void shuffle_order(char* order, uint64_t* random) {
+    for (int i = NUM_SUITS - 1; i > 0; i--) {
+        int j = model_random(random) % (i + 1);
+        char suit = order[i];
+
+        order[i] = order[j];
+        order[j] = suit;
+    }
+}
+
+
+/* Sets params to a uniformly random set of parameters.
+ */
+static void random_params(const struct TuneArgs* args,
+        struct BobParams* params, uint64_t* random) {
+    bob_default_params(params);
+    params->margin = MIN_MARGIN + model_random(random) %
+            (args->threshold - MIN_MARGIN + 1);
+    shuffle_order(params->leadOrder, random);
+    shuffle_order(params->duckOrder, random);
+    shuffle_order(params->winOrder, random);
+}
+
+
+/* Changes one parameter a little: the margin by one, or two suits of one
+ * order swapped.
+ */
+static void mutate_params(const struct TuneArgs* args,
+        struct BobParams* params, uint64_t* random) {
+    char* orders[] = {params->leadOrder, params->duckOrder, params->winOrder};
+    int choice = model_random(random) % 4;
+
+    if (choice == 3) {
+        params->margin += model_random(random) % 2 ? 1 : -1;
+        if (params->margin < MIN_MARGIN) {
+            params->margin = MIN_MARGIN + 1;
+        } else if (params->margin > args->threshold) {
+            params->margin = args->threshold - 1;
+        }
+    } else {
+        int i = model_random(random) % NUM_SUITS;
+        int j = (i + 1 + model_random(random) % (NUM_SUITS - 1)) % NUM_SUITS;
+        char suit = orders[choice][i];
+
+        orders[choice][i] = orders[choice][j];
+        orders[choice][j] = suit;
+    }
+}
+
+
+/* Fills orders with every order of the suits, and returns their number.
+ * orders may be NULL to only count them.
+ */
+static int all_orders(char (*orders)[NUM_SUITS]) {
+    char order[NUM_SUITS];
+    int counts[NUM_SUITS] = {0};
+    int numOrders = 0;
+    int i = 1;
+
+    // Heap's algorithm, without recursion
+    memcpy(order, SUITS, NUM_SUITS);
+    if (orders) {
+        memcpy(orders[numOrders], order, NUM_SUITS);
+    }
+    numOrders++;
+    while (i < NUM_SUITS) {
+        if (counts[i] < i) {
+            int j = i % 2 ? counts[i] : 0;
+            char suit = order[i];
+
+            order[i] = order[j];
+            order[j] = suit;
+            if (orders) {
+                memcpy(orders[numOrders], order, NUM_SUITS);
+            }
+            numOrders++;
+            counts[i]++;
+            i = 1;
+        } else {
+            counts[i++] = 0;
+        }
+    }
+
+    return numOrders;
+}
+
+
+/* Returns every set of parameters, or NULL if there are more than
+ * MAX_GRID of them, setting numCandidates.
+ */
+static struct Candidate* grid_candidates(const struct TuneArgs* args,
+        int* numCandidates) {
+    int numOrders = all_orders(NULL);
+    int numMargins = args->threshold - MIN_MARGIN + 1;
+    double total = (double)numMargins * numOrders * numOrders * numOrders;
+    char (*orders)[NUM_SUITS];
+    struct Candidate* candidates;
+    int count = 0;
+
+    if (total > MAX_GRID) {
+        return NULL;
+    }
+
+    orders = malloc(sizeof(*orders) * numOrders);
+    all_orders(orders);
+    candidates = calloc(total, sizeof(struct Candidate));
+    for (int margin = MIN_MARGIN; margin <= args->threshold; margin++) {
+        for (int lead = 0; lead < numOrders; lead++) {
+            for (int duck = 0; duck < numOrders; duck++) {
+                for (int win = 0; win < numOrders; win++) {
+                    struct BobParams* params = &candidates[count++].params;
+
+                    params->margin = margin;
+                    memcpy(params->leadOrder, orders[lead], NUM_SUITS);
+                    memcpy(params->duckOrder, orders[duck], NUM_SUITS);
+                    memcpy(params->winOrder, orders[win], NUM_SUITS);
+                }
+            }
+        }
+    }
+
+    free(orders);
+    *numCandidates = count;
+    return candidates;
+}
+
+
+/* Evolves a population of candidates over the given generations: each
+ * generation is raced, its best quarter is kept, and the rest is replaced
+ * by mutations of them. The first population is bob's defaults and random
+ * candidates. Leaves the last generation raced and returns the number of
+ * games played.
+ */
+static long evolve_candidates(const struct TuneArgs* args,
+        const struct ModelState* deals, struct Candidate* candidates,
+        uint64_t* random) {
+    int population = args->numCandidates;
+    int elite = population / 4 > 1 ? population / 4 : 1;
+    long games = 0;
+
+    bob_default_params(&candidates[0].params);
+    for (int i = 1; i < population; i++) {
+        random_params(args, &candidates[i].params, random);
+    }
+
+    for (int generation = 0; generation < args->generations; generation++) {
+        char text[BOB_PARAMS_LENGTH];
+
+        if (generation) {
+            for (int i = elite; i < population; i++) {
+                int parent = model_random(random) % elite;
+
+                candidates[i].params = candidates[parent].params;
+                mutate_params(args, &candidates[i].params, random);
+                if (model_random(random) % 2) {
+                    mutate_params(args, &candidates[i].params, random);
+                }
+            }
+        }
+
+        games += race_candidates(args, deals, candidates, population);
+        qsort(candidates, population, sizeof(struct Candidate),
+                compare_candidates);
+        bob_format_params(&candidates[0].params, text);
+        fprintf(stderr, "Generation %d: best %s %.4f\n", generation, text,
+                mean(&candidates[0]));
+    }
+
+    return games;
+}
+
+
+/* Checks the arguments and fills args from them. Returns 0 on success,
+ * and the relevant exit status otherwise.
+ */
+enum ExitMessage check_valid_args(struct TuneArgs* args, int argc,
+        char** argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* methods[] = {"grid", "random", "evolve"};
+    int option;
+
+    memset(args, 0, sizeof(*args));
+    args->threads = threads > 0 ? threads : 1;
+    args->method = SEARCH_RANDOM;
+    args->numCandidates = DEFAULT_CANDIDATES;
+    args->generations = DEFAULT_GENERATIONS;
+    args->seed = 1;
+    while ((option = getopt(argc, argv, "j:s:n:g:r:")) != -1) {
+        switch (option) {
+            case 'j':
+                args->threads = atoi(optarg);
+                break;
+            case 's':
+                args->method = -1;
+                for (int i = 0; i < 3; i++) {
+                    if (!strcmp(optarg, methods[i])) {
+                        args->method = i;
+                    }
+                }
+                break;
+            case 'n':
+                args->numCandidates = atoi(optarg);
+                break;
+            case 'g':
+                args->generations = atoi(optarg);
+                break;
+            case 'r':
+                args->seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                return ARGUMENT_LENGTH;
+        }
+    }
+
+    if (argc - optind < 3 || args->threads < 1 || (int)args->method < 0 ||
+            args->numCandidates < 1 || args->generations < 1 ||
+            !args->seed) {
+        return ARGUMENT_LENGTH;
+    }
+
+    args->threshold = atoi(argv[optind]);
+    args->numSeats = argc - optind - 1;
+    if (args->numSeats > MODEL_MAX_PLAYERS) {
+        return ARGUMENT_LENGTH;
+    }
+
+    for (int i = 0; i < args->numSeats - 1; i++) {
+        int strategy = batch_strategy(argv[optind + 2 + i]);
+
+        if (strategy < 0) {
+            return PLAYER_ERROR;
+        }
+        args->opponents[i] = strategy;
+    }
+
+    if (args->threshold < 2 || args->threshold > BOB_MAX_MARGIN) {
+        return INVALID_THRESHOLD;
+    }
+
+    return deck_add_corpus(argv[optind + 1], &args->decks, &args->numDecks) ?
+            NORMAL_EXIT : DECK_ERROR;
+}
+
+
+/* Exits the program and handles the relevant error by printing
+ * an error message to stderr.
+ */
+void handle_game_over(enum ExitMessage errorMessage) {
+    switch (errorMessage) {
+        case NORMAL_EXIT:
+            break;
+        case ARGUMENT_LENGTH:
+            fprintf(stderr, "Usage: 2310tune [-j threads] "
+                    "[-s grid|random|evolve] [-n candidates] "
+                    "[-g generations] [-r seed] threshold corpus opponent "
+                    "{opponent}\n");
+            break;
+        case INVALID_THRESHOLD:
+            fprintf(stderr, "Invalid threshold\n");
+            break;
+        case DECK_ERROR:
+            fprintf(stderr, "Deck error\n");
+            break;
+        case SMALL_DECK:
+            fprintf(stderr, "Not enough cards\n");
+            break;
+        case PLAYER_ERROR:
+            fprintf(stderr, "Player error\n");
+            break;
+    }
+
+    exit(errorMessage);
+}
+
+
+/* The tuner of bob's parameters, 2310tune, which plays a tuned bob against
+ * the given opponents, alice or bob with its defaults, on every deck of a
+ * corpus (a deck file or a directory of them) in every seat, in-process
+ * with the batch engine over the given number of threads. Candidates are
+ * every set of parameters with -s grid, -n random ones (the default), or
+ * with -s evolve a population of -n evolved over -g generations; the
+ * defaults are always among the first random candidates. Candidates race
+ * over the corpus, and those clearly worse than the best are discarded
+ * early. The best SHOWN candidates to have played the whole corpus are
+ * output, best first, as their parameters in BOB_PARAMS' format, their
+ * mean margin over the other seats, its standard error and the decks
+ * played.
+ */
+int main(int argc, char** argv) {
+    struct TuneArgs args;
+    struct ModelState* deals;
+    struct Candidate* candidates;
+    int numCandidates = 0;
+    uint64_t random;
+    long games;
+    struct timespec start;
+    struct timespec end;
+    enum ExitMessage errorMessage = check_valid_args(&args, argc, argv);
+
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    deals = malloc(sizeof(struct ModelState) * args.numDecks);
+    for (int i = 0; i < args.numDecks && !errorMessage; i++) {
+        errorMessage = (enum ExitMessage)deck_load(args.decks[i],
+                args.numSeats, args.threshold, &deals[i], NULL);
+    }
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    random = args.seed;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (args.method == SEARCH_GRID) {
+        candidates = grid_candidates(&args, &numCandidates);
+        if (!candidates) {
+            handle_game_over(ARGUMENT_LENGTH);
+        }
+        games = race_candidates(&args, deals, candidates, numCandidates);
+    } else if (args.method == SEARCH_RANDOM) {
+        numCandidates = args.numCandidates;
+        candidates = calloc(numCandidates, sizeof(struct Candidate));
+        bob_default_params(&candidates[0].params);
+        for (int i = 1; i < numCandidates; i++) {
+            random_params(&args, &candidates[i].params, &random);
+        }
+        games = race_candidates(&args, deals, candidates, numCandidates);
+    } else {
+        numCandidates = args.numCandidates;
+        candidates = calloc(numCandidates, sizeof(struct Candidate));
+        games = evolve_candidates(&args, deals, candidates, &random);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    qsort(candidates, numCandidates, sizeof(struct Candidate),
+            compare_candidates);
+    for (int i = 0; i < numCandidates && i < SHOWN &&
+            !candidates[i].discarded; i++) {
+        char text[BOB_PARAMS_LENGTH];
+
+        bob_format_params(&candidates[i].params, text);
+        printf("%s %.4f %.4f %d\n", text, mean(&candidates[i]),
+                sqrt(mean_variance(&candidates[i])), candidates[i].decks);
+    }
+
+    fprintf(stderr, "%d candidates, %ld games in %.2fs\n", numCandidates,
+            games, (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    for (int i = 0; i < args.numDecks; i++) {
+        free(args.decks[i]);
+    }
+    free(args.decks);
+    free(deals);
+    free(candidates);
+    return NORMAL_EXIT;
+}
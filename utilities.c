@@ -90,6 +90,7 @@ char* get_line(FILE* input) {
         i = fgetc(input);
 
         if (i == EOF) {
+            free(message);
             return NULL;
         }
         
@@ -108,11 +109,52 @@ char* get_line(FILE* input) {
 }
 
 
+/* Reads a line into a buffer which getline grows as needed, so that one
+ * buffer is reused for every line of a stream. Returns the length of the
+ * line without its newline, or -1 on EOF or if the line is unterminated.
+ */
+int read_line(FILE* input, char** buffer, size_t* size) {
+    ssize_t length = getline(buffer, size, input);
+
+    if (length <= 0 || (*buffer)[length - 1] != '\n') {
+        return -1;
+    }
+
+    (*buffer)[length - 1] = '\0';
+    return length - 1;
+}
+
+
 /* Checks that a card is valid by ensuring the suit and rank are within
  * valid ranges. Returns true if valid, false otherwise.
  */
 bool valid_card(char suit, char rank) {
-    return (((suit == 'C') || (suit == 'D') ||
-            (suit == 'S') || (suit == 'H')) && ((rank >= '1' && rank <= '9') ||
-            (rank >= 'a' && rank <= 'f')));
+    int value = decode_rank(rank);
+
+    return suit_index(suit) >= 0 && ((rank >= '1' && rank <= '9') ||
+            (rank >= 'a' && rank <= 'f')) && value >= RULES_MIN_RANK &&
+            value <= RULES_MAX_RANK;
+}
+
+
+/* Returns the position of a suit in SUITS, or -1 if it is not a suit.
+ */
+int suit_index(char suit) {
+    const char* position = strchr(SUITS, suit);
+
+    if (!suit || !position) {
+        return -1;
+    }
+
+    return position - SUITS;
+}
+
+
+/* Mixes a word into a hash (the splitmix64 finaliser).
+ */
+uint64_t mix_hash(uint64_t hash, uint64_t word) {
+    hash ^= word + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
 }
@@ -6,9 +6,37 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <signal.h>
 #include <unistd.h>
 
+#include "rules.h"
+
+
+/* The suits of the game, in the order used by suit_index.
+ */
+#define SUITS RULES_SUITS
+
+
+/* The number of suits in the game.
+ */
+#define NUM_SUITS RULES_NUM_SUITS
+
+
+/* The suit whose cards are counted towards the threshold.
+ */
+#define DIAMONDS (RULES_SUITS[RULES_DIAMONDS])
+
+
+/* The highest rank of a card.
+ */
+#define MAX_RANK RULES_MAX_RANK
+
+
+/* The number of ranks in each suit.
+ */
+#define NUM_RANKS (RULES_MAX_RANK - RULES_MIN_RANK + 1)
+
 
 /* Decodes a hexidecimal character into an integer value,
  * in order to easily compare scores of each individual player.
@@ -30,11 +58,28 @@ char encode_rank(int value);
 char* get_line(FILE* input);
 
 
+/* Reads a line into a buffer which getline grows as needed, so that one
+ * buffer is reused for every line of a stream. Returns the length of the
+ * line without its newline, or -1 on EOF or if the line is unterminated.
+ */
+int read_line(FILE* input, char** buffer, size_t* size);
+
+
 /* Checks that a card is valid by ensuring the suit and rank are within
  * valid ranges. Returns true if valid, false otherwise.
  */
 bool valid_card(char suit, char rank);
 
 
+/* Returns the position of a suit in SUITS, or -1 if it is not a suit.
+ */
+int suit_index(char suit);
+
+
+/* Mixes a word into a hash (the splitmix64 finaliser).
+ */
+uint64_t mix_hash(uint64_t hash, uint64_t word);
+
+
 #endif
 
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "players.h"
+#include "strategy.h"
+#include "transport.h"
+#include "zygote.h"
+#include "ledger.h"
+
+
+// The number of descriptors in a request: stdin, stdout and stderr
+#define REQUEST_FDS 3
+
+// The longest request message
+#define REQUEST_SIZE 80
+
+
+/* The body of a forked player: takes the passed descriptors as its
+ * standard streams and plays the requested game. Never returns.
+ */
+static void run_forked_player(const struct Strategy* strategy,
+        char* request, const int* fds) {
+    struct Game game;
+    enum ExitMessage errorMessage;
+
+    for (int i = 0; i < REQUEST_FDS; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+
+    game.fromHub = stdin;
+    game.toHub = stdout;
+    game.gameId = -1;
+    errorMessage = classify_hub_message(request) != NEWGAME ?
+            INVALID_MESSAGE : handle_new_game(&game, request);
+    if (errorMessage) {
+        handle_game_over(errorMessage);
+    }
+
+    exit(run_game(strategy, &game));
+}
+
+
+/* Handles one request on a connection to the zygote by forking a player
+ * for it, and replies with the player's pid, or -1 if the request is
+ * invalid or the fork fails.
+ */
+static void handle_request(const struct Strategy* strategy, int listener,
+        int connection) {
+    char request[REQUEST_SIZE];
+    char reply[16];
+    int fds[REQUEST_FDS];
+    int count = receive_fds(connection, request, sizeof(request), fds,
+            REQUEST_FDS);
+    pid_t pid = -1;
+
+    if (count == REQUEST_FDS) {
+        // a request is a single line
+        request[strcspn(request, "\n")] = '\0';
+        pid = fork();
+        if (!pid) {
+            close(listener);
+            close(connection);
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGPIPE, SIG_DFL);
+            run_forked_player(strategy, request, fds);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        close(fds[i]);
+    }
+
+    sprintf(reply, "%d\n", (int)pid);
+    write(connection, reply, strlen(reply));
+}
+
+
+/* Serves as a zygote on the given Unix domain socket address, forking a
+ * player for each request. The players are never waited for, so that
+ * they are reaped as soon as they exit.
+ */
+int serve_zygote(const struct Strategy* strategy, const char* address) {
+    int listener;
+
+    if (strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX)) ||
+            (listener = listen_address(address)) < 0) {
+        handle_game_over(INVALID_ADDRESS);
+    }
+
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    while (1) {
+        int connection;
+
+        // an idle zygote still reports its memory when asked
+        if (!ledger_wait(listener)) {
+            break;
+        }
+        connection = accept_connection(listener);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        handle_request(strategy, listener, connection);
+        close(connection);
+    }
+
+    return INVALID_ADDRESS;
+}
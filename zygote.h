@@ -0,0 +1,20 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "players.h"
+
+
+/* Serves as a zygote on the given Unix domain socket address: a resident
+ * player which forks a new player for each hub request, so that a seat
+ * costs a fork rather than starting a program. A request is the message
+ * NEWGAMEplayers,myid,threshold,handsize sent with the stdin, stdout and
+ * stderr the player is to use, and the reply is the player's pid and a
+ * newline.
+ */
+int serve_zygote(const struct Strategy* strategy, const char* address);
+
+
+#endif